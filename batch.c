@@ -0,0 +1,221 @@
+///	Package:	circuit
+///	File:		batch.c
+///	Purpose:	Structure-of-arrays batch evaluation of the LED circuit chain
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "batch.h"
+#include "cpu.h"
+#include "prof.h"
+
+#define BATCH_ALIGN 	64	// bytes, one cache line / one AVX-512 register
+
+/// GCC vector extensions, 8 and 16 floats. Each lowers to whatever the
+/// variant compiling it has: 8 floats are two SSE registers or one AVX
+/// register, 16 are one AVX-512 register. The helpers are macros rather
+/// than functions so no vector ever crosses a call ABI.
+typedef float v8sf __attribute__((vector_size(8*sizeof(float))));
+typedef int32_t v8si __attribute__((vector_size(8*sizeof(int32_t))));
+typedef float v8sf_u __attribute__((vector_size(8*sizeof(float)), aligned(4)));
+typedef int32_t v8si_u __attribute__((vector_size(8*sizeof(int32_t)), aligned(4)));
+typedef float v16sf __attribute__((vector_size(16*sizeof(float))));
+typedef int32_t v16si __attribute__((vector_size(16*sizeof(int32_t))));
+typedef float v16sf_u __attribute__((vector_size(16*sizeof(float)), aligned(4)));
+typedef int32_t v16si_u __attribute__((vector_size(16*sizeof(int32_t)), aligned(4)));
+
+#define V_LOAD(VF, p)		(*(const VF##_u *)(p))
+#define V_STORE(VF, p, x)	(*(VF##_u *)(p) = (x))
+#define V_SPLAT(VF, a)		((VF){ 0 } + (float)(a))
+/// Branch-free select: mask lanes are all ones or all zeros
+#define V_SELECT(VF, VI, mask, a, b)	((VF)(((VI)(a) & (mask)) | ((VI)(b) & ~(mask))))
+
+///===============================================
+/// Allocates room for cap design points. Returns 0 on success, -1 on failure.
+
+int batch_alloc(struct C_batch *b, size_t cap) {
+	 float **cols[] = { &b->v, &b->r, &b->num, &b->fixed_res, &b->rtja, &b->amb, &b->ojt,
+		&b->par_res, &b->var_res, &b->branch_i, &b->total_i, &b->power,
+		&b->temp_rise, &b->ojt_diff, &b->lux, &b->percent, (float **)&b->exceeded };
+	 size_t ncols = sizeof cols / sizeof cols[0];
+	 size_t bytes = ((cap * sizeof(float) + BATCH_ALIGN - 1) / BATCH_ALIGN) * BATCH_ALIGN;
+	 size_t k;
+	 char *block;
+
+	 memset(b, 0, sizeof *b);
+	 if (bytes == 0) bytes = BATCH_ALIGN;
+	 block = aligned_alloc(BATCH_ALIGN, ncols * bytes);
+	 if (block == NULL) return -1;
+	 memset(block, 0, ncols * bytes);
+	 for (k = 0; k < ncols; k++) *cols[k] = (float *)(block + k * bytes);
+	 b->cap = cap;
+	 return 0;
+}
+
+///===============================================
+/// All columns share one allocation, which starts at b->v.
+
+void batch_free(struct C_batch *b) {
+	 free(b->v);
+	 memset(b, 0, sizeof *b);
+}
+
+///===============================================
+
+void batch_set(struct C_batch *b, size_t i, const struct C_design *d) {
+	 b->v[i] = d->v;
+	 b->r[i] = d->r;
+	 b->num[i] = d->num;
+	 b->fixed_res[i] = d->fixed_res;
+	 b->rtja[i] = d->rtja;
+	 b->amb[i] = d->amb;
+	 b->ojt[i] = d->ojt;
+}
+
+void batch_get(const struct C_batch *b, size_t i, struct C_result *out) {
+	 out->par_res = b->par_res[i];
+	 out->var_res = b->var_res[i];
+	 out->branch_i = b->branch_i[i];
+	 out->total_i = b->total_i[i];
+	 out->power = b->power[i];
+	 out->temp_rise = b->temp_rise[i];
+	 out->ojt_diff = b->ojt_diff[i];
+	 out->exceeded = b->exceeded[i];
+	 out->lux = b->lux[i];
+	 out->percent = b->percent[i];
+}
+
+/// Row si of src, inputs and outputs, into row di of dst
+void batch_copy(struct C_batch *dst, size_t di, const struct C_batch *src, size_t si) {
+	 dst->v[di] = src->v[si];
+	 dst->r[di] = src->r[si];
+	 dst->num[di] = src->num[si];
+	 dst->fixed_res[di] = src->fixed_res[si];
+	 dst->rtja[di] = src->rtja[si];
+	 dst->amb[di] = src->amb[si];
+	 dst->ojt[di] = src->ojt[si];
+	 dst->par_res[di] = src->par_res[si];
+	 dst->var_res[di] = src->var_res[si];
+	 dst->branch_i[di] = src->branch_i[si];
+	 dst->total_i[di] = src->total_i[si];
+	 dst->power[di] = src->power[si];
+	 dst->temp_rise[di] = src->temp_rise[si];
+	 dst->ojt_diff[di] = src->ojt_diff[si];
+	 dst->exceeded[di] = src->exceeded[si];
+	 dst->lux[di] = src->lux[si];
+	 dst->percent[di] = src->percent[si];
+}
+
+///===============================================
+/// Fills the batch with the production resistor sweep: every field from
+/// base, with r = r_start, r_start + r_step, ... up to r_stop inclusive.
+/// Returns the number of points written (never more than b->cap).
+
+size_t batch_fill_sweep(struct C_batch *b, const struct C_design *base, float r_start, float r_stop, float r_step) {
+	 size_t i;
+	 for (i = 0; i < b->cap; i++) {
+		 float r = r_start + (float)i * r_step;
+		 if (r > r_stop) break;
+		 batch_set(b, i, base);
+		 b->r[i] = r;
+	 }
+	 b->n = i;
+	 return i;
+}
+
+///===============================================
+/// The chain over whole vectors of W lanes from begin, as far as they
+/// fit before end. Returns where the vectors stopped. The arithmetic is
+/// kernel.h's K_CHAIN_BODY on vectors, so results match k_chain exactly.
+
+#define BATCH_KERNEL(NAME, VF, VI, W) \
+CPU_KERNEL size_t NAME(struct C_batch *b, size_t begin, size_t end) { \
+	 size_t i = begin; \
+	 for (; i + W <= end; i += W) { \
+		 VF v = V_LOAD(VF, b->v + i); \
+		 VF r = V_LOAD(VF, b->r + i); \
+		 VF num = __builtin_convertvector(__builtin_convertvector(V_LOAD(VF, b->num + i), VI), VF); \
+		 K_CHAIN_BODY(VF, VI, V_SPLAT, V_SELECT, v, r, num, V_LOAD(VF, b->fixed_res + i), \
+			V_LOAD(VF, b->rtja + i), V_LOAD(VF, b->amb + i), V_LOAD(VF, b->ojt + i)); \
+		 V_STORE(VF, b->par_res + i, k_par); \
+		 V_STORE(VF, b->var_res + i, k_var); \
+		 V_STORE(VF, b->branch_i + i, k_bi); \
+		 V_STORE(VF, b->total_i + i, k_ti); \
+		 V_STORE(VF, b->power + i, k_pw); \
+		 V_STORE(VF, b->temp_rise + i, k_tr); \
+		 V_STORE(VF, b->ojt_diff + i, k_ojt_diff); \
+		 V_STORE(VI, b->exceeded + i, k_exc); \
+		 V_STORE(VF, b->lux + i, k_lux); \
+		 V_STORE(VF, b->percent + i, k_pct); \
+	 } \
+	 return i; \
+}
+
+BATCH_KERNEL(batch_vec8, v8sf, v8si, 8)
+BATCH_KERNEL(batch_vec16, v16sf, v16si, 16)
+
+/// The remainder, one point at a time through k_chain
+CPU_KERNEL void batch_tail(struct C_batch *b, size_t i, size_t end) {
+	 for (; i < end; i++) {
+		 struct C_design d = { b->v[i], b->r[i], b->num[i], b->fixed_res[i], b->rtja[i], b->amb[i], b->ojt[i] };
+		 struct C_result res;
+		 k_chain(&d, &res);
+		 b->par_res[i] = res.par_res;
+		 b->var_res[i] = res.var_res;
+		 b->branch_i[i] = res.branch_i;
+		 b->total_i[i] = res.total_i;
+		 b->power[i] = res.power;
+		 b->temp_rise[i] = res.temp_rise;
+		 b->ojt_diff[i] = res.ojt_diff;
+		 b->exceeded[i] = res.exceeded;
+		 b->lux[i] = res.lux;
+		 b->percent[i] = res.percent;
+	 }
+}
+
+/// One copy per CPU variant; AVX-512 takes 16 lanes at a time
+static void batch_range_base(struct C_batch *b, size_t begin, size_t end) {
+	 batch_tail(b, batch_vec8(b, begin, end), end);
+}
+
+CPU_TARGET_SSE42 static void batch_range_sse42(struct C_batch *b, size_t begin, size_t end) {
+	 batch_tail(b, batch_vec8(b, begin, end), end);
+}
+
+CPU_TARGET_AVX2 static void batch_range_avx2(struct C_batch *b, size_t begin, size_t end) {
+	 batch_tail(b, batch_vec8(b, begin, end), end);
+}
+
+CPU_TARGET_AVX512 static void batch_range_avx512(struct C_batch *b, size_t begin, size_t end) {
+	 batch_tail(b, batch_vec16(b, begin, end), end);
+}
+
+static void (*const batch_range[CPU_NISA])(struct C_batch *, size_t, size_t) = {
+	batch_range_base, batch_range_sse42, batch_range_avx2, batch_range_avx512 };
+
+///===============================================
+/// Evaluates design points [begin, end) with the cpu_isa() variant.
+/// Full vectors go through the SIMD path, the remainder through the
+/// scalar kernels, with the same results either way.
+
+void batch_run_range(struct C_batch *b, size_t begin, size_t end) {
+	 PROF_BEGIN(prof_t);
+	 batch_range[cpu_isa()](b, begin, end);
+	 PROF_END(PROF_BATCH_RUN, prof_t, end - begin);
+}
+
+///===============================================
+
+void batch_run(struct C_batch *b) {
+	 batch_run_range(b, 0, b->n);
+}
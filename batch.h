@@ -0,0 +1,54 @@
+// batch.h //
+#ifndef BATCH_H
+#define BATCH_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "kernel.h"
+
+/** Structure-of-arrays batch of C_design inputs and C_result outputs.
+	Every column holds n floats, 64-byte aligned, so batch_run can
+	stream the whole resistor -> current -> thermal -> lux chain
+	through SIMD registers one column load at a time.
+**/
+struct C_batch {
+    size_t 	n;		// design points in use
+    size_t 	cap;		// design points allocated
+    /// inputs
+    float 	*v;
+    float 	*r;
+    float 	*num;
+    float 	*fixed_res;
+    float 	*rtja;
+    float 	*amb;
+    float 	*ojt;
+    /// outputs
+    float 	*par_res;
+    float 	*var_res;
+    float 	*branch_i;
+    float 	*total_i;
+    float 	*power;
+    float 	*temp_rise;
+    float 	*ojt_diff;
+    float 	*lux;
+    float 	*percent;
+    int32_t 	*exceeded;
+};
+
+int batch_alloc(struct C_batch *b, size_t cap);
+void batch_free(struct C_batch *b);
+void batch_set(struct C_batch *b, size_t i, const struct C_design *d);
+void batch_get(const struct C_batch *b, size_t i, struct C_result *out);
+void batch_copy(struct C_batch *dst, size_t di, const struct C_batch *src, size_t si);
+size_t batch_fill_sweep(struct C_batch *b, const struct C_design *base, float r_start, float r_stop, float r_step);
+
+void batch_run(struct C_batch *b);
+void batch_run_range(struct C_batch *b, size_t begin, size_t end);
+
+#endif
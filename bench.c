@@ -0,0 +1,520 @@
+///	Package:	intensity
+///	File:		bench.c
+///	Purpose:	Throughput benchmarks for the circuit and intensity kernels
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** Usage:	bench [-c] [-o file] [-b file] [-r pct] [-f name] [-T threads] [-m ms]
+	-c		CSV on stdout instead of the table
+	-o file		also write the CSV to file
+	-b file		compare with a baseline CSV written by -o; exits 1 if
+			any case got slower by more than the threshold
+	-r pct		regression threshold in percent, default 10
+	-f name		only the cases whose name contains name
+	-T threads	largest thread count for the threaded cases,
+			default all cores
+	-m ms		shortest timed run, default 50
+
+	make -f make-test.mk bench BENCH_FLAGS="-b bench.baseline"
+
+	CSV lines are name,threads,ns_per_op,items_per_sec,ops with one
+	header line. Every case is timed BENCH_REPEATS times after a
+	calibration run and the fastest time is kept, which is the least
+	disturbed by the rest of the machine. An op is one call for the
+	scalar cases, one batch or one whole sweep for the others; items
+	counts design points, so items/s compares across all of them.
+	Threaded cases run at 1, 2, 4 ... threads and the table shows the
+	speedup over 1 thread.
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "kernel.h"
+#include "circuit.h"
+#include "intensity.h"
+#include "report.h"
+#include "batch.h"
+#include "pool.h"
+#include "cpu.h"
+#include "precision.h"
+#include "memo.h"
+#include "model.h"
+#include "sens.h"
+#include "colfile.h"
+#include "photometry.h"
+#include "sweep.h"
+
+#define BENCH_INPUTS 	1024		// scalar inputs cycled through, a power of 2
+#define BENCH_BATCH 	65536		// design points per batch op
+#define BENCH_CHUNK 	4096		// design points per pool task
+#define BENCH_REPEATS 	5
+#define BENCH_MAX_OPS 	((size_t)1 << 40)	// a case this fast is not running
+#define BENCH_MAX 	256		// results kept
+#define BENCH_NAME 	48
+
+struct bench_case {
+    const char 	*name;
+    size_t 	items;			// design points per op
+    int 	threaded;		// timed at every thread count
+    int 	(*fn)(size_t ops, int nthreads);	// 0, or -1 if the case could not run
+};
+
+struct bench_result {
+    char 	name[BENCH_NAME];
+    int 	threads;
+    double 	ns_per_op;
+    double 	items_per_sec;
+    size_t 	ops;
+};
+
+/// Inputs, set up once
+static float bench_r[BENCH_INPUTS];
+static float bench_v[BENCH_INPUTS];
+static double bench_e[BENCH_INPUTS];
+static struct C_design bench_d[BENCH_INPUTS];
+static struct C_batch bench_b;
+static struct sweep_grid bench_g;
+static float bench_gr[256], bench_gnum[16], bench_gv[4], bench_gamb[4], bench_gfix[4];
+
+/// Results are summed into here so no call can be optimized away
+static volatile double bench_sink;
+
+///===============================================
+/// Scalar cases: ops calls, cycling through the inputs.
+
+#define BENCH_SCALAR(fname, expr) \
+static int fname(size_t ops, int nthreads) { \
+	 double acc = 0; \
+	 size_t k; \
+	 (void)nthreads; \
+	 for (k = 0; k < ops; k++) { \
+		 size_t j = k & (BENCH_INPUTS - 1); \
+		 acc += (expr); \
+	 } \
+	 bench_sink += acc; \
+	 return 0; \
+}
+
+BENCH_SCALAR(bench_parallel_resistance, calc_parallel_resistance(bench_r[j], 19))
+BENCH_SCALAR(bench_total_power, calc_total_power(bench_v[j], bench_r[j], 19))
+BENCH_SCALAR(bench_var_resistance, calc_var_resistance(bench_r[j], 3.3f))
+BENCH_SCALAR(bench_output_resistance, calc_output_resistance(3.3f, bench_r[j]))
+BENCH_SCALAR(bench_power_VI, calc_power_VI(bench_v[j], bench_r[j]))
+BENCH_SCALAR(bench_branch_current, branch_current(bench_v[j], bench_r[j]))
+BENCH_SCALAR(bench_total_current, total_current(bench_v[j], bench_r[j], 19))
+BENCH_SCALAR(bench_temp_rise, calc_temp_rise(bench_v[j], 0, bench_r[j], R_THETA_JA_TPS61169, ROOM_TEMP1))
+BENCH_SCALAR(bench_junct_temp_exceeded, junct_temp_exceeded(bench_r[j] * 10, MAX_OP_JUNCT_TEMP_TPS61169))
+BENCH_SCALAR(bench_temp_diff_OJT_TR, temp_diff_OJT_TR(bench_r[j] * 10, MAX_OP_JUNCT_TEMP_TPS61169))
+BENCH_SCALAR(bench_ResToLux, DE_ResToLux(bench_r[j]))
+BENCH_SCALAR(bench_ResToPercent, DE_ResToPercent(bench_r[j]))
+BENCH_SCALAR(bench_ResToAll, DE_ResToAll(bench_r[j]).lux)
+BENCH_SCALAR(bench_intensity, calc_intensity(1, 1.00027717, 8.8541878128e-12, bench_e[j]))
+BENCH_SCALAR(bench_irradiance, calc_irradiance(1, 1.25663706212e-6, bench_e[j]))
+BENCH_SCALAR(bench_Electric_Field, calc_Electric_Field(1, 1.6e-19, bench_e[j] * 1e-18))
+BENCH_SCALAR(bench_Lux, calc_Lux(bench_e[j], 0.5))
+
+///===============================================
+/// The whole chain, one design point at a time.
+
+static int bench_chain(size_t ops, int nthreads) {
+	 struct C_result res;
+	 double acc = 0;
+	 size_t k;
+	 (void)nthreads;
+	 for (k = 0; k < ops; k++) {
+		 k_chain(&bench_d[k & (BENCH_INPUTS - 1)], &res);
+		 acc += res.lux;
+	 }
+	 bench_sink += acc;
+	 return 0;
+}
+
+///===============================================
+/// The whole chain over a batch, on one thread and split over a pool.
+
+static int bench_batch(size_t ops, int nthreads) {
+	 size_t k;
+	 (void)nthreads;
+	 for (k = 0; k < ops; k++) batch_run(&bench_b);
+	 bench_sink += bench_b.lux[BENCH_BATCH - 1];
+	 return 0;
+}
+
+static void bench_batch_task(void *ctx, size_t task, int worker) {
+	 struct C_batch *b = ctx;
+	 (void)worker;
+	 batch_run_range(b, task * BENCH_CHUNK, (task + 1) * BENCH_CHUNK);
+}
+
+static int bench_batch_pool(size_t ops, int nthreads) {
+	 size_t k;
+	 for (k = 0; k < ops; k++) pool_run(nthreads, BENCH_BATCH / BENCH_CHUNK, bench_batch_task, &bench_b);
+	 bench_sink += bench_b.lux[BENCH_BATCH - 1];
+	 return 0;
+}
+
+/// Only the ambient changes between ops, so model_batch_run redoes
+/// the three thermal columns.
+static int bench_model_amb(size_t ops, int nthreads) {
+	 static struct model_batch mb;
+	 size_t k;
+	 (void)nthreads;
+	 if (mb.b.cap == 0) {
+		 if (model_batch_alloc(&mb, BENCH_BATCH) != 0) return -1;
+		 for (k = 0; k < BENCH_BATCH; k++) batch_copy(&mb.b, k, &bench_b, k);
+		 mb.b.n = BENCH_BATCH;
+		 model_batch_run(&mb);
+	 }
+	 for (k = 0; k < ops; k++) {
+		 model_batch_fill(&mb, MODEL_AMB, 15.0f + (float)(k & 31));
+		 model_batch_run(&mb);
+	 }
+	 bench_sink += mb.b.ojt_diff[BENCH_BATCH - 1];
+	 return 0;
+}
+
+/// Every output and its gradient in one pass
+static int bench_sens(size_t ops, int nthreads) {
+	 static struct sens_batch sb;
+	 size_t k;
+	 (void)nthreads;
+	 if (sb.cap == 0 && sens_batch_alloc(&sb, BENCH_BATCH) != 0) return -1;
+	 for (k = 0; k < ops; k++) sens_batch_run(&bench_b, &sb);
+	 bench_sink += sb.grad[SENS_TEMP_RISE][SENS_R][BENCH_BATCH - 1];
+	 return 0;
+}
+
+/// Lux from branch currents through a white LED's lumen table
+static int bench_photometry(size_t ops, int nthreads) {
+	 static const struct ph_emitter white = { 2, { { 450, 20, 0.3 }, { 570, 110, 0.7 } }, 0.9, 0.4, 0.35, 4, 6 };
+	 static const struct ph_geometry g = { 2, 1 };
+	 static float cur[BENCH_BATCH], lux[BENCH_BATCH];
+	 static struct ph_lut t;
+	 struct ph_weights w;
+	 size_t k;
+	 (void)nthreads;
+	 if (t.i_max == 0) {
+		 ph_weights_init(&w, PH_PHOTOPIC);
+		 if (ph_lut_init(&t, &w, &white, 0.5f) != 0) return -1;
+		 for (k = 0; k < BENCH_BATCH; k++) cur[k] = 0.5f * (float)k / BENCH_BATCH;
+	 }
+	 for (k = 0; k < ops; k++) ph_lux_batch(&t, &g, cur, bench_b.num, BENCH_BATCH, lux);
+	 bench_sink += lux[BENCH_BATCH - 1];
+	 return 0;
+}
+
+///===============================================
+/// A full sweep with its reductions.
+
+static int bench_sweep_prec(size_t ops, int nthreads, enum prec_mode prec) {
+	 struct sweep_config cfg = { nthreads, 0, NULL, NULL, prec };
+	 struct sweep_stats st;
+	 size_t k;
+	 for (k = 0; k < ops; k++) {
+		 if (sweep_run(&bench_g, &cfg, &st) != 0) return -1;
+		 bench_sink += st.min_margin;
+		 sweep_stats_free(&st);
+	 }
+	 return 0;
+}
+
+static int bench_sweep(size_t ops, int nthreads) {
+	 return bench_sweep_prec(ops, nthreads, PREC_FLOAT);
+}
+
+static int bench_sweep_double(size_t ops, int nthreads) {
+	 return bench_sweep_prec(ops, nthreads, PREC_DOUBLE);
+}
+
+/// The same sweep answered from a warm memo. The file is unlinked once
+/// mapped, so nothing is left behind.
+static int bench_sweep_memo(size_t ops, int nthreads) {
+	 static struct memo m;
+	 struct sweep_config cfg = { nthreads, 0, NULL, NULL, PREC_FLOAT, &m };
+	 struct sweep_stats st;
+	 size_t k;
+	 if (m.hdr == NULL) {
+		 char path[] = "/tmp/bench.memo.XXXXXX";
+		 int fd = mkstemp(path), rc;
+		 if (fd < 0) return -1;
+		 close(fd);
+		 rc = memo_open(&m, path, 2 * sweep_points(&bench_g));
+		 unlink(path);
+		 if (rc != 0) return -1;
+	 }
+	 for (k = 0; k < ops; k++) {
+		 if (sweep_run(&bench_g, &cfg, &st) != 0) return -1;
+		 bench_sink += st.min_margin;
+		 sweep_stats_free(&st);
+	 }
+	 return 0;
+}
+
+/// The sweep written to a column file, created afresh each time
+static int bench_sweep_file(size_t ops, int nthreads) {
+	 struct cf_writer w;
+	 struct sweep_config cfg = { nthreads, 0, NULL, NULL, PREC_FLOAT, NULL, &w };
+	 struct sweep_stats st;
+	 char path[] = "/tmp/bench.cols.XXXXXX";
+	 int fd = mkstemp(path), rc = 0;
+	 size_t k;
+	 if (fd < 0) return -1;
+	 close(fd);
+	 for (k = 0; k < ops && rc == 0; k++) {
+		 if (cf_create_batch(&w, path, SWEEP_CHUNK, sweep_points(&bench_g)) != 0) {
+			 rc = -1;
+			 break;
+		 }
+		 rc = sweep_run(&bench_g, &cfg, &st);
+		 cf_close(&w);
+		 if (rc != 0) break;
+		 bench_sink += st.min_margin;
+		 sweep_stats_free(&st);
+	 }
+	 unlink(path);
+	 return rc;
+}
+
+static const struct bench_case bench_cases[] = {
+	{ "calc_parallel_resistance",	1, 0, bench_parallel_resistance },
+	{ "calc_total_power",		1, 0, bench_total_power },
+	{ "calc_var_resistance",	1, 0, bench_var_resistance },
+	{ "calc_output_resistance",	1, 0, bench_output_resistance },
+	{ "calc_power_VI",		1, 0, bench_power_VI },
+	{ "branch_current",		1, 0, bench_branch_current },
+	{ "total_current",		1, 0, bench_total_current },
+	{ "calc_temp_rise",		1, 0, bench_temp_rise },
+	{ "junct_temp_exceeded",	1, 0, bench_junct_temp_exceeded },
+	{ "temp_diff_OJT_TR",		1, 0, bench_temp_diff_OJT_TR },
+	{ "DE_ResToLux",		1, 0, bench_ResToLux },
+	{ "DE_ResToPercent",		1, 0, bench_ResToPercent },
+	{ "DE_ResToAll",		1, 0, bench_ResToAll },
+	{ "calc_intensity",		1, 0, bench_intensity },
+	{ "calc_irradiance",		1, 0, bench_irradiance },
+	{ "calc_Electric_Field",	1, 0, bench_Electric_Field },
+	{ "calc_Lux",			1, 0, bench_Lux },
+	{ "k_chain",			1, 0, bench_chain },
+	{ "batch_run",			BENCH_BATCH, 0, bench_batch },
+	{ "batch_run_pool",		BENCH_BATCH, 1, bench_batch_pool },
+	{ "model_batch_amb",		BENCH_BATCH, 0, bench_model_amb },
+	{ "sens_batch_run",		BENCH_BATCH, 0, bench_sens },
+	{ "ph_lux_batch",		BENCH_BATCH, 0, bench_photometry },
+	{ "sweep_run",			256 * 16 * 4 * 4 * 4, 1, bench_sweep },
+	{ "sweep_run_double",		256 * 16 * 4 * 4 * 4, 1, bench_sweep_double },
+	{ "sweep_run_memo",		256 * 16 * 4 * 4 * 4, 1, bench_sweep_memo },
+	{ "sweep_run_file",		256 * 16 * 4 * 4 * 4, 1, bench_sweep_file },
+};
+
+///===============================================
+
+static void bench_setup(void) {
+	 struct C_design base = { 0.21, 3.3, 19, 0, R_THETA_JA_TPS61169, ROOM_TEMP1, MAX_OP_JUNCT_TEMP_TPS61169 };
+	 size_t k;
+
+	 for (k = 0; k < BENCH_INPUTS; k++) {
+		 bench_r[k] = 1.0f + 39.0f * (float)k / BENCH_INPUTS;
+		 bench_v[k] = 0.2f + 0.02f * (float)(k % 7);
+		 bench_e[k] = 1e8 * (1 + (double)k / BENCH_INPUTS);
+		 bench_d[k] = base;
+		 bench_d[k].r = bench_r[k];
+	 }
+	 if (batch_alloc(&bench_b, BENCH_BATCH) != 0) {
+		 fprintf(stderr, "bench: out of memory\n");
+		 exit(2);
+	 }
+	 for (k = 0; k < BENCH_BATCH; k++) {
+		 struct C_design d = base;
+		 d.r = 1.0f + 39.0f * (float)k / BENCH_BATCH;
+		 batch_set(&bench_b, k, &d);
+	 }
+	 bench_b.n = BENCH_BATCH;
+
+	 for (k = 0; k < 256; k++) bench_gr[k] = 1.0f + 0.15f * (float)k;
+	 for (k = 0; k < 16; k++) bench_gnum[k] = (float)(4 + k);
+	 for (k = 0; k < 4; k++) {
+		 bench_gv[k] = 0.19f + 0.01f * (float)k;
+		 bench_gamb[k] = 15.0f + 10.0f * (float)k;
+		 bench_gfix[k] = 3.3f * (float)(k + 1);
+	 }
+	 bench_g.r.values = bench_gr;		bench_g.r.count = 256;
+	 bench_g.num.values = bench_gnum;	bench_g.num.count = 16;
+	 bench_g.v.values = bench_gv;		bench_g.v.count = 4;
+	 bench_g.amb.values = bench_gamb;	bench_g.amb.count = 4;
+	 bench_g.fixed_res.values = bench_gfix;	bench_g.fixed_res.count = 4;
+	 bench_g.rtja = R_THETA_JA_TPS61169;
+	 bench_g.ojt = MAX_OP_JUNCT_TEMP_TPS61169;
+}
+
+static double bench_now(void) {
+	 struct timespec ts;
+	 clock_gettime(CLOCK_MONOTONIC, &ts);
+	 return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+///===============================================
+/// Times one case: ops doubles until a run takes min_ns, then the
+/// fastest of BENCH_REPEATS runs of that many ops is kept. Returns -1
+/// if the case fails, or if BENCH_MAX_OPS ops still run too fast to
+/// time, which means it is not doing the work.
+
+static int bench_measure(const struct bench_case *c, int nthreads, double min_ns, struct bench_result *out) {
+	 size_t ops = 1;
+	 double t, best;
+	 int k;
+
+	 for (;;) {
+		 t = bench_now();
+		 if (c->fn(ops, nthreads) != 0) return -1;
+		 t = bench_now() - t;
+		 if (t >= min_ns) break;
+		 if (ops >= BENCH_MAX_OPS) return -1;
+		 /// Jump most of the way once the time is measurable
+		 if (t > min_ns / 100) ops = (size_t)((double)ops * 1.2 * min_ns / t) + 1;
+		 else ops *= 10;
+		 if (ops > BENCH_MAX_OPS) ops = BENCH_MAX_OPS;
+	 }
+	 best = t;
+	 for (k = 1; k < BENCH_REPEATS; k++) {
+		 t = bench_now();
+		 if (c->fn(ops, nthreads) != 0) return -1;
+		 t = bench_now() - t;
+		 if (t < best) best = t;
+	 }
+	 snprintf(out->name, BENCH_NAME, "%s", c->name);
+	 out->threads = nthreads;
+	 out->ops = ops;
+	 out->ns_per_op = best / (double)ops;
+	 out->items_per_sec = (double)c->items * (double)ops * 1e9 / best;
+	 return 0;
+}
+
+static void bench_csv(FILE *fp, const struct bench_result *r, size_t n) {
+	 size_t k;
+	 fprintf(fp, "name,threads,ns_per_op,items_per_sec,ops\n");
+	 for (k = 0; k < n; k++)
+		 fprintf(fp, "%s,%d,%.6g,%.6g,%zu\n", r[k].name, r[k].threads, r[k].ns_per_op, r[k].items_per_sec, r[k].ops);
+}
+
+///===============================================
+/// Compares with a baseline CSV. Returns the number of regressions,
+/// or -1 if the file can't be read. Cases missing from either side
+/// are skipped.
+
+static int bench_compare(const char *path, const struct bench_result *r, size_t n, double pct) {
+	 FILE *fp = fopen(path, "r");
+	 char line[256], name[BENCH_NAME];
+	 int threads, bad = 0;
+	 double ns;
+	 size_t k;
+
+	 if (fp == NULL) {
+		 fprintf(stderr, "bench: cannot read baseline %s\n", path);
+		 return -1;
+	 }
+	 while (fgets(line, sizeof line, fp) != NULL) {
+		 if (sscanf(line, "%47[^,],%d,%lf", name, &threads, &ns) != 3 || ns <= 0) continue;
+		 for (k = 0; k < n; k++) {
+			 double change;
+			 if (r[k].threads != threads || strcmp(r[k].name, name) != 0) continue;
+			 change = 100 * (r[k].ns_per_op / ns - 1);
+			 if (change > pct) {
+				 fprintf(stderr, "REGRESSION %s threads=%d: %.4g ns/op vs %.4g baseline (%+.1f%%)\n",
+					name, threads, r[k].ns_per_op, ns, change);
+				 bad++;
+			 }
+		 }
+	 }
+	 fclose(fp);
+	 return bad;
+}
+
+int main(int argc, char const *argv[]) {
+	 static struct bench_result res[BENCH_MAX];
+	 const char *out_path = NULL, *base_path = NULL, *filter = NULL;
+	 double pct = 10, min_ns = 50e6;
+	 int csv = 0, max_threads = pool_threads_default(), rc = 0, a;
+	 size_t n = 0, c;
+	 struct report_sink quiet;
+
+	 for (a = 1; a < argc; a++) {
+		 const char *opt = argv[a], *val = (a + 1 < argc) ? argv[a + 1] : NULL;
+		 if (strcmp(opt, "-c") == 0) { csv = 1; continue; }
+		 if (val == NULL) {
+			 fprintf(stderr, "bench: %s needs a value\n", opt);
+			 return 2;
+		 }
+		 a++;
+		 if (strcmp(opt, "-o") == 0) out_path = val;
+		 else if (strcmp(opt, "-b") == 0) base_path = val;
+		 else if (strcmp(opt, "-r") == 0) pct = atof(val);
+		 else if (strcmp(opt, "-f") == 0) filter = val;
+		 else if (strcmp(opt, "-T") == 0) max_threads = atoi(val);
+		 else if (strcmp(opt, "-m") == 0) min_ns = atof(val) * 1e6;
+		 else {
+			 fprintf(stderr, "bench: unknown option %s\n", opt);
+			 return 2;
+		 }
+	 }
+	 if (max_threads < 1) max_threads = 1;
+	 if (max_threads > POOL_MAX_THREADS) max_threads = POOL_MAX_THREADS;
+
+	 /// Time the arithmetic, not the printing
+	 report_open(&quiet, REPORT_NULL, NULL);
+	 report_use(&quiet);
+	 bench_setup();
+	 /// Baselines only compare on the same variant, CPU_ISA forces one
+	 fprintf(stderr, "bench: %s kernels\n", cpu_isa_name(cpu_isa()));
+
+	 if (!csv) printf("%-26s %7s %12s %14s %8s\n", "case", "threads", "ns/op", "items/s", "speedup");
+	 for (c = 0; c < sizeof bench_cases / sizeof bench_cases[0]; c++) {
+		 const struct bench_case *bc = &bench_cases[c];
+		 size_t first = n;
+		 int t = 1;
+		 if (filter != NULL && strstr(bc->name, filter) == NULL) continue;
+		 for (;;) {
+			 if (n == BENCH_MAX) break;
+			 if (bench_measure(bc, t, min_ns, &res[n]) != 0) {
+				 fprintf(stderr, "bench: %s failed\n", bc->name);
+				 rc = 2;
+				 break;
+			 }
+			 if (!csv) printf("%-26s %7d %12.4g %14.4g %7.2fx\n", res[n].name, t, res[n].ns_per_op,
+				res[n].items_per_sec, res[first].ns_per_op / res[n].ns_per_op);
+			 n++;
+			 if (!bc->threaded || t == max_threads) break;
+			 t = (2 * t < max_threads) ? 2 * t : max_threads;
+		 }
+	 }
+	 if (csv) bench_csv(stdout, res, n);
+	 if (out_path != NULL) {
+		 FILE *fp = fopen(out_path, "w");
+		 if (fp == NULL) {
+			 fprintf(stderr, "bench: cannot write %s\n", out_path);
+			 rc = 2;
+		 } else {
+			 bench_csv(fp, res, n);
+			 fclose(fp);
+		 }
+	 }
+	 if (base_path != NULL) {
+		 int bad = bench_compare(base_path, res, n, pct);
+		 int want = (bad < 0) ? 2 : (bad > 0);
+		 /// A failed case outranks a regression
+		 if (rc < want) rc = want;
+		 if (bad == 0) fprintf(stderr, "bench: no regressions over %.0f%% against %s\n", pct, base_path);
+	 }
+	 report_use(NULL);
+	 report_close(&quiet);
+	 batch_free(&bench_b);
+	 return rc;
+}
@@ -29,69 +29,30 @@
 #include <math.h>
 //~ #include <check.h>
 #include "circuit.h"
+#include "constants.h"
+#include "kernel.h"
+#include "prof.h"
+#include "report.h"
 
-/// STANDARD DEFINITIONS FOR PROJECT SCICALC 
-#define PI		3.14159265358979323846 // ad infinitum
-#define LIGHT_SPEED	299792458 // meters per second
-#define DATA_SIZE 1000
-#define DELTA 	1.0e-6
-#define MILLI 	1.0e-3
-#define MICRO 	1.0e-6
-#define NANO 	1.0e-9
-#define PICO 	1.0e-12
-#define KILO 	pow(10,3) 			//1000
-#define MEGA 	pow(10,6) 			//1000000
-#define GIGA 	pow(10,9) 			//1000000000
-#define TERA 	pow(10,12) 			//1000000000000 
-#define HALF 	pow(10,0.30102999566398119802)
-#define FOURTH 	pow(10,0.60205999132796239603)
-#define EIGHTH 	pow(10,0.90308998699194353854)
-#define true 1
-#define false 0
+/// STANDARD DEFINITIONS and the physical constants are in constants.h
 
-/// STANDARD DEFINITIONS FOR LIGHT INTENSITY AND ELECTRIC FIELD CALCULATIONS
-#define AIR_REFRACTIVE_INDEX 1.00027717
-#define E0 8.8541878128*PICO				// Permittivity of Free Space in Farads per meter
-#define MU0 1.25663706212*MICRO				// Permeability of Free Space in Newtons per square meter
-#define EPSILON_0 1/(MU0*(LIGHT_SPEED*LIGHT_SPEED))	// Permittivity of Free Space Equation
-#define E_CONSTANT 1/(4*PI*EPSILON_0)
-#define ELECTRON_CHARGE 1.6e-19 			// Charge of an electron in Coulombs
-#define RADIUS_HELIUM_ATOM 26.5e-12			// Radius of a Helium atom in meters
-#define LED_ARRAY_RADIUS 0.35 				// meters from LED array to sample plate
-
-/// DEFINITIONS FOR LED ARRAY THERMAL CALCULATIONS
-#define R_THETA_JA_TPS61169	263.8		// Junction to Ambient, in degrees C/Watt
-#define ROOM_TEMP1 25.0				// = 77 deg F
-#define ROOM_TEMP2 26.7 			// = 80.1 deg F
-#define ROOM_TEMP3 40.0 			// = 104.0 deg F
-#define MAX_TEMP_TPS61169 100.0			// = 212.0 deg F
-#define MAX_OP_JUNCT_TEMP_TPS61169 125.0	// = 257.0 deg F
+/// DEFINITIONS FOR LED ARRAY THERMAL CALCULATIONS are in kernel.h
 
 #define TXT_FILE "circuit.txt"
 
 ///===============================================
 
-/** This data structure holds the test inputs for our circuit object. 
-	All we need are:
-		1. voltage at the Feedback input
-		2. current value
-		2. resistor value
-		3. number of branches
-**/
-struct C_test {
-    float 	v;	// voltage
-    float 	i; 	// current
-    float 	r;	// resistor
-    float 	num;	// number of branches 
-};
+/// struct C_test is in kernel.h
 ///===============================================
 /// Calculates and returns the net parallel resistance when 
 /// all resistors are of the same value.
 /// Used for LED array current limiting resistor calculations.
 
 float calc_parallel_resistance(float resistor_value, int num_branches) {
-	 float result = 1/(num_branches * (1/resistor_value));
-	 printf("net parallel resistance\t\t\t = %.8f Ohms\n",result);
+	 PROF_BEGIN(prof_t);
+	 float result = k_parallel_resistance(resistor_value, num_branches);
+	 PROF_END(PROF_PARALLEL_RESISTANCE, prof_t, 1);
+	 REPORT("parallel_resistance", "net parallel resistance\t\t\t = %.8f Ohms\n", 1, result);
 	 return result;
 }
 ///===============================================
@@ -99,8 +60,10 @@ float calc_parallel_resistance(float resistor_value, int num_branches) {
 /// in parallel with a fixed resistor in order to obtain a desired net resistance.
 
 float calc_var_resistance(float desired_res, float fixed_res) {
-	 float result = (fixed_res*desired_res)/(fixed_res-desired_res);
-	 printf("variable resistance\t\t\t = %.8f Ohms\n",result);
+	 PROF_BEGIN(prof_t);
+	 float result = k_var_resistance(desired_res, fixed_res);
+	 PROF_END(PROF_VAR_RESISTANCE, prof_t, 1);
+	 REPORT("var_resistance", "variable resistance\t\t\t = %.8f Ohms\n", 1, result);
 	 return result;
 }
 
@@ -109,8 +72,10 @@ float calc_var_resistance(float desired_res, float fixed_res) {
 /// a fixed resistor and a variable resistor  
 
 float calc_output_resistance(float fixed_res, float var_res) {
-	 float result = (fixed_res*var_res)/(fixed_res+var_res);
-	 printf("output resistance\t\t\t = %.8f Ohms\n",result);
+	 PROF_BEGIN(prof_t);
+	 float result = k_output_resistance(fixed_res, var_res);
+	 PROF_END(PROF_OUTPUT_RESISTANCE, prof_t, 1);
+	 REPORT("output_resistance", "output resistance\t\t\t = %.8f Ohms\n", 1, result);
 	 return result;
 }
 ///===============================================
@@ -118,9 +83,11 @@ float calc_output_resistance(float fixed_res, float var_res) {
 /// as a function of voltage, resistance, and the number of branches
 
 float total_current(float voltage, float resistance, int num_branches) {
-	 float result = num_branches*(voltage/resistance);
+	 PROF_BEGIN(prof_t);
+	 float result = k_total_current(voltage, resistance, num_branches);
 	 //~ printf("total current = %.8f Amps\t\tVoltage = %.4f\tres = %.4f\n",result,voltage,resistance);
-	 printf("total current = %.8f Amps\t\tNum Branches = %i\n",result, num_branches);
+	 PROF_END(PROF_TOTAL_CURRENT, prof_t, 1);
+	 REPORT("total_current", "total current = %.8f Amps\t\tNum Branches = %.0f\n", 2, result, (double)num_branches);
 	 return result;
 }
 ///===============================================
@@ -128,8 +95,10 @@ float total_current(float voltage, float resistance, int num_branches) {
 /// as a function of voltage and resistance
 
 float branch_current(float voltage, float resistance) {
-	 float result = (voltage/resistance);
-	 printf("branch current = %.8f Amps\tVoltage = %.2f\t\tres = %.2f Ohms\n",result,voltage,resistance);
+	 PROF_BEGIN(prof_t);
+	 float result = k_branch_current(voltage, resistance);
+	 PROF_END(PROF_BRANCH_CURRENT, prof_t, 1);
+	 REPORT("branch_current", "branch current = %.8f Amps\tVoltage = %.2f\t\tres = %.2f Ohms\n", 3, result, voltage, resistance);
 	 return result;
 }  
 ///===============================================
@@ -137,8 +106,10 @@ float branch_current(float voltage, float resistance) {
 /// as a function of voltage and current
 
 float calc_power_VI(float voltage, float current) {
-	 float result = voltage*current;
-	 printf("total power = %.8f Watts\n",result);
+	 PROF_BEGIN(prof_t);
+	 float result = k_power_VI(voltage, current);
+	 PROF_END(PROF_POWER_VI, prof_t, 1);
+	 REPORT("power_VI", "total power = %.8f Watts\n", 1, result);
 	 return result;
 }
 ///===============================================
@@ -146,8 +117,10 @@ float calc_power_VI(float voltage, float current) {
 /// as a function of voltage, current, and the number of branches
 
 float calc_total_power(float voltage, float current, int num_branches) {
-	 float result = num_branches*voltage*current;
-	 printf("total power = %.8f Watts\n",result);
+	 PROF_BEGIN(prof_t);
+	 float result = k_total_power(voltage, current, num_branches);
+	 PROF_END(PROF_TOTAL_POWER, prof_t, 1);
+	 REPORT("total_power", "total power = %.8f Watts\n", 1, result);
 	 return result;
 }
 ///===============================================
@@ -158,14 +131,13 @@ float calc_total_power(float voltage, float current, int num_branches) {
 /// and Ambient Temperature
 
 float calc_temp_rise (float inVoltage, float outVoltage, float curr, float rtja, float amb) {
-	float Vdrop = inVoltage - outVoltage;
-	//~ printf("Voltage Drop = %.4f Volts\n",Vdrop);
-	float pow_diss = Vdrop*curr;
+	PROF_BEGIN(prof_t);
+	float pow_diss = k_pow_diss(inVoltage, outVoltage, curr);
 	//~ printf("pow_diss = %.4f Watts\n",pow_diss);
-	float temp_rise = (rtja*pow_diss) + amb;
-	printf("rtja*pow_diss = %.4f Deg C\t\t",rtja*pow_diss);
-	printf("amb = %.2f Deg C\n",amb);
-	printf("Temperature Rise = %.4f Deg C\n",temp_rise);
+	float temp_rise = k_temp_rise(inVoltage, outVoltage, curr, rtja, amb);
+	PROF_END(PROF_TEMP_RISE, prof_t, 1);
+	REPORT("temp_rise", "rtja*pow_diss = %.4f Deg C\t\tamb = %.2f Deg C\nTemperature Rise = %.4f Deg C\n",
+		3, rtja*pow_diss, amb, temp_rise);
 	return temp_rise;
 }
 
@@ -174,9 +146,11 @@ float calc_temp_rise (float inVoltage, float outVoltage, float curr, float rtja,
 /// Generates a boolean output: 1 == true, 0 == false.
 
 int junct_temp_exceeded(float tempRise, float opJunct_Temp) {
+  PROF_BEGIN(prof_t);
   int result; 
-  result = (tempRise >= opJunct_Temp) ? true : false;
-  printf("Operating Junction Temp (%0.2f) Exceeded = %d\n",opJunct_Temp, result);
+  result = k_junct_temp_exceeded(tempRise, opJunct_Temp);
+  PROF_END(PROF_JUNCT_TEMP_EXCEEDED, prof_t, 1);
+  REPORT("junct_temp_exceeded", "Operating Junction Temp (%0.2f) Exceeded = %.0f\n", 2, opJunct_Temp, (double)result);
   return result;
 }
 
@@ -184,54 +158,55 @@ int junct_temp_exceeded(float tempRise, float opJunct_Temp) {
 /// Operating Junction Temperature (TJ) and the Temperature Rise.
 
 float temp_diff_OJT_TR(float tempRise, float opJunct_Temp) {
+  PROF_BEGIN(prof_t);
   float result; 
-  result = opJunct_Temp - tempRise;
-  printf("OJT (%0.2f) - Temp Rise (%0.4f) = %0.4f\n",opJunct_Temp,tempRise, result);
+  result = k_temp_diff_OJT_TR(tempRise, opJunct_Temp);
+  PROF_END(PROF_TEMP_DIFF_OJT_TR, prof_t, 1);
+  REPORT("temp_diff_OJT_TR", "OJT (%0.2f) - Temp Rise (%0.4f) = %0.4f\n", 3, opJunct_Temp, tempRise, result);
   return result;
 }
 
 ///=============================================== 
 /// LED array specific functions:
 
-/// Calculates and prints the LUX output of an LED array 
+/// Calculates, prints and returns the LUX output of an LED array 
 /// as a function of the current limiting resistor value
 
-void DE_ResToLux(float resistor) {
-	 const float Luxslope = 30;
-	 const int maxLux = 1900, minRes = 10;
-	 resistor = (resistor >= minRes) ? resistor : 10;
-	 float result = (maxLux - (resistor * Luxslope) >= 0) ? maxLux - (resistor * Luxslope) : 0;
-	 printf("LUX = %.2f\tlumen/m^2\t res = %.2f\n",result, resistor);
+float DE_ResToLux(float resistor) {
+	 PROF_BEGIN(prof_t);
+	 float result = k_ResToLux(resistor);
+	 PROF_END(PROF_RES_TO_LUX, prof_t, 1);
+	 REPORT("ResToLux", "LUX = %.2f\tlumen/m^2\t res = %.2f\n", 2, result, k_clamp_res(resistor));
+	 return result;
 }
 
-/// Calculates and prints the LUX output as a percentage of maximum 
+/// Calculates, prints and returns the LUX output as a percentage of maximum 
 /// of an LED array as a function of the current limiting resistor value
 
-void DE_ResToPercent(float resistor) {
-	 const float PercentSlope = 1.875;
-	 const float maxPercent = 118.75, minRes = 10;
-	 resistor = (resistor >= minRes) ? resistor : 10;
-	 float result = (maxPercent - (resistor * PercentSlope) >= 0) ? maxPercent - (resistor * PercentSlope) : 0;
-	 printf("Percent of Max = %.4f\t for resistor value = %.2f\n",result, resistor);
+float DE_ResToPercent(float resistor) {
+	 PROF_BEGIN(prof_t);
+	 float result = k_ResToPercent(resistor);
+	 PROF_END(PROF_RES_TO_PERCENT, prof_t, 1);
+	 REPORT("ResToPercent", "Percent of Max = %.4f\t for resistor value = %.2f\n", 2, result, k_clamp_res(resistor));
+	 return result;
 }
-/// Calculates and prints multiple useful values of an LED array 
+/// Calculates, prints and returns multiple useful values of an LED array 
 /// for circuit analysis purposes
 
-void DE_ResToAll(float resistor) {
-	 const float slope = 30;
-	 const int maxLux = 1900, minRes = 10;
-	 const float PercentSlope = 1.875;
-	 const float maxPercent = 118.75;
-	 resistor = (resistor >= minRes) ? resistor : 10;
-	 float LUX = (maxLux - (resistor * slope) >= 0) ? maxLux - (resistor * slope) : 0;
-	 float PERCENT = (maxPercent - (resistor * PercentSlope) >= 0) ? maxPercent - (resistor * PercentSlope) : 0;
-	 printf("LUX = %.2f\tlumen/m^2\t\t%% of Max = %.6f\tres = %.2f Ohms\n",LUX, PERCENT, resistor);
-	 //~ float PERCENT = (maxPercent - (resistor * PercentSlope) >= 0) ? maxPercent - (resistor * PercentSlope) : 0;
-	 //~ printf("Percent of Max = %.4f\t for resistor value = %.2f\n",PERCENT, resistor);
-	 //~ printf("\n");
+struct DE_result DE_ResToAll(float resistor) {
+	 PROF_BEGIN(prof_t);
+	 struct DE_result result = k_ResToAll(resistor);
+	 PROF_END(PROF_RES_TO_ALL, prof_t, 1);
+	 REPORT("ResToAll", "LUX = %.2f\tlumen/m^2\t\t%% of Max = %.6f\tres = %.2f Ohms\n",
+		3, result.lux, result.percent, result.res);
+	 return result;
 } 
 ///===============================================
+/// Stand-alone model runner. Built only for the circuit target
+/// (-DCIRCUIT_MAIN) so circuit.c can also be linked and included
+/// by other programs and by circuittest.
 
+#ifdef CIRCUIT_MAIN
 int main(int argc, char const *argv[]) {
 	printf("\nRunning Circuit Model Tests\n\n");
 	
@@ -336,3 +311,4 @@ int main(int argc, char const *argv[]) {
 		printf("\n");
 	} **/
 }
+#endif
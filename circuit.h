@@ -8,6 +8,8 @@
 	cesllc876@gmail.com
 **/
 
+#include "kernel.h"
+
 float calc_parallel_resistance(float resistor_value, int num_branches);
 float calc_total_power(float voltage, float current, int num_branches);
 float calc_var_resistance(float desired_res, float fixed_res);
@@ -19,9 +21,10 @@ float total_current(float voltage, float resistance, int num_branches);
 
 float calc_temp_rise (float inVoltage, float outVoltage, float curr, float rtja, float amb);
 int junct_temp_exceeded (float tempRise, float opJunct_Temp);
+float temp_diff_OJT_TR(float tempRise, float opJunct_Temp);
 
-void DE_ResToLux(float resistor);
-void DE_ResToPercent(float resistor);
-void DE_ResToAll(float resistor);
+float DE_ResToLux(float resistor);
+float DE_ResToPercent(float resistor);
+struct DE_result DE_ResToAll(float resistor);
 
 #endif
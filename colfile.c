@@ -0,0 +1,297 @@
+///	Package:	circuit
+///	File:		colfile.c
+///	Purpose:	Memory-mapped columnar files of chain results
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "kernel.h"
+#include "batch.h"
+#include "colfile.h"
+
+_Static_assert(sizeof(struct cf_column) == 48, "cf_column layout is part of the file format");
+_Static_assert(sizeof(struct cf_header) <= CF_HEADER_BYTES, "cf_header must fit CF_HEADER_BYTES");
+_Static_assert(sizeof(struct cf_block) == CF_ALIGN, "cf_block is the first CF_ALIGN bytes of a block");
+
+#define CF_NAME_OF(id, name, size) name,
+#define CF_SIZE_OF(id, name, size) size,
+static const char *const cf_type_names[] = { CF_TYPES(CF_NAME_OF) };
+static const size_t cf_type_sizes[] = { CF_TYPES(CF_SIZE_OF) };
+#undef CF_NAME_OF
+#undef CF_SIZE_OF
+
+const char *cf_type_name(enum cf_type t) {
+	 return (t < CF_NTYPES) ? cf_type_names[t] : "?";
+}
+
+/// 0 for a type that does not exist
+size_t cf_type_size(enum cf_type t) {
+	 return (t < CF_NTYPES) ? cf_type_sizes[t] : 0;
+}
+
+/// The columns of a C_batch, inputs then outputs, as cf_create_batch writes them
+static const struct cf_column_def cf_batch_cols[] = {
+	{ "v", CF_F32 }, { "r", CF_F32 }, { "num", CF_F32 }, { "fixed_res", CF_F32 },
+	{ "rtja", CF_F32 }, { "amb", CF_F32 }, { "ojt", CF_F32 },
+	{ "par_res", CF_F32 }, { "var_res", CF_F32 }, { "branch_i", CF_F32 }, { "total_i", CF_F32 },
+	{ "power", CF_F32 }, { "temp_rise", CF_F32 }, { "ojt_diff", CF_F32 },
+	{ "lux", CF_F32 }, { "percent", CF_F32 }, { "exceeded", CF_I32 } };
+#define CF_BATCH_NCOLS 	(sizeof cf_batch_cols / sizeof cf_batch_cols[0])
+
+static size_t cf_round(size_t n, size_t to) {
+	 return (n + to - 1) / to * to;
+}
+
+/// Column name of h, or -1
+static int cf_lookup(const struct cf_header *h, const char *name) {
+	 uint32_t k;
+	 for (k = 0; k < h->ncols; k++) {
+		 if (strncmp(h->cols[k].name, name, CF_NAME) == 0) return (int)k;
+	 }
+	 return -1;
+}
+
+static char *cf_block_at(char *map, const struct cf_header *h, size_t blk) {
+	 return map + CF_HEADER_BYTES + blk * h->block_bytes;
+}
+
+///===============================================
+/// Writing
+
+/** Creates, or empties, the file at path for the columns cols, in
+	blocks of block_rows rows. max_rows bounds what it can take, 0 for
+	CF_MAX_ROWS; that much address space is mapped up front, so the
+	mapping never moves and no pointer into it goes stale, but the file
+	only grows as blocks are reserved. Returns 0, or -1 on bad columns
+	or an I/O or mapping failure.
+**/
+int cf_create(struct cf_writer *w, const char *path, const struct cf_column_def *cols, size_t ncols,
+	size_t block_rows, uint64_t max_rows) {
+	 struct cf_header *h;
+	 size_t offset = sizeof(struct cf_block), k;
+	 void *map;
+
+	 memset(w, 0, sizeof *w);
+	 w->fd = -1;
+	 if (ncols == 0 || ncols > CF_MAX_COLS || block_rows == 0) return -1;
+	 for (k = 0; k < ncols; k++) {
+		 if (cf_type_size(cols[k].type) == 0 || strlen(cols[k].name) >= CF_NAME) return -1;
+		 offset += cf_round(block_rows * cf_type_size(cols[k].type), CF_ALIGN);
+	 }
+	 /// Blocks start on pages, so threads filling them never share one
+	 offset = cf_round(offset, CF_HEADER_BYTES);
+	 if (max_rows == 0) max_rows = CF_MAX_ROWS;
+	 w->max_blocks = (max_rows + block_rows - 1) / block_rows;
+	 if (w->max_blocks > (SIZE_MAX - CF_HEADER_BYTES) / offset) return -1;
+	 w->map_bytes = CF_HEADER_BYTES + w->max_blocks * offset;
+
+	 w->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	 if (w->fd < 0) return -1;
+	 map = MAP_FAILED;
+	 if (ftruncate(w->fd, CF_HEADER_BYTES) == 0)
+		 map = mmap(NULL, w->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, w->fd, 0);
+	 if (map == MAP_FAILED) {
+		 close(w->fd);
+		 memset(w, 0, sizeof *w);
+		 w->fd = -1;
+		 return -1;
+	 }
+	 w->map = map;
+	 w->hdr = h = map;
+	 w->file_bytes = CF_HEADER_BYTES;
+	 pthread_mutex_init(&w->grow, NULL);
+
+	 memcpy(h->magic, CF_MAGIC, sizeof h->magic);
+	 h->version = CF_VERSION;
+	 h->order = CF_ORDER;
+	 h->ncols = ncols;
+	 h->block_rows = block_rows;
+	 offset = sizeof(struct cf_block);
+	 for (k = 0; k < ncols; k++) {
+		 strcpy(h->cols[k].name, cols[k].name);
+		 h->cols[k].type = cols[k].type;
+		 h->cols[k].size = cf_type_size(cols[k].type);
+		 h->cols[k].offset = offset;
+		 offset += cf_round(block_rows * h->cols[k].size, CF_ALIGN);
+	 }
+	 h->block_bytes = cf_round(offset, CF_HEADER_BYTES);
+	 return 0;
+}
+
+/// A file of C_batch rows, for cf_batch_view
+int cf_create_batch(struct cf_writer *w, const char *path, size_t block_rows, uint64_t max_rows) {
+	 return cf_create(w, path, cf_batch_cols, CF_BATCH_NCOLS, block_rows, max_rows);
+}
+
+/** The next block, in *blk. The file is grown first if it ends short of
+	the block, CF_GROW at a time so most calls take no lock; the space is
+	allocated then, not page by page as blocks are written. Returns -1
+	once max_rows is used up or the file cannot grow.
+**/
+int cf_reserve(struct cf_writer *w, size_t *blk) {
+	 size_t k = atomic_fetch_add(&w->hdr->nblocks, 1);
+	 size_t end = CF_HEADER_BYTES + (k + 1) * w->hdr->block_bytes;
+	 int rc = 0;
+
+	 if (k >= w->max_blocks) return -1;
+	 if (end > atomic_load_explicit(&w->file_bytes, memory_order_acquire)) {
+		 pthread_mutex_lock(&w->grow);
+		 if (end > w->file_bytes) {
+			 size_t want = cf_round(w->file_bytes + CF_GROW, w->hdr->block_bytes);
+			 if (want < end) want = end;
+			 if (want > w->map_bytes) want = w->map_bytes;
+			 if (posix_fallocate(w->fd, w->file_bytes, want - w->file_bytes) == 0) atomic_store_explicit(&w->file_bytes, want, memory_order_release);
+			 else rc = -1;
+		 }
+		 pthread_mutex_unlock(&w->grow);
+	 }
+	 if (rc == 0) *blk = k;
+	 return rc;
+}
+
+/// Where column col of block blk goes: block_rows values of its type
+void *cf_column_ptr(struct cf_writer *w, size_t blk, size_t col) {
+	 return cf_block_at(w->map, w->hdr, blk) + w->hdr->cols[col].offset;
+}
+
+/** Points b's columns at block blk, so what is written to b, by
+	batch_run or anything else, is written to the file. b->cap is the
+	block's rows; nothing is allocated and b is not to be freed. Returns
+	-1 if the file lacks a C_batch column.
+**/
+int cf_batch_view(struct cf_writer *w, size_t blk, struct C_batch *b) {
+	 void *col[CF_BATCH_NCOLS];
+	 size_t k;
+
+	 for (k = 0; k < CF_BATCH_NCOLS; k++) {
+		 int c = cf_lookup(w->hdr, cf_batch_cols[k].name);
+		 if (c < 0 || w->hdr->cols[c].type != cf_batch_cols[k].type) return -1;
+		 col[k] = cf_column_ptr(w, blk, c);
+	 }
+	 b->n = 0;
+	 b->cap = w->hdr->block_rows;
+	 b->v = col[0];		b->r = col[1];		b->num = col[2];	b->fixed_res = col[3];
+	 b->rtja = col[4];	b->amb = col[5];	b->ojt = col[6];
+	 b->par_res = col[7];	b->var_res = col[8];	b->branch_i = col[9];	b->total_i = col[10];
+	 b->power = col[11];	b->temp_rise = col[12];	b->ojt_diff = col[13];
+	 b->lux = col[14];	b->percent = col[15];	b->exceeded = col[16];
+	 return 0;
+}
+
+/// Block blk is filled: rows rows, the first of them row first
+void cf_commit(struct cf_writer *w, size_t blk, uint64_t first, size_t rows) {
+	 struct cf_block *b = (struct cf_block *)cf_block_at(w->map, w->hdr, blk);
+	 b->first = first;
+	 b->rows = rows;
+	 atomic_store_explicit(&b->state, CF_BLOCK_DONE, memory_order_release);
+	 atomic_fetch_add(&w->hdr->rows, rows);
+}
+
+/// Cuts the file back to the blocks reserved and unmaps it. Every
+/// thread must be done with its blocks. Returns 0, or -1 on an I/O error.
+int cf_close(struct cf_writer *w) {
+	 size_t n;
+	 int rc = 0;
+
+	 if (w->hdr == NULL) return 0;
+	 n = w->hdr->nblocks;
+	 if (n > w->max_blocks) n = w->max_blocks;
+	 if (CF_HEADER_BYTES + n * w->hdr->block_bytes > w->file_bytes) n = (w->file_bytes - CF_HEADER_BYTES) / w->hdr->block_bytes;
+	 w->hdr->nblocks = n;
+	 if (ftruncate(w->fd, CF_HEADER_BYTES + n * w->hdr->block_bytes) != 0) rc = -1;
+	 munmap(w->map, w->map_bytes);
+	 if (close(w->fd) != 0) rc = -1;
+	 pthread_mutex_destroy(&w->grow);
+	 memset(w, 0, sizeof *w);
+	 w->fd = -1;
+	 return rc;
+}
+
+///===============================================
+/// Reading
+
+static int cf_header_ok(const struct cf_header *h, size_t bytes) {
+	 uint32_t k;
+	 if (memcmp(h->magic, CF_MAGIC, sizeof h->magic) != 0 || h->version != CF_VERSION || h->order != CF_ORDER)
+		 return 0;
+	 if (h->ncols == 0 || h->ncols > CF_MAX_COLS || h->block_rows == 0 || h->block_bytes < sizeof(struct cf_block))
+		 return 0;
+	 if (h->block_rows > bytes || h->block_bytes > bytes) return 0;
+	 for (k = 0; k < h->ncols; k++) {
+		 const struct cf_column *c = &h->cols[k];
+		 if (c->type >= CF_NTYPES || c->size != cf_type_size(c->type) || memchr(c->name, 0, CF_NAME) == NULL)
+			 return 0;
+		 if (c->offset < sizeof(struct cf_block) || c->offset % CF_ALIGN != 0
+			|| c->offset + h->block_rows * c->size > h->block_bytes)
+			 return 0;
+	 }
+	 return 1;
+}
+
+/// Maps the file at path to read. Returns 0, or -1 if it cannot be
+/// read or is not a column file this build understands.
+int cf_open(struct cf_reader *r, const char *path) {
+	 struct stat st;
+	 void *map;
+	 int fd = open(path, O_RDONLY);
+
+	 memset(r, 0, sizeof *r);
+	 if (fd < 0) return -1;
+	 if (fstat(fd, &st) != 0 || st.st_size < CF_HEADER_BYTES) {
+		 close(fd);
+		 return -1;
+	 }
+	 map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	 close(fd);
+	 if (map == MAP_FAILED) return -1;
+	 if (!cf_header_ok(map, st.st_size)) {
+		 munmap(map, st.st_size);
+		 return -1;
+	 }
+	 r->map = map;
+	 r->hdr = map;
+	 r->bytes = st.st_size;
+	 r->nblocks = (r->bytes - CF_HEADER_BYTES) / r->hdr->block_bytes;
+	 if (r->nblocks > r->hdr->nblocks) r->nblocks = r->hdr->nblocks;
+	 return 0;
+}
+
+void cf_reader_close(struct cf_reader *r) {
+	 if (r->map != NULL) munmap((void *)r->map, r->bytes);
+	 memset(r, 0, sizeof *r);
+}
+
+/// The column called name, or -1
+int cf_find(const struct cf_reader *r, const char *name) {
+	 return cf_lookup(r->hdr, name);
+}
+
+/** Column col of block blk: rows values of its type, the first of them
+	row first. NULL if there is no such block or column, or the block
+	was never committed.
+**/
+const void *cf_block_column(const struct cf_reader *r, size_t blk, int col, uint64_t *first, size_t *rows) {
+	 const struct cf_block *b;
+
+	 if (blk >= r->nblocks || col < 0 || (uint32_t)col >= r->hdr->ncols) return NULL;
+	 b = (const struct cf_block *)cf_block_at((char *)r->map, r->hdr, blk);
+	 if (atomic_load_explicit(&b->state, memory_order_acquire) != CF_BLOCK_DONE || b->rows > r->hdr->block_rows)
+		 return NULL;
+	 *first = b->first;
+	 *rows = b->rows;
+	 return (const char *)b + r->hdr->cols[col].offset;
+}
@@ -0,0 +1,145 @@
+// colfile.h //
+#ifndef COLFILE_H
+#define COLFILE_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "kernel.h"
+#include "batch.h"
+
+/** Columnar binary result files. The header says what is in the file:
+	the columns, each with a name and a type, and how many rows a block
+	holds. After it come the blocks, all the same size, each a small
+	block header and then every column's values for its rows, one run
+	per column:
+
+		header		CF_HEADER_BYTES
+		block 0		struct cf_block, column 0 rows, column 1 rows, ...
+		block 1		...
+
+	Blocks are whole pages. A reader wanting one column maps the file
+	and reads one run per block, skipping the rest without looking at
+	it. Values are in the writer's byte order, which the header records;
+	a reader on the other order refuses the file.
+
+	Writing is append-only and goes through the mapping. cf_reserve
+	hands out the next block, growing the file when it has to, and the
+	caller fills the block's columns in place, through cf_batch_view a
+	C_batch that runs the chain straight into the file. cf_commit then
+	marks it complete. Threads reserve and fill blocks at once; blocks
+	land in the order they were reserved, and each one records the
+	first row it holds, so a reader can put rows back in order.
+
+	A block that was reserved but never committed, because the writer
+	died, is skipped by readers.
+**/
+
+#define CF_MAGIC 		"LEDCOLS1"
+#define CF_VERSION 		1
+#define CF_HEADER_BYTES 	4096
+#define CF_MAX_COLS 		64
+#define CF_NAME 		32		// bytes per column name, NUL included
+#define CF_ALIGN 		64		// bytes, for each column run
+#define CF_ORDER 		0x01020304u	// as written, to tell the byte order
+#define CF_GROW 		(64 << 20)	// bytes the file grows by, at least
+#define CF_MAX_ROWS 		(1ULL << 32)	// default bound on rows
+
+/// Type, name, bytes
+#define CF_TYPES(X) \
+	X(CF_F32,	"f32",	4) \
+	X(CF_F64,	"f64",	8) \
+	X(CF_I32,	"i32",	4) \
+	X(CF_U64,	"u64",	8)
+
+#define CF_ID(id, name, size) id,
+enum cf_type {
+	CF_TYPES(CF_ID)
+	CF_NTYPES
+};
+#undef CF_ID
+
+/// A column as given to cf_create
+struct cf_column_def {
+    const char 		*name;
+    enum cf_type 	type;
+};
+
+/// A column as stored, 48 bytes
+struct cf_column {
+    char 	name[CF_NAME];
+    uint32_t 	type;		// enum cf_type
+    uint32_t 	size;		// bytes per value
+    uint64_t 	offset;		// of its run, from the start of a block
+};
+
+/// The start of the file
+struct cf_header {
+    char 		magic[8];
+    uint32_t 		version;
+    uint32_t 		order;		// CF_ORDER
+    uint32_t 		ncols;
+    uint32_t 		reserved;
+    uint64_t 		block_rows;
+    uint64_t 		block_bytes;
+    _Atomic uint64_t 	nblocks;	// reserved so far
+    _Atomic uint64_t 	rows;		// committed so far
+    uint8_t 		pad[8];
+    struct cf_column 	cols[CF_MAX_COLS];
+};
+
+enum cf_block_state {
+    CF_BLOCK_OPEN = 0,
+    CF_BLOCK_DONE
+};
+
+/// The first CF_ALIGN bytes of a block
+struct cf_block {
+    uint64_t 		first;		// row number of its first row
+    uint64_t 		rows;
+    _Atomic uint32_t 	state;		// enum cf_block_state
+    uint8_t 		pad[CF_ALIGN - 20];
+};
+
+struct cf_writer {
+    struct cf_header 	*hdr;
+    char 		*map;
+    size_t 		map_bytes;	// address space reserved
+    size_t 		max_blocks;
+    _Atomic size_t 	file_bytes;
+    pthread_mutex_t 	grow;
+    int 		fd;
+};
+
+struct cf_reader {
+    const struct cf_header 	*hdr;
+    const char 			*map;
+    size_t 			bytes;
+    size_t 			nblocks;	// whole blocks in the file
+};
+
+const char *cf_type_name(enum cf_type t);
+size_t cf_type_size(enum cf_type t);
+
+int cf_create(struct cf_writer *w, const char *path, const struct cf_column_def *cols, size_t ncols,
+	size_t block_rows, uint64_t max_rows);
+int cf_create_batch(struct cf_writer *w, const char *path, size_t block_rows, uint64_t max_rows);
+int cf_reserve(struct cf_writer *w, size_t *blk);
+void *cf_column_ptr(struct cf_writer *w, size_t blk, size_t col);
+int cf_batch_view(struct cf_writer *w, size_t blk, struct C_batch *b);
+void cf_commit(struct cf_writer *w, size_t blk, uint64_t first, size_t rows);
+int cf_close(struct cf_writer *w);
+
+int cf_open(struct cf_reader *r, const char *path);
+void cf_reader_close(struct cf_reader *r);
+int cf_find(const struct cf_reader *r, const char *name);
+const void *cf_block_column(const struct cf_reader *r, size_t blk, int col, uint64_t *first, size_t *rows);
+
+#endif
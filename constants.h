@@ -0,0 +1,54 @@
+// constants.h //
+#ifndef CONSTANTS_H
+#define CONSTANTS_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** The physical constants and SI prefixes, once for the whole project.
+	Every value is a double literal, or a parenthesized expression of
+	them that the compiler folds while it builds, so none costs a pow()
+	or a division at run time and all of them can go in static
+	initializers. Every one is parenthesized, so x / EPSILON_0 divides
+	by epsilon_0 and not by 1.
+**/
+
+/// STANDARD DEFINITIONS FOR PROJECT SCICALC
+#define PI		3.14159265358979323846 	// ad infinitum
+#define LIGHT_SPEED	299792458.0 		// meters per second, exact
+#define DATA_SIZE 	1000
+#define DELTA 		1.0e-6
+
+/// SI prefixes
+#define PICO 		1.0e-12
+#define NANO 		1.0e-9
+#define MICRO 		1.0e-6
+#define MILLI 		1.0e-3
+#define KILO 		1.0e3
+#define MEGA 		1.0e6
+#define GIGA 		1.0e9
+#define TERA 		1.0e12
+
+/// Power ratios of 3, 6 and 9 dB, 10^(dB/10)
+#define HALF 		2.0
+#define FOURTH 		4.0
+#define EIGHTH 		8.0
+
+/// STANDARD DEFINITIONS FOR LIGHT INTENSITY AND ELECTRIC FIELD CALCULATIONS
+#define AIR_REFRACTIVE_INDEX 	1.00027717
+#define E0 		(8.8541878128e-12)	// Permittivity of Free Space in Farads per meter, CODATA 2018
+#define MU0 		(1.25663706212e-6)	// Permeability of Free Space in Newtons per square Ampere
+#define EPSILON_0 	(1/(MU0*(LIGHT_SPEED*LIGHT_SPEED)))	// Permittivity of Free Space Equation
+#define E_CONSTANT 	(1/(4*PI*EPSILON_0))	// Coulomb constant, Newton square meters per square Coulomb
+#define ELECTRON_CHARGE 	1.6e-19 	// Charge of an electron in Coulombs
+#define RADIUS_HELIUM_ATOM 	26.5e-12	// Radius of a Helium atom in meters
+#define LED_ARRAY_RADIUS 	0.35 		// meters from LED array to sample plate
+
+/// STANDARD DEFINITIONS FOR PHOTOMETRY
+#define KM_PHOTOPIC 	683.002 	// lumens per Watt at the peak of V(lambda), 555 nm
+#define KM_SCOTOPIC 	1700.06 	// lumens per Watt at the peak of V'(lambda), 507 nm
+
+#endif
@@ -0,0 +1,87 @@
+///	Package:	circuit
+///	File:		cpu.c
+///	Purpose:	CPU feature detection and kernel variant selection
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "cpu.h"
+
+#define CPU_NAME(id, name) name,
+static const char *cpu_names[CPU_NISA] = { CPU_ISAS(CPU_NAME) };
+#undef CPU_NAME
+
+/// The variant in use, -1 until the first cpu_isa()
+static int cpu_active = -1;
+
+const char *cpu_isa_name(enum cpu_isa isa) {
+	 return (isa >= 0 && isa < CPU_NISA) ? cpu_names[isa] : "?";
+}
+
+/// The variant called name, or -1
+int cpu_isa_parse(const char *name) {
+	 int k;
+	 for (k = 0; name != NULL && k < CPU_NISA; k++) {
+		 if (strcmp(name, cpu_names[k]) == 0) return k;
+	 }
+	 return -1;
+}
+
+///===============================================
+/// 1 if this CPU, and the OS, run the variant. The cpuid checks of
+/// __builtin_cpu_supports include the OS saving the AVX registers.
+
+int cpu_isa_supported(enum cpu_isa isa) {
+#if defined(__x86_64__) || defined(__i386__)
+	 __builtin_cpu_init();
+	 switch (isa) {
+		case CPU_BASE:		return 1;
+		case CPU_SSE42:		return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+		case CPU_AVX2:		return __builtin_cpu_supports("avx2");
+		case CPU_AVX512:	return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+						&& __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq");
+		default:		return 0;
+	 }
+#else
+	 return isa == CPU_BASE;
+#endif
+}
+
+enum cpu_isa cpu_isa_best(void) {
+	 int k;
+	 for (k = CPU_NISA - 1; k > CPU_BASE; k--) {
+		 if (cpu_isa_supported(k)) return k;
+	 }
+	 return CPU_BASE;
+}
+
+///===============================================
+/// The variant the kernels run: CPU_ISA if it names one this CPU has,
+/// else the best one. Chosen once; threads racing on the first call all
+/// arrive at the same answer.
+
+enum cpu_isa cpu_isa(void) {
+	 int isa = __atomic_load_n(&cpu_active, __ATOMIC_RELAXED);
+	 if (isa < 0) {
+		 isa = cpu_isa_parse(getenv("CPU_ISA"));
+		 if (isa < 0 || !cpu_isa_supported(isa)) isa = cpu_isa_best();
+		 __atomic_store_n(&cpu_active, isa, __ATOMIC_RELAXED);
+	 }
+	 return isa;
+}
+
+/// Switches every kernel to isa. Returns 0, or -1 if the CPU lacks it.
+/// Meant for tests and benchmarks, between runs rather than during one.
+int cpu_isa_set(enum cpu_isa isa) {
+	 if (isa < 0 || isa >= CPU_NISA || !cpu_isa_supported(isa)) return -1;
+	 __atomic_store_n(&cpu_active, (int)isa, __ATOMIC_RELAXED);
+	 return 0;
+}
@@ -0,0 +1,77 @@
+// cpu.h //
+#ifndef CPU_H
+#define CPU_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** Runtime CPU dispatch. The batch circuit, thermal and irradiance
+	kernels are compiled once per variant below and the best one the
+	CPU runs is picked on first use, so one binary serves every box.
+	CPU_BASE	plain x86-64 (SSE2), and any other architecture
+	CPU_SSE42	SSE4.2 and POPCNT
+	CPU_AVX2	AVX2, 256-bit vectors
+	CPU_AVX512	AVX-512 F, VL, BW and DQ, 512-bit vectors
+
+	Every variant gives the base results bit for bit. None of them uses
+	FMA: a fused multiply-add rounds once where the base code rounds
+	twice. AVX-512 implies FMA to the compiler, so make-test.mk builds
+	with -ffp-contract=off to keep it from fusing them on its own.
+
+	CPU_ISA=base|sse4.2|avx2|avx512 in the environment forces a variant
+	for testing. A variant the CPU lacks, or an unknown name, falls back
+	to the best one it has, so the override can never crash a run.
+**/
+
+/// Variant, name
+#define CPU_ISAS(X) \
+	X(CPU_BASE,	"base") \
+	X(CPU_SSE42,	"sse4.2") \
+	X(CPU_AVX2,	"avx2") \
+	X(CPU_AVX512,	"avx512")
+
+#define CPU_ID(id, name) id,
+enum cpu_isa {
+	CPU_ISAS(CPU_ID)
+	CPU_NISA
+};
+#undef CPU_ID
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_TARGET_SSE42 	__attribute__((target("sse4.2,popcnt")))
+#define CPU_TARGET_AVX2 	__attribute__((target("avx2")))
+#define CPU_TARGET_AVX512 	__attribute__((target("avx512f,avx512vl,avx512bw,avx512dq,prefer-vector-width=512")))
+#else
+#define CPU_TARGET_SSE42
+#define CPU_TARGET_AVX2
+#define CPU_TARGET_AVX512
+#endif
+
+///===============================================
+/// A kernel body is written once as a CPU_KERNEL function, NAME_body.
+/// CPU_CLONES(NAME, PARAMS, ARGS) then stamps out one copy of it per
+/// variant, each compiled for its own target, and the table
+/// NAME[CPU_NISA] of them; call NAME[cpu_isa()] ARGS. PARAMS and ARGS
+/// are parenthesized. The body must be inlined whole into each copy,
+/// hence always_inline, or it would run as the base code everywhere.
+
+#define CPU_KERNEL 	static inline __attribute__((always_inline))
+
+#define CPU_CLONES(NAME, PARAMS, ARGS) \
+static void NAME##_base PARAMS { NAME##_body ARGS; } \
+CPU_TARGET_SSE42 static void NAME##_sse42 PARAMS { NAME##_body ARGS; } \
+CPU_TARGET_AVX2 static void NAME##_avx2 PARAMS { NAME##_body ARGS; } \
+CPU_TARGET_AVX512 static void NAME##_avx512 PARAMS { NAME##_body ARGS; } \
+static void (*const NAME[CPU_NISA]) PARAMS = { NAME##_base, NAME##_sse42, NAME##_avx2, NAME##_avx512 };
+
+const char *cpu_isa_name(enum cpu_isa isa);
+int cpu_isa_parse(const char *name);
+int cpu_isa_supported(enum cpu_isa isa);
+enum cpu_isa cpu_isa_best(void);
+enum cpu_isa cpu_isa(void);
+int cpu_isa_set(enum cpu_isa isa);
+
+#endif
@@ -0,0 +1,221 @@
+///	Package:	intensity
+///	File:		curve.c
+///	Purpose:	Table-driven LED response curves with a checked error bound
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * Catmull and Rom, "A class of local interpolating splines", 1974
+ * https://en.wikipedia.org/wiki/Cubic_Hermite_spline#Catmull%E2%80%93Rom_spline
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include "kernel.h"
+#include "curve.h"
+
+#define CURVE_MIN_N 	4
+#define CURVE_BLOCK 	8	// lookups per vectorized block
+
+///===============================================
+/// Allocates an n point table over [x0, x1]. Returns 0 or -1.
+
+static int curve_alloc(struct curve *c, size_t n, float x0, float x1, enum curve_interp interp) {
+	 float *pad;
+	 memset(c, 0, sizeof *c);
+	 if (n < CURVE_MIN_N || !(x1 > x0)) return -1;
+	 pad = malloc((n + 2) * sizeof *pad);
+	 if (pad == NULL) return -1;
+	 c->interp = interp;
+	 c->n = n;
+	 c->x0 = x0;
+	 c->x1 = x1;
+	 c->inv_dx = (float)((n - 1) / ((double)x1 - x0));
+	 c->y = pad + 1;
+	 return 0;
+}
+
+///===============================================
+/// Extends the ends linearly into the padding samples.
+
+static void curve_pad(struct curve *c) {
+	 size_t n = c->n;
+	 c->y[-1] = 2 * c->y[0] - c->y[1];
+	 c->y[n] = 2 * c->y[n - 1] - c->y[n - 2];
+}
+
+///===============================================
+/// Builds a table from samples y[0..n-1] taken at n evenly spaced points
+/// from x0 to x1, e.g. a measured curve. Returns 0 or -1.
+
+int curve_build_samples(struct curve *c, const float *y, size_t n, float x0, float x1,
+	enum curve_interp interp) {
+	 if (curve_alloc(c, n, x0, x1, interp) != 0) return -1;
+	 memcpy(c->y, y, n * sizeof *y);
+	 curve_pad(c);
+	 return 0;
+}
+
+///===============================================
+/// Bound on |table - f| over [x0, x1], given |f''| <= d2 there except at
+/// points of the table's grid, where f may have kinks. The error e is
+/// measured at CURVE_CHECK points per interval. Between two check points
+/// |e''| <= d2 + the table's own |p''|, which is 0 for linear and exact
+/// from the four samples for Catmull-Rom, so |e| there is at most the
+/// larger end plus that times h^2 / 8. Each lookup in float may be off
+/// the exact interpolant by a few ulps of the samples it reads and of
+/// its position, which is added at the check points and between them.
+
+double curve_error(const struct curve *c, curve_fn f, void *ctx, double d2) {
+	 size_t n = c->n, i, j;
+	 double dx = ((double)c->x1 - c->x0) / (n - 1), h = dx / CURVE_CHECK;
+	 double span = fabs(c->x0) + fabs(c->x1), worst = 0, prev;
+
+	 prev = fabs(curve_eval(c, c->x0) - f(c->x0, ctx));
+	 for (i = 0; i + 1 < n; i++) {
+		 const float *y = c->y + i;
+		 double p1, p2, mag, round;
+		 if (c->interp == CURVE_LINEAR) {
+			 p1 = fabs((double)y[1] - y[0]) / dx;
+			 p2 = 0;
+			 mag = fabs(y[0]) + fabs(y[1]);
+		 } else {
+			 /// p(t) = y0 + (c1 t + c2 t^2 + c3 t^3) / 2, so p'' is linear in t
+			 double c1 = (double)y[1] - y[-1];
+			 double c2 = 2.0 * y[-1] - 5.0 * y[0] + 4.0 * y[1] - y[2];
+			 double c3 = 3.0 * ((double)y[0] - y[1]) + y[2] - y[-1];
+			 p1 = 0.5 * (fabs(c1) + 2 * fabs(c2) + 3 * fabs(c3)) / dx;
+			 p2 = fmax(fabs(c2), fabs(c2 + 3 * c3)) / (dx * dx);
+			 mag = fabs(y[-1]) + fabs(y[0]) + fabs(y[1]) + fabs(y[2]);
+		 }
+		 round = 2 * FLT_EPSILON * (p1 * span + mag);
+		 for (j = 1; j <= CURVE_CHECK; j++) {
+			 double x = c->x0 + h * (double)(i * CURVE_CHECK + j);
+			 double e = fabs(curve_eval(c, (float)x) - f(x, ctx));
+			 double bound = fmax(prev, e) + (d2 + p2) * h * h / 8 + 2 * round;
+			 if (bound > worst) worst = bound;
+			 prev = e;
+		 }
+	 }
+	 return worst;
+}
+
+///===============================================
+/// Tabulates f over [x0, x1] on n points, doubling the number of
+/// intervals until curve_error is within tol or the next grid would pass
+/// max_n points. d2 is as for curve_error; doubling keeps the first
+/// grid's points, so kinks placed on them stay allowed. Returns 0 when tol is met, otherwise -1 (c then holds
+/// the finest table tried, with its max_err, or nothing if memory ran out).
+
+int curve_build(struct curve *c, curve_fn f, void *ctx, double d2, float x0, float x1,
+	enum curve_interp interp, double tol, size_t n, size_t max_n) {
+	 size_t i;
+
+	 for (;;) {
+		 if (curve_alloc(c, n, x0, x1, interp) != 0) return -1;
+		 for (i = 0; i < n; i++) c->y[i] = (float)f(x0 + ((double)x1 - x0) * i / (n - 1), ctx);
+		 curve_pad(c);
+		 c->max_err = curve_error(c, f, ctx, d2);
+		 if (c->max_err <= tol) return 0;
+		 if (2 * n - 1 > max_n) return -1;
+		 curve_free(c);
+		 n = 2 * n - 1;
+	 }
+}
+
+///===============================================
+
+void curve_free(struct curve *c) {
+	 if (c->y != NULL) free(c->y - 1);
+	 memset(c, 0, sizeof *c);
+}
+
+///===============================================
+/// One table lookup of curve_eval_batch. The clamps compile to min/max
+/// and the index limit to a select, so nothing branches on the data.
+
+#define CURVE_LOOKUP(k) \
+	 float u = (x[k] - x0) * inv_dx, f; \
+	 int i; \
+	 u = (u < 0.0f) ? 0.0f : u; \
+	 u = (u < last) ? u : last; \
+	 i = (int)u; \
+	 i = (i > top) ? top : i; \
+	 f = u - (float)i
+
+#define CURVE_LINEAR_AT(k) \
+	 y[k] = t[i] + f * (t[i + 1] - t[i])
+
+#define CURVE_CUBIC_AT(k) \
+	 y[k] = t[i] + 0.5f * f * (t[i + 1] - t[i - 1] + f * (2.0f * t[i - 1] - 5.0f * t[i] \
+		+ 4.0f * t[i + 1] - t[i + 2] + f * (3.0f * (t[i] - t[i + 1]) + t[i + 2] - t[i - 1])))
+
+///===============================================
+/// y[k] = curve_eval(c, x[k]) for a whole column, e.g. b->r into b->lux
+/// of a C_batch. Runs in fixed blocks of CURVE_BLOCK so the compiler can
+/// vectorize each block without a remainder loop.
+
+void curve_eval_batch(const struct curve *c, const float *restrict x, float *restrict y, size_t n) {
+	 const float *restrict t = c->y;
+	 float x0 = c->x0, inv_dx = c->inv_dx, last = (float)(c->n - 1);
+	 int top = (int)c->n - 2;
+	 size_t k = 0, j;
+
+	 if (c->interp == CURVE_LINEAR) {
+		 for (; k + CURVE_BLOCK <= n; k += CURVE_BLOCK) {
+			 for (j = k; j < k + CURVE_BLOCK; j++) { CURVE_LOOKUP(j); CURVE_LINEAR_AT(j); }
+		 }
+		 for (; k < n; k++) { CURVE_LOOKUP(k); CURVE_LINEAR_AT(k); }
+		 return;
+	 }
+	 for (; k + CURVE_BLOCK <= n; k += CURVE_BLOCK) {
+		 for (j = k; j < k + CURVE_BLOCK; j++) { CURVE_LOOKUP(j); CURVE_CUBIC_AT(j); }
+	 }
+	 for (; k < n; k++) { CURVE_LOOKUP(k); CURVE_CUBIC_AT(k); }
+}
+
+///===============================================
+/// The clamp-and-slope LED model as curve sources, in double so they are
+/// exactly straight between the kinks.
+
+static double curve_led_line(double r, double max, double slope) {
+	 double y = max - ((r >= DE_MIN_RES) ? r : DE_MIN_RES) * slope;
+	 return (y >= 0) ? y : 0;
+}
+
+static double curve_led_lux(double r, void *ctx) {
+	 return curve_led_line(r, DE_MAX_LUX, DE_LUX_SLOPE);
+}
+
+static double curve_led_percent(double r, void *ctx) {
+	 return curve_led_line(r, DE_MAX_PERCENT, DE_PERCENT_SLOPE);
+}
+
+///===============================================
+/// Tables of DE_ResToLux and DE_ResToPercent over 0 .. DE_MAX_LUX /
+/// DE_LUX_SLOPE Ohms, where both reach 0, each within tol of its full
+/// scale (DE_MAX_LUX, DE_MAX_PERCENT). Inputs above the range clamp to 0
+/// and inputs below DE_MIN_RES to the flat top, as in the model. Either
+/// table may be NULL. The grids are multiples of 19 intervals so both
+/// kinks, at DE_MIN_RES and at the top of the range, fall on grid points,
+/// and between them the source is straight, d2 = 0.
+/// Returns 0, or -1 if a table could not be built within tol.
+
+int curve_led(struct curve *lux, struct curve *percent, enum curve_interp interp, double tol) {
+	 float top = DE_MAX_LUX / DE_LUX_SLOPE;
+	 size_t n = 19 + 1, max_n = 19 * 4096 + 1;
+	 if (lux != NULL && curve_build(lux, curve_led_lux, NULL, 0, 0, top, interp,
+		tol * DE_MAX_LUX, n, max_n) != 0) return -1;
+	 if (percent != NULL && curve_build(percent, curve_led_percent, NULL, 0, 0, top, interp,
+		tol * DE_MAX_PERCENT, n, max_n) != 0) return -1;
+	 return 0;
+}
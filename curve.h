@@ -0,0 +1,69 @@
+// curve.h //
+#ifndef CURVE_H
+#define CURVE_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+
+#define CURVE_CHECK 	16	// error check points per table interval
+
+enum curve_interp {
+    CURVE_LINEAR = 0,
+    CURVE_CUBIC			// Catmull-Rom, passes through every sample
+};
+
+typedef double (*curve_fn)(double x, void *ctx);
+
+/** A response curve tabulated on a uniform grid of n points over [x0, x1].
+	Inputs outside the grid clamp to the end values. y has one padding
+	sample on each side so cubic interpolation never needs a bounds test.
+	max_err bounds |table - source| over [x0, x1] for tables built from a
+	function whose second derivative is bounded as curve_build is told
+	(see curve_error), and is 0 for tables of measured samples.
+**/
+struct curve {
+    enum curve_interp 	interp;
+    size_t 		n;
+    float 		x0;
+    float 		x1;
+    float 		inv_dx;		// (n - 1) / (x1 - x0)
+    float 		*y;		// y[-1] .. y[n]
+    double 		max_err;
+};
+
+int curve_build(struct curve *c, curve_fn f, void *ctx, double d2, float x0, float x1,
+	enum curve_interp interp, double tol, size_t n, size_t max_n);
+int curve_build_samples(struct curve *c, const float *y, size_t n, float x0, float x1,
+	enum curve_interp interp);
+double curve_error(const struct curve *c, curve_fn f, void *ctx, double d2);
+void curve_free(struct curve *c);
+void curve_eval_batch(const struct curve *c, const float *restrict x, float *restrict y, size_t n);
+int curve_led(struct curve *lux, struct curve *percent, enum curve_interp interp, double tol);
+
+///===============================================
+/// One lookup. Branch-free apart from the interpolation choice, which is
+/// the same for every call on a table.
+
+static inline float curve_eval(const struct curve *c, float x) {
+	 float last = (float)(c->n - 1);
+	 float t = (x - c->x0) * c->inv_dx;
+	 int i;
+	 const float *y;
+	 float f;
+	 t = (t > 0.0f) ? t : 0.0f;
+	 t = (t < last) ? t : last;
+	 i = (int)t;
+	 i = (i > (int)c->n - 2) ? (int)c->n - 2 : i;
+	 f = t - (float)i;
+	 y = c->y + i;
+	 if (c->interp == CURVE_LINEAR) return y[0] + f * (y[1] - y[0]);
+	 return y[0] + 0.5f * f * (y[1] - y[-1] + f * (2.0f * y[-1] - 5.0f * y[0] + 4.0f * y[1] - y[2]
+		+ f * (3.0f * (y[0] - y[1]) + y[2] - y[-1])));
+}
+
+#endif
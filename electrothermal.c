@@ -0,0 +1,298 @@
+///	Package:	circuit
+///	File:		electrothermal.c
+///	Purpose:	Coupled circuit / thermal operating point with tempcos
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * Walker and Ni, "Anderson Acceleration for Fixed-Point Iterations",
+ *	SIAM J. Numer. Anal., 2011 (depth 1 is the secant method)
+**/
+
+/** The operating point is the junction temperature T where
+		T = chain(T) = amb + rtja * v(T) * num * v(T) / r(T),
+	the same power and temperature rise k_chain computes, with v and r
+	taken at T. Plain substitution T <- chain(T) converges only as fast
+	as the loop gain chain'(T) falls off, and not at all once it nears 1.
+	Instead each point is started with one plain step from amb and then
+	updated with secant steps on f(T) = chain(T) - T, which is Anderson
+	acceleration of depth 1.
+
+	Runaway: while f > 0 the junction is still heating up. If f has
+	risen over the last step as well, the loop gain is above 1 there,
+	and with power rising faster than linearly in T (any tempco that
+	raises the current with temperature) it stays so, so there is no
+	operating point above. The same is reported when T passes the
+	runaway limit or r(T) drops to 0. A flat f is not taken as runaway:
+	within a few ulps of the root f is rounding noise, and a step that
+	rounds back to T itself leaves the point stuck short of tol, which
+	is reported as not converged.
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "batch.h"
+#include "pool.h"
+#include "electrothermal.h"
+#include "prof.h"
+
+#define ET_TOL 		1e-3f
+#define ET_ITER 	50		// default max_iter
+
+/// Lane state codes; 0 is still iterating
+enum { ET_ACTIVE = 0, ET_S_CONVERGED, ET_S_MAX_ITER, ET_S_RUNAWAY };
+
+/// One block of design points, a column per quantity
+struct et_lanes {
+    float 	v[ET_BLOCK];		// at t_ref
+    float 	r[ET_BLOCK];		// at t_ref
+    float 	num[ET_BLOCK];
+    float 	rtja[ET_BLOCK];
+    float 	amb[ET_BLOCK];
+    float 	t0[ET_BLOCK];		// previous iterate and its residual
+    float 	f0[ET_BLOCK];
+    float 	t1[ET_BLOCK];		// current iterate and its residual
+    float 	f1[ET_BLOCK];
+    int32_t 	state[ET_BLOCK];
+    int32_t 	iters[ET_BLOCK];
+};
+
+struct et_params {
+    float 	tc_v, tc_r, t_ref;
+    float 	tol, runaway;
+    int 	max_iter;
+};
+
+struct et_job {
+    struct C_batch 		*b;
+    const struct et_params 	*p;
+    struct et_point 		*pts;
+    struct et_summary 		*sums;		// one per block
+};
+
+///===============================================
+/// Defaults filled in, shared by every block.
+
+static void et_params(const struct et_tempco *tc, const struct et_config *cfg, struct et_params *p) {
+	 p->tc_v = tc ? tc->tc_v : 0;
+	 p->tc_r = tc ? tc->tc_r : 0;
+	 p->t_ref = (tc && tc->t_ref != 0) ? tc->t_ref : ROOM_TEMP1;
+	 p->tol = (cfg && cfg->tol > 0) ? cfg->tol : ET_TOL;
+	 p->max_iter = (cfg && cfg->max_iter > 0) ? cfg->max_iter : ET_ITER;
+	 p->runaway = (cfg && cfg->runaway != 0) ? cfg->runaway : ET_RUNAWAY_TEMP;
+}
+
+///===============================================
+/// Residual f = chain(T) - T of every lane at T = t, into f. The power
+/// and rise are written as in k_chain.
+
+static void et_residual(struct et_lanes *restrict w, const struct et_params *p,
+	const float *restrict t, float *restrict f) {
+	 float tc_v = p->tc_v, tc_r = p->tc_r, t_ref = p->t_ref;
+	 int l;
+	 for (l = 0; l < ET_BLOCK; l++) {
+		 float dt = t[l] - t_ref;
+		 float v = w->v[l] + tc_v * dt, r = w->r[l] * (1 + tc_r * dt);
+		 float ti = w->num[l] * (v / r);
+		 f[l] = (w->rtja[l] * ((v - 0) * ti) + w->amb[l]) - t[l];
+	 }
+}
+
+///===============================================
+/// One secant step for every lane still iterating, after its residual at
+/// t1 is known: convergence and runaway checks, then the update.
+
+static void et_step(struct et_lanes *restrict w, const struct et_params *p) {
+	 float tol = p->tol, runaway = p->runaway, tc_r = p->tc_r, t_ref = p->t_ref;
+	 int l;
+	 for (l = 0; l < ET_BLOCK; l++) {
+		 float t0 = w->t0[l], t1 = w->t1[l], f0 = w->f0[l], f1 = w->f1[l];
+		 float df = f1 - f0, rt = w->r[l] * (1 + tc_r * (t1 - t_ref));
+		 float q = (df != 0) ? df : 1.0f;
+		 float tn = (df != 0) ? t1 - f1 * ((t1 - t0) / q) : t1 + f1;
+		 int32_t s = w->state[l], active = (s == ET_ACTIVE);
+		 int32_t conv = (f1 <= tol) & (f1 >= -tol);
+		 int32_t run = !(t1 <= runaway) | !(rt > 0) | ((f1 > 0) & (df * (t1 - t0) > 0));
+		 /// A step below one ulp of T: stuck short of tol, not diverging
+		 int32_t stall = (!conv) & (!run) & (t1 == t0);
+		 int32_t moving = active & !conv & !run & !stall;
+		 /// State as arithmetic on the flags, so the loop if-converts
+		 w->state[l] = s + active * (conv * ET_S_CONVERGED + ((!conv) & run) * ET_S_RUNAWAY + stall * ET_S_MAX_ITER);
+		 w->iters[l] += moving;
+		 w->t0[l] = moving ? t1 : t0;
+		 w->f0[l] = moving ? f1 : f0;
+		 w->t1[l] = moving ? tn : t1;
+	 }
+}
+
+///===============================================
+/// Iterates every lane to a status. Unused lanes are zero power at 0
+/// deg C and converge at once.
+
+static void et_iterate(struct et_lanes *w, const struct et_params *p) {
+	 int it, l;
+
+	 /// Plain first step from ambient
+	 memcpy(w->t0, w->amb, sizeof w->t0);
+	 et_residual(w, p, w->t0, w->f0);
+	 for (l = 0; l < ET_BLOCK; l++) {
+		 w->t1[l] = w->t0[l] + w->f0[l];
+		 w->state[l] = ET_ACTIVE;
+		 w->iters[l] = 1;
+	 }
+	 for (it = 1; it <= p->max_iter; it++) {
+		 int active = 0;
+		 et_residual(w, p, w->t1, w->f1);
+		 et_step(w, p);
+		 for (l = 0; l < ET_BLOCK; l++) active += (w->state[l] == ET_ACTIVE);
+		 if (active == 0) break;
+	 }
+	 for (l = 0; l < ET_BLOCK; l++) {
+		 if (w->state[l] == ET_ACTIVE) {
+			 w->state[l] = ET_S_MAX_ITER;
+			 w->iters[l] = p->max_iter;
+		 }
+	 }
+}
+
+///===============================================
+/// Lane l's result: the chain rerun with v and r at the final T.
+
+static void et_finish(const struct et_lanes *w, int l, const struct C_design *d, const struct et_params *p,
+	struct C_result *out, struct et_point *pt) {
+	 struct C_design hot = *d;
+	 float dt = w->t1[l] - p->t_ref;
+	 hot.v = d->v + p->tc_v * dt;
+	 hot.r = d->r * (1 + p->tc_r * dt);
+	 k_chain(&hot, out);
+	 pt->tj = w->t1[l];
+	 pt->v = hot.v;
+	 pt->r = hot.r;
+	 pt->iterations = w->iters[l];
+	 pt->status = (w->state[l] == ET_S_CONVERGED) ? ET_CONVERGED :
+		(w->state[l] == ET_S_RUNAWAY) ? ET_RUNAWAY : ET_MAX_ITER;
+}
+
+static void et_count(struct et_summary *sum, const struct et_point *pt) {
+	 sum->points++;
+	 sum->converged += (pt->status == ET_CONVERGED);
+	 sum->max_iter += (pt->status == ET_MAX_ITER);
+	 sum->runaway += (pt->status == ET_RUNAWAY);
+	 sum->iterations += (size_t)pt->iterations;
+	 if (pt->iterations > sum->worst) sum->worst = pt->iterations;
+}
+
+///===============================================
+/// Operating point of one design. Returns 0 if it converged, -1
+/// otherwise; out and pt are filled in either way.
+
+int et_solve(const struct C_design *d, const struct et_tempco *tc, const struct et_config *cfg,
+	struct C_result *out, struct et_point *pt) {
+	 struct et_lanes w;
+	 struct et_params p;
+	 int l;
+
+	 et_params(tc, cfg, &p);
+	 memset(&w, 0, sizeof w);
+	 for (l = 0; l < ET_BLOCK; l++) w.r[l] = 1;
+	 w.v[0] = d->v;
+	 w.r[0] = d->r;
+	 w.num[0] = (float)(int)d->num;
+	 w.rtja[0] = d->rtja;
+	 w.amb[0] = d->amb;
+	 et_iterate(&w, &p);
+	 et_finish(&w, 0, d, &p, out, pt);
+	 return (pt->status == ET_CONVERGED) ? 0 : -1;
+}
+
+///===============================================
+/// A task: design points [block*ET_BLOCK, ...) of the batch.
+
+static void et_block(void *ctx, size_t block, int worker) {
+	 struct et_job *job = ctx;
+	 struct C_batch *b = job->b;
+	 struct et_summary *sum = &job->sums[block];
+	 struct et_lanes w;
+	 size_t i0 = block * ET_BLOCK, m = b->n - i0;
+	 int l;
+	 PROF_BEGIN(prof_t);
+	 (void)worker;
+
+	 if (m > ET_BLOCK) m = ET_BLOCK;
+	 memset(&w, 0, sizeof w);
+	 for (l = 0; l < ET_BLOCK; l++) w.r[l] = 1;
+	 for (l = 0; l < (int)m; l++) {
+		 w.v[l] = b->v[i0 + l];
+		 w.r[l] = b->r[i0 + l];
+		 w.num[l] = (float)(int)b->num[i0 + l];
+		 w.rtja[l] = b->rtja[i0 + l];
+		 w.amb[l] = b->amb[i0 + l];
+	 }
+	 et_iterate(&w, job->p);
+
+	 memset(sum, 0, sizeof *sum);
+	 for (l = 0; l < (int)m; l++) {
+		 size_t i = i0 + l;
+		 struct C_design d = { b->v[i], b->r[i], b->num[i], b->fixed_res[i], b->rtja[i], b->amb[i], b->ojt[i] };
+		 struct C_result res;
+		 struct et_point pt;
+		 et_finish(&w, l, &d, job->p, &res, &pt);
+		 b->par_res[i] = res.par_res;
+		 b->var_res[i] = res.var_res;
+		 b->branch_i[i] = res.branch_i;
+		 b->total_i[i] = res.total_i;
+		 b->power[i] = res.power;
+		 b->temp_rise[i] = res.temp_rise;
+		 b->ojt_diff[i] = res.ojt_diff;
+		 b->exceeded[i] = res.exceeded;
+		 b->lux[i] = res.lux;
+		 b->percent[i] = res.percent;
+		 if (job->pts) job->pts[i] = pt;
+		 et_count(sum, &pt);
+	 }
+	 PROF_END(PROF_ET_BLOCK, prof_t, m);
+}
+
+///===============================================
+/// Operating points of every design in b, written over b's outputs as
+/// batch_run would at the converged temperatures. pts (n entries) may be
+/// NULL. Returns 0, or -1 on allocation failure.
+
+int et_run(struct C_batch *b, const struct et_tempco *tc, const struct et_config *cfg,
+	struct et_point *pts, struct et_summary *sum) {
+	 struct et_params p;
+	 struct et_job job;
+	 size_t nblocks = (b->n + ET_BLOCK - 1) / ET_BLOCK, k;
+	 int rc;
+
+	 memset(sum, 0, sizeof *sum);
+	 if (nblocks == 0) return 0;
+	 et_params(tc, cfg, &p);
+	 job.b = b;
+	 job.p = &p;
+	 job.pts = pts;
+	 job.sums = malloc(nblocks * sizeof *job.sums);
+	 if (job.sums == NULL) return -1;
+	 rc = pool_run(pool_threads(cfg ? cfg->nthreads : 0, nblocks), nblocks, et_block, &job);
+
+	 /// Merge in block order
+	 for (k = 0; k < nblocks; k++) {
+		 sum->points += job.sums[k].points;
+		 sum->converged += job.sums[k].converged;
+		 sum->max_iter += job.sums[k].max_iter;
+		 sum->runaway += job.sums[k].runaway;
+		 sum->iterations += job.sums[k].iterations;
+		 if (job.sums[k].worst > sum->worst) sum->worst = job.sums[k].worst;
+	 }
+	 free(job.sums);
+	 return rc;
+}
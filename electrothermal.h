@@ -0,0 +1,70 @@
+// electrothermal.h //
+#ifndef ELECTROTHERMAL_H
+#define ELECTROTHERMAL_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "kernel.h"
+#include "batch.h"
+
+#define ET_BLOCK 		64	// design points iterated together
+#define ET_RUNAWAY_TEMP 	500.0	// default runaway limit, deg C
+
+/** Temperature coefficients, taken at the junction temperature.
+	v(T) = v + tc_v * (T - t_ref)		the branch voltage, which
+						drifts like an LED forward
+						voltage (about -2 mV/deg C)
+	r(T) = r * (1 + tc_r * (T - t_ref))	the branch resistor, 1/deg C
+						(100 ppm == 1e-4)
+	The design's v and r are the values at t_ref; t_ref 0 == ROOM_TEMP1.
+**/
+struct et_tempco {
+    float 	tc_v;		// Volts/deg C
+    float 	tc_r;		// 1/deg C
+    float 	t_ref;		// deg C
+};
+
+/// tol 0 == 1e-3 deg C, max_iter 0 == 50, runaway 0 == ET_RUNAWAY_TEMP
+struct et_config {
+    float 	tol;		// |T - chain(T)| to stop at, deg C
+    int 	max_iter;
+    float 	runaway;	// deg C
+    int 	nthreads;	// 0 == all cores
+};
+
+enum et_status {
+    ET_CONVERGED = 0,
+    ET_MAX_ITER,		// still moving after max_iter, or stuck short of tol
+    ET_RUNAWAY			// no operating point: see electrothermal.c
+};
+
+/// Per design point
+struct et_point {
+    float 		tj;		// junction temperature, deg C (last iterate if not converged)
+    float 		v;		// v(tj)
+    float 		r;		// r(tj)
+    int32_t 		iterations;
+    enum et_status 	status;
+};
+
+struct et_summary {
+    size_t 	points;
+    size_t 	converged;
+    size_t 	max_iter;
+    size_t 	runaway;
+    size_t 	iterations;	// total over all points
+    int 	worst;		// most iterations any point took
+};
+
+int et_solve(const struct C_design *d, const struct et_tempco *tc, const struct et_config *cfg,
+	struct C_result *out, struct et_point *pt);
+int et_run(struct C_batch *b, const struct et_tempco *tc, const struct et_config *cfg,
+	struct et_point *pts, struct et_summary *sum);
+
+#endif
@@ -0,0 +1,358 @@
+///	Package:	circuit
+///	File:		eseries.c
+///	Purpose:	Standard-value resistor networks for a target branch resistance
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * IEC 60063, Preferred number series for resistors and capacitors
+ * https://en.wikipedia.org/wiki/E_series_of_preferred_numbers
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "eseries.h"
+
+/// Mantissas of one decade, scaled to 100 .. 999
+static const uint16_t E24[24] = {
+	100, 110, 120, 130, 150, 160, 180, 200, 220, 240, 270, 300,
+	330, 360, 390, 430, 470, 510, 560, 620, 680, 750, 820, 910
+};
+
+static const uint16_t E96[96] = {
+	100, 102, 105, 107, 110, 113, 115, 118, 121, 124, 127, 130,
+	133, 137, 140, 143, 147, 150, 154, 158, 162, 165, 169, 174,
+	178, 182, 187, 191, 196, 200, 205, 210, 215, 221, 226, 232,
+	237, 243, 249, 255, 261, 267, 274, 280, 287, 294, 301, 309,
+	316, 324, 332, 340, 348, 357, 365, 374, 383, 392, 402, 412,
+	422, 432, 442, 453, 464, 475, 487, 499, 511, 523, 536, 549,
+	562, 576, 590, 604, 619, 634, 649, 665, 681, 698, 715, 732,
+	750, 768, 787, 806, 825, 845, 866, 887, 909, 931, 953, 976
+};
+
+/// The best results found so far, kept in rank order
+struct es_top {
+    struct es_net 	*out;
+    size_t 		n;
+    size_t 		cap;
+    const struct es_query *q;
+};
+
+///===============================================
+/// Writes every value of series s in [r_lo, r_hi] to out, ascending.
+/// Returns how many there are, which may exceed cap (only cap are written).
+
+size_t es_values(enum es_series s, double r_lo, double r_hi, double *out, size_t cap) {
+	 const uint16_t *mant = (s == ES_E24) ? E24 : E96;
+	 int per = (s == ES_E24) ? 24 : 96;
+	 int d, k, d_lo, d_hi;
+	 size_t n = 0;
+
+	 if (r_lo <= 0 || r_hi < r_lo) return 0;
+	 d_lo = (int)floor(log10(r_lo)) - 2;
+	 d_hi = (int)ceil(log10(r_hi)) - 2;
+	 for (d = d_lo; d <= d_hi; d++) {
+		 /// Exact powers of ten so 4.99k is 499 * 10, not 499 * 10.000000001
+		 double scale = 1;
+		 for (k = 0; k < abs(d); k++) scale *= 10;
+		 for (k = 0; k < per; k++) {
+			 double v = (d >= 0) ? mant[k] * scale : mant[k] / scale;
+			 if (v < r_lo * (1 - 1e-12) || v > r_hi * (1 + 1e-12)) continue;
+			 if (n < cap) out[n] = v;
+			 n++;
+		 }
+	 }
+	 return n;
+}
+
+///===============================================
+
+static int es_pair_cmp(const void *x, const void *y) {
+	 const struct es_pair *a = x, *b = y;
+	 if (a->value != b->value) return (a->value < b->value) ? -1 : 1;
+	 if (a->a != b->a) return (int)a->a - (int)b->a;
+	 if (a->b != b->b) return (int)a->b - (int)b->b;
+	 return (int)a->op - (int)b->op;
+}
+
+///===============================================
+/// Tabulates series s over [r_lo, r_hi] (1 Ohm .. 1 MOhm when both are 0)
+/// and all two-part combinations. Returns 0 on success, -1 on failure.
+
+int es_index_build(struct es_index *ix, enum es_series s, double r_lo, double r_hi) {
+	 size_t i, j, n;
+
+	 memset(ix, 0, sizeof *ix);
+	 if (r_lo == 0 && r_hi == 0) {
+		 r_lo = 1;
+		 r_hi = 1e6;
+	 }
+	 n = es_values(s, r_lo, r_hi, NULL, 0);
+	 if (n == 0 || n > UINT16_MAX) return -1;
+	 ix->series = s;
+	 ix->v1 = malloc(n * sizeof *ix->v1);
+	 ix->v2 = malloc(n * (n + 1) * sizeof *ix->v2);
+	 if (ix->v1 == NULL || ix->v2 == NULL) {
+		 es_index_free(ix);
+		 return -1;
+	 }
+	 ix->n1 = es_values(s, r_lo, r_hi, ix->v1, n);
+
+	 for (i = 0; i < n; i++) {
+		 for (j = i; j < n; j++) {
+			 double a = ix->v1[i], b = ix->v1[j];
+			 struct es_pair ser = { a + b, (uint16_t)i, (uint16_t)j, '+' };
+			 struct es_pair par = { a * b / (a + b), (uint16_t)i, (uint16_t)j, '|' };
+			 ix->v2[ix->n2++] = ser;
+			 ix->v2[ix->n2++] = par;
+		 }
+	 }
+	 qsort(ix->v2, ix->n2, sizeof *ix->v2, es_pair_cmp);
+	 return 0;
+}
+
+///===============================================
+
+void es_index_free(struct es_index *ix) {
+	 free(ix->v1);
+	 free(ix->v2);
+	 memset(ix, 0, sizeof *ix);
+}
+
+///===============================================
+/// a op b, and the x that makes a op x equal t (or -1 if none does).
+
+static double es_comb(char op, double a, double b) {
+	 return (op == '+') ? a + b : a * b / (a + b);
+}
+
+static double es_solve(char op, double t, double a) {
+	 if (op == '+') return (t > a) ? t - a : -1;
+	 return (a > t) ? a * t / (a - t) : -1;
+}
+
+///===============================================
+/// First index whose value is >= x.
+
+static size_t es_lower1(const struct es_index *ix, double x) {
+	 size_t lo = 0, hi = ix->n1;
+	 while (lo < hi) {
+		 size_t mid = lo + (hi - lo) / 2;
+		 if (ix->v1[mid] < x) lo = mid + 1;
+		 else hi = mid;
+	 }
+	 return lo;
+}
+
+static size_t es_lower2(const struct es_index *ix, double x) {
+	 size_t lo = 0, hi = ix->n2;
+	 while (lo < hi) {
+		 size_t mid = lo + (hi - lo) / 2;
+		 if (ix->v2[mid].value < x) lo = mid + 1;
+		 else hi = mid;
+	 }
+	 return lo;
+}
+
+///===============================================
+/// Ranking: within tolerance beats outside it; within tolerance fewer
+/// parts win, then smaller error; outside it smaller error wins.
+
+static int es_better(const struct es_net *x, const struct es_net *y, double tol) {
+	 double ex = fabs(x->error), ey = fabs(y->error);
+	 int xin = (tol > 0 && ex <= tol), yin = (tol > 0 && ey <= tol);
+	 if (xin != yin) return xin;
+	 if (xin && x->parts != y->parts) return x->parts < y->parts;
+	 if (ex != ey) return ex < ey;
+	 return x->parts < y->parts;
+}
+
+///===============================================
+/// Same bill of materials and the same value.
+
+static void es_sorted(const struct es_net *n, double *p) {
+	 int i, j;
+	 for (i = 0; i < n->parts; i++) {
+		 double v = n->part[i];
+		 for (j = i; j > 0 && p[j - 1] > v; j--) p[j] = p[j - 1];
+		 p[j] = v;
+	 }
+}
+
+static int es_same(const struct es_net *x, const struct es_net *y) {
+	 double px[ES_MAX_PARTS], py[ES_MAX_PARTS];
+	 if (x->parts != y->parts || fabs(x->value - y->value) > 1e-12 * x->value) return 0;
+	 es_sorted(x, px);
+	 es_sorted(y, py);
+	 return memcmp(px, py, x->parts * sizeof px[0]) == 0;
+}
+
+///===============================================
+/// Offers one candidate network to the ranked list.
+
+static void es_offer(struct es_top *top, struct es_net *c) {
+	 const struct es_query *q = top->q;
+	 size_t i;
+
+	 c->net = (q->fixed_res > 0) ? q->fixed_res * c->value / (q->fixed_res + c->value) : c->value;
+	 c->error = (c->net - q->target) / q->target;
+	 if (top->n == top->cap && !es_better(c, &top->out[top->n - 1], q->tol)) return;
+	 for (i = 0; i < top->n; i++) if (es_same(c, &top->out[i])) return;
+
+	 i = (top->n < top->cap) ? top->n++ : top->n - 1;
+	 for (; i > 0 && es_better(c, &top->out[i - 1], q->tol); i--) top->out[i] = top->out[i - 1];
+	 top->out[i] = *c;
+}
+
+///===============================================
+/// Offers the entries of the two-part table on either side of x, each
+/// combined with the fixed parts already in c.
+
+static void es_near2(const struct es_index *ix, struct es_top *top, struct es_net *c, double x,
+	int at, double (*outer)(const struct es_net *c, double inner)) {
+	 size_t j = es_lower2(ix, x), k;
+	 for (k = (j > 0) ? j - 1 : 0; k <= j && k < ix->n2; k++) {
+		 const struct es_pair *p = &ix->v2[k];
+		 c->part[at] = ix->v1[p->a];
+		 c->part[at + 1] = ix->v1[p->b];
+		 c->op[at] = p->op;
+		 c->value = outer(c, p->value);
+		 es_offer(top, c);
+	 }
+}
+
+/// How the pair found by es_near2 completes each shape
+static double es_outer2(const struct es_net *c, double inner) { return inner; }
+static double es_outer3(const struct es_net *c, double inner) { return es_comb(c->op[0], c->part[0], inner); }
+static double es_outer4(const struct es_net *c, double inner) {
+	 return es_comb(c->op[1], es_comb(c->op[0], c->part[0], c->part[1]), inner);
+}
+static double es_outer5(const struct es_net *c, double inner) {
+	 return es_comb(c->op[0], c->part[0], es_comb(c->op[1], c->part[1], inner));
+}
+
+///===============================================
+/// Finds the best nout networks of up to q->max_parts standard parts.
+/// Meet in the middle: every shape is some fixed outer parts combined
+/// with one entry of the sorted two-part table, so the inner entry is
+/// solved for and found by binary search instead of enumerated.
+/// Returns the number of results, or -1 if the target can't be built
+/// (target <= 0, or not below fixed_res).
+
+int es_synth(const struct es_index *ix, const struct es_query *q, struct es_net *out, size_t nout) {
+	 static const char ops[2] = { '+', '|' };
+	 struct es_top top = { out, 0, nout, q };
+	 struct es_net c;
+	 double N;
+	 size_t i, j, k;
+	 int a, b;
+
+	 if (q->target <= 0 || ix->n1 == 0) return -1;
+	 if (q->fixed_res > 0 && q->target >= q->fixed_res) return -1;
+	 if (nout == 0) return 0;
+	 /// The network value that puts the net exactly on target
+	 N = (q->fixed_res > 0) ? q->fixed_res * q->target / (q->fixed_res - q->target) : q->target;
+
+	 /// One part
+	 memset(&c, 0, sizeof c);
+	 c.parts = c.shape = 1;
+	 j = es_lower1(ix, N);
+	 for (k = (j > 0) ? j - 1 : 0; k <= j && k < ix->n1; k++) {
+		 c.part[0] = c.value = ix->v1[k];
+		 es_offer(&top, &c);
+	 }
+	 if (q->max_parts < 2) return (int)top.n;
+
+	 /// a op b
+	 c.parts = c.shape = 2;
+	 es_near2(ix, &top, &c, N, 0, es_outer2);
+	 if (q->max_parts < 3) return (int)top.n;
+
+	 /// a op (b op c)
+	 c.parts = c.shape = 3;
+	 for (a = 0; a < 2; a++) {
+		 c.op[0] = ops[a];
+		 for (i = 0; i < ix->n1; i++) {
+			 double x = es_solve(ops[a], N, ix->v1[i]);
+			 if (x <= 0) continue;
+			 c.part[0] = ix->v1[i];
+			 es_near2(ix, &top, &c, x, 1, es_outer3);
+		 }
+	 }
+	 if (q->max_parts < 4) return (int)top.n;
+
+	 /// (a op b) op (c op d)
+	 c.parts = 4;
+	 c.shape = 4;
+	 for (a = 0; a < 2; a++) {
+		 /// Series needs the first pair below N, parallel above it
+		 size_t from = (ops[a] == '+') ? 0 : es_lower2(ix, N);
+		 size_t to = (ops[a] == '+') ? es_lower2(ix, N) : ix->n2;
+		 c.op[1] = ops[a];
+		 for (i = from; i < to; i++) {
+			 const struct es_pair *p = &ix->v2[i];
+			 double x = es_solve(ops[a], N, p->value);
+			 if (x <= 0) continue;
+			 c.part[0] = ix->v1[p->a];
+			 c.part[1] = ix->v1[p->b];
+			 c.op[0] = p->op;
+			 es_near2(ix, &top, &c, x, 2, es_outer4);
+		 }
+	 }
+
+	 /// a op (b op (c op d))
+	 c.shape = 5;
+	 for (a = 0; a < 2; a++) {
+		 c.op[0] = ops[a];
+		 for (i = 0; i < ix->n1; i++) {
+			 double y = es_solve(ops[a], N, ix->v1[i]);
+			 if (y <= 0) continue;
+			 c.part[0] = ix->v1[i];
+			 for (b = 0; b < 2; b++) {
+				 size_t from = (ops[b] == '+') ? 0 : es_lower1(ix, y);
+				 size_t to = (ops[b] == '+') ? es_lower1(ix, y) : ix->n1;
+				 c.op[1] = ops[b];
+				 for (j = from; j < to; j++) {
+					 double x = es_solve(ops[b], y, ix->v1[j]);
+					 if (x <= 0) continue;
+					 c.part[1] = ix->v1[j];
+					 es_near2(ix, &top, &c, x, 2, es_outer5);
+				 }
+			 }
+		 }
+	 }
+	 return (int)top.n;
+}
+
+///===============================================
+/// Writes the network as text, e.g. "100 + (49.9 || 10)". Returns what
+/// snprintf returns.
+
+int es_format(const struct es_net *n, char *buf, size_t size) {
+	 const char *o[ES_MAX_PARTS - 1];
+	 int i;
+	 for (i = 0; i < ES_MAX_PARTS - 1; i++) o[i] = (n->op[i] == '|') ? "||" : "+";
+	 switch (n->shape) {
+		case 1:
+			return snprintf(buf, size, "%g", n->part[0]);
+		case 2:
+			return snprintf(buf, size, "%g %s %g", n->part[0], o[0], n->part[1]);
+		case 3:
+			return snprintf(buf, size, "%g %s (%g %s %g)", n->part[0], o[0], n->part[1], o[1], n->part[2]);
+		case 4:
+			return snprintf(buf, size, "(%g %s %g) %s (%g %s %g)", n->part[0], o[0], n->part[1],
+				o[1], n->part[2], o[2], n->part[3]);
+		case 5:
+			return snprintf(buf, size, "%g %s (%g %s (%g %s %g))", n->part[0], o[0], n->part[1],
+				o[1], n->part[2], o[2], n->part[3]);
+	 }
+	 return snprintf(buf, size, "?");
+}
@@ -0,0 +1,79 @@
+// eseries.h //
+#ifndef ESERIES_H
+#define ESERIES_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ES_MAX_PARTS 	4	// standard parts in one network
+
+enum es_series {
+    ES_E24 = 24,
+    ES_E96 = 96
+};
+
+/// One entry of the two-part table: a op b, indices into the value list
+struct es_pair {
+    double 	value;
+    uint16_t 	a;
+    uint16_t 	b;
+    char 	op;		// '+' series, '|' parallel
+};
+
+/** Every standard value of one series between r_lo and r_hi, plus every
+	two-part series and parallel combination of them, both sorted by value.
+	Build once and reuse for any number of queries.
+**/
+struct es_index {
+    enum es_series 	series;
+    size_t 		n1;
+    double 		*v1;		// single values, ascending
+    size_t 		n2;
+    struct es_pair 	*v2;		// pairs, ascending by value
+};
+
+/** What to synthesize. The standard-part network N sits in parallel with
+	fixed_res (the 3.3 Ohm part in the LED branch) so the net resistance
+	is calc_output_resistance(fixed_res, N). fixed_res == 0 means the
+	network stands alone. tol is the allowed relative error of the net
+	resistance; 0 ranks purely by error.
+**/
+struct es_query {
+    double 	target;		// net branch resistance, Ohms
+    double 	fixed_res;	// Ohms, 0 == none
+    double 	tol;		// relative, e.g. 0.001
+    int 	max_parts;	// 1 .. ES_MAX_PARTS
+};
+
+/** A network as a tree of at most ES_MAX_PARTS parts:
+	shape 1	 a
+	shape 2	 a op0 b
+	shape 3	 a op0 (b op1 c)
+	shape 4	 (a op0 b) op1 (c op2 d)
+	shape 5	 a op0 (b op1 (c op2 d))
+	Results within tol come first, fewest parts first, then smallest
+	error. The rest follow by error.
+**/
+struct es_net {
+    int 	parts;
+    int 	shape;
+    double 	part[ES_MAX_PARTS];
+    char 	op[ES_MAX_PARTS - 1];
+    double 	value;		// network alone
+    double 	net;		// with fixed_res
+    double 	error;		// (net - target) / target
+};
+
+size_t es_values(enum es_series s, double r_lo, double r_hi, double *out, size_t cap);
+int es_index_build(struct es_index *ix, enum es_series s, double r_lo, double r_hi);
+void es_index_free(struct es_index *ix);
+int es_synth(const struct es_index *ix, const struct es_query *q, struct es_net *out, size_t nout);
+int es_format(const struct es_net *n, char *buf, size_t size);
+
+#endif
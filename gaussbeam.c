@@ -0,0 +1,189 @@
+///	Package:	intensity
+///	File:		gaussbeam.c
+///	Purpose:	Gaussian beam profiles, grids and encircled power
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * https://www.rp-photonics.com/gaussian_beams.html
+ * https://en.wikipedia.org/wiki/Gaussian_beam
+ * Cody and Waite, "Software Manual for the Elementary Functions", 1980
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "gaussbeam.h"
+
+#define GB_BLOCK 	16		// elements per vectorized block
+
+/// Batch exp range and constants
+#define GB_EXP_LO 	-87.33654f	// exp(GB_EXP_LO) is the smallest normal float
+#define GB_EXP_HI 	88.0f		// inputs above give exp(GB_EXP_HI)
+#define GB_LOG2E 	1.44269504f
+#define GB_LN2_HI 	0.693145752f	// ln 2 split so k * GB_LN2_HI is exact
+#define GB_LN2_LO 	1.42860677e-6f
+#define GB_ROUND 	12582912.0f	// 1.5 * 2^23, adding it rounds to an integer
+
+///===============================================
+/// Float bit patterns, for building 2^k and reading back a rounded k.
+
+static inline int32_t gb_bits(float f) {
+	 union { float f; int32_t i; } u = { f };
+	 return u.i;
+}
+
+static inline float gb_float(int32_t i) {
+	 union { int32_t i; float f; } u = { i };
+	 return u.f;
+}
+
+///===============================================
+/// Beam parameters.
+
+static double gb_n(const struct gb_beam *b) {
+	 return (b->n > 0) ? b->n : 1;
+}
+
+/// Distance from the waist at which the beam area has doubled
+double gb_rayleigh(const struct gb_beam *b) {
+	 return M_PI * b->w0 * b->w0 * gb_n(b) / b->lambda;
+}
+
+/// Waist radius of a beam with far-field half-angle divergence (radians)
+double gb_waist(double divergence, double lambda, double n) {
+	 if (n <= 0) n = 1;
+	 return lambda / (M_PI * n * divergence);
+}
+
+/// Far-field half-angle divergence, radians
+double gb_divergence(const struct gb_beam *b) {
+	 return b->lambda / (M_PI * gb_n(b) * b->w0);
+}
+
+/// 1/e^2 radius at distance z from the waist
+double gb_radius(const struct gb_beam *b, double z) {
+	 double q = z / gb_rayleigh(b);
+	 return b->w0 * sqrt(1 + q * q);
+}
+
+/// Wavefront radius of curvature, infinite at the waist
+double gb_curvature(const struct gb_beam *b, double z) {
+	 double zr = gb_rayleigh(b);
+	 if (z == 0) return INFINITY;
+	 return z * (1 + (zr / z) * (zr / z));
+}
+
+/// On-axis intensity at the waist, W/m^2
+double gb_peak(const struct gb_beam *b) {
+	 return 2 * b->power / (M_PI * b->w0 * b->w0);
+}
+
+///===============================================
+/// I(r, z) = I0 * (w0/w(z))^2 * exp(-2 r^2 / w(z)^2)
+
+double gb_intensity(const struct gb_beam *b, double r, double z) {
+	 double w = gb_radius(b, z);
+	 return gb_peak(b) * (b->w0 / w) * (b->w0 / w) * exp(-2 * r * r / (w * w));
+}
+
+///===============================================
+/// Fraction of the beam power inside radius r at distance z.
+
+double gb_encircled(const struct gb_beam *b, double r, double z) {
+	 double w = gb_radius(b, z);
+	 return -expm1(-2 * r * r / (w * w));
+}
+
+/// Radius that holds fraction (0 .. 1) of the power at distance z
+double gb_radius_containing(const struct gb_beam *b, double fraction, double z) {
+	 if (fraction <= 0) return 0;
+	 if (fraction >= 1) return INFINITY;
+	 return gb_radius(b, z) * sqrt(-0.5 * log1p(-fraction));
+}
+
+///===============================================
+/// y = exp(x), element by element. Cody-Waite reduction x = k ln2 + g
+/// with |g| <= ln2/2, a Taylor polynomial in g of a degree set by acc,
+/// and 2^k built straight into the exponent bits. Inputs below
+/// GB_EXP_LO give 0. Each block of GB_BLOCK is copied through local
+/// arrays, so it vectorizes without remainder loops even when y is x.
+
+#define GB_EXP_AT(in, out, POLY) do { \
+	 float v = (in), t, kf, g; \
+	 v = (v < GB_EXP_LO) ? GB_EXP_LO : v; \
+	 v = (v > GB_EXP_HI) ? GB_EXP_HI : v; \
+	 t = v * GB_LOG2E + GB_ROUND; \
+	 kf = t - GB_ROUND; \
+	 g = v - kf * GB_LN2_HI - kf * GB_LN2_LO; \
+	 g = POLY; \
+	 g *= gb_float((gb_bits(t) - gb_bits(GB_ROUND) + 127) << 23); \
+	 (out) = ((in) < GB_EXP_LO) ? 0.0f : g; \
+} while (0)
+
+#define GB_POLY3 	(1.0f + g * (1.0f + g * (0.5f + g * (1.0f / 6))))
+#define GB_POLY5 	(1.0f + g * (1.0f + g * (0.5f + g * (1.0f / 6 + g * (1.0f / 24 + g * (1.0f / 120))))))
+#define GB_POLY7 	(1.0f + g * (1.0f + g * (0.5f + g * (1.0f / 6 + g * (1.0f / 24 + g * (1.0f / 120 \
+				+ g * (1.0f / 720 + g * (1.0f / 5040))))))))
+
+#define GB_EXP_LOOP(POLY) do { \
+	 for (; k + GB_BLOCK <= n; k += GB_BLOCK) { \
+		 for (j = 0; j < GB_BLOCK; j++) in[j] = x[k + j]; \
+		 for (j = 0; j < GB_BLOCK; j++) GB_EXP_AT(in[j], out[j], POLY); \
+		 for (j = 0; j < GB_BLOCK; j++) y[k + j] = out[j]; \
+	 } \
+	 for (; k < n; k++) GB_EXP_AT(x[k], y[k], POLY); \
+} while (0)
+
+void gb_exp(const float *x, float *y, size_t n, enum gb_accuracy acc) {
+	 float in[GB_BLOCK], out[GB_BLOCK];
+	 size_t k = 0, j;
+	 switch (acc) {
+		case GB_EXP_FAST:	GB_EXP_LOOP(GB_POLY3); break;
+		case GB_EXP_MEDIUM:	GB_EXP_LOOP(GB_POLY5); break;
+		default:		GB_EXP_LOOP(GB_POLY7); break;
+	 }
+}
+
+///===============================================
+/// out[iz*nr + ir] = I(r[ir], z[iz]). Each z row is one exponent scale
+/// times r^2, run through gb_exp in place.
+
+void gb_intensity_grid(const struct gb_beam *b, const float *r, size_t nr, const float *z, size_t nz,
+	float *out, enum gb_accuracy acc) {
+	 size_t iz, ir;
+	 for (iz = 0; iz < nz; iz++) {
+		 double w = gb_radius(b, z[iz]);
+		 float a = (float)(-2 / (w * w));
+		 float amp = (float)(gb_peak(b) * (b->w0 / w) * (b->w0 / w));
+		 float *row = out + iz * nr;
+		 for (ir = 0; ir < nr; ir++) row[ir] = a * r[ir] * r[ir];
+		 gb_exp(row, row, nr, acc);
+		 for (ir = 0; ir < nr; ir++) row[ir] *= amp;
+	 }
+}
+
+///===============================================
+/// out[iz*nr + ir] = encircled power fraction inside r[ir] at z[iz].
+/// 1 - exp(-x) loses relative precision for radii well inside the
+/// waist; use gb_encircled there.
+
+void gb_encircled_grid(const struct gb_beam *b, const float *r, size_t nr, const float *z, size_t nz,
+	float *out, enum gb_accuracy acc) {
+	 size_t iz, ir;
+	 for (iz = 0; iz < nz; iz++) {
+		 double w = gb_radius(b, z[iz]);
+		 float a = (float)(-2 / (w * w));
+		 float *row = out + iz * nr;
+		 for (ir = 0; ir < nr; ir++) row[ir] = a * r[ir] * r[ir];
+		 gb_exp(row, row, nr, acc);
+		 for (ir = 0; ir < nr; ir++) row[ir] = 1.0f - row[ir];
+	 }
+}
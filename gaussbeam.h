@@ -0,0 +1,49 @@
+// gaussbeam.h //
+#ifndef GAUSSBEAM_H
+#define GAUSSBEAM_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+
+/** Accuracy of the batch exp, as worst relative error over the whole
+	float range:
+		GB_EXP_FAST	8e-4, cubic
+		GB_EXP_MEDIUM	4e-6, quintic
+		GB_EXP_PRECISE	1.1e-7 (about 1 ulp), degree 7
+**/
+enum gb_accuracy {
+    GB_EXP_FAST = 0,
+    GB_EXP_MEDIUM,
+    GB_EXP_PRECISE
+};
+
+/// A TEM00 beam with its waist at z = 0. SI units throughout.
+struct gb_beam {
+    double 	w0;		// waist radius (1/e^2 intensity), meters
+    double 	lambda;		// vacuum wavelength, meters
+    double 	n;		// refractive index of the medium, 0 == 1
+    double 	power;		// total beam power, Watts
+};
+
+double gb_rayleigh(const struct gb_beam *b);
+double gb_waist(double divergence, double lambda, double n);
+double gb_divergence(const struct gb_beam *b);
+double gb_radius(const struct gb_beam *b, double z);
+double gb_curvature(const struct gb_beam *b, double z);
+double gb_peak(const struct gb_beam *b);
+double gb_intensity(const struct gb_beam *b, double r, double z);
+double gb_encircled(const struct gb_beam *b, double r, double z);
+double gb_radius_containing(const struct gb_beam *b, double fraction, double z);
+
+void gb_exp(const float *x, float *y, size_t n, enum gb_accuracy acc);
+void gb_intensity_grid(const struct gb_beam *b, const float *r, size_t nr, const float *z, size_t nz,
+	float *out, enum gb_accuracy acc);
+void gb_encircled_grid(const struct gb_beam *b, const float *r, size_t nr, const float *z, size_t nz,
+	float *out, enum gb_accuracy acc);
+
+#endif
@@ -27,58 +27,17 @@
 #include <math.h>
 #include <check.h>
 #include "intensity.h"
+#include "constants.h"
+#include "kernel.h"
+#include "prof.h"
+#include "report.h"
 
-/// STANDARD DEFINITIONS FOR PROJECT SCICALC 
-#define PI	3.14159265358979323846 // ad infinitum
-#define LIGHT_SPEED		299792458.0 // meters per second
-#define DATA_SIZE 1000
-#define MICRO 1.0e-6
-#define NANO 1.0e-9
-#define PICO 1.0e-12
-#define KILO 1.0e3
-#define MEGA 1.0e6
-#define GIGA 1.0e9
-#define TERA 1.0e12 
-#define AIR_REFRACTIVE_INDEX 1.00027717
-#define E0 8.8541878128*PICO				// Permittivity of Free Space in Farads per meter
-#define MU0 1.25663706212*MICRO				// Permeability of Free Space in Newtons per square meter
-#define EPSILON_0 1/(MU0*(LIGHT_SPEED*LIGHT_SPEED))	// Permittivity of Free Space Equation
-#define ELECTRON_CHARGE 1.6e-19 // Charge of an electron in Coulombs
-#define RADIUS_HELIUM_ATOM 26.5e-12
-#define LED_ARRAY_RADIUS 0.35 // meters from LED array to sample plate
-#define E_CONSTANT 1/(4*PI*EPSILON_0)
+/// STANDARD DEFINITIONS and the physical constants are in constants.h
 
 #define TXT_FILE "intensity.txt"
 
 ///===============================================
-/** This data structure holds the test inputs for our intensity object. 
-	All we need are:
-		1. The speed of light in whatever medium we are in
-		2. The refractive index of light in whatever medium we are in
-		3. The permittivity of free space
-		4. The strength of our electric field 
-**/
-struct I_test {
-    float 	c;		// speed of light in medium
-    float 	ri;		// refractive index of medium
-    float 	e0;		// permittivity of free space 
-    double 	Efield;	// electric field
-};
-///===============================================
-
-/** This data structure holds the test inputs for our circuit object. 
-	All we need are:
-		1. voltage at the Feedback input
-		2. current value
-		2. resistor value
-		3. number of branches
-**/
-struct C_test {
-    float 	v;		// voltage
-    float 	i; 		// current
-    float 	r;		// resistor
-    float 	num;	// number of branches 
-};
+/// struct I_test and struct C_test are in kernel.h
 ///===============================================
 
 /** calc_intensity(int c, double ri, double eps0, double efield) 
@@ -89,8 +48,10 @@ struct C_test {
  * 	efield = electric field
 **/
 double calc_intensity(int c, double ri, double eps0, double efield) {
-	 double result = ((c * ri * eps0)/(2)) * (efield*efield);
-	 printf("intensity = %e\n",result);
+	 PROF_BEGIN(prof_t);
+	 double result = k_intensity(c, ri, eps0, efield);
+	 PROF_END(PROF_INTENSITY, prof_t, 1);
+	 REPORT("intensity", "intensity = %e\n", 1, result);
 	 return result;
 }
 ///===============================================
@@ -102,22 +63,28 @@ double calc_intensity(int c, double ri, double eps0, double efield) {
  * 	efield = electric field
 **/
 double calc_irradiance(int c, double mu0, double efield) { 
-	 double result = (efield*efield)/(c * mu0);
-	 printf("intensity = %e\n",result);
+	 PROF_BEGIN(prof_t);
+	 double result = k_irradiance(c, mu0, efield);
+	 PROF_END(PROF_IRRADIANCE, prof_t, 1);
+	 REPORT("irradiance", "intensity = %e\n", 1, result);
 	 return result;
 }
 ///===============================================
 
 double calc_Electric_Field(double num_charges, double charge, double radius) {
-	 double result = E_CONSTANT * (2*(charge))/(radius*radius);
-	 printf("E field = %e\n",result);
+	 PROF_BEGIN(prof_t);
+	 double result = k_Electric_Field(num_charges, charge, radius);
+	 PROF_END(PROF_ELECTRIC_FIELD, prof_t, 1);
+	 REPORT("Electric_Field", "E field = %e\n", 1, result);
 	 return result;
 }
 ///===============================================
 
 double calc_Lux(double received_illuminance, double reflectance) {
-	 double result = (received_illuminance * reflectance)/PI;
-	 printf("Lux = %e\n",result);
+	 PROF_BEGIN(prof_t);
+	 double result = k_Lux(received_illuminance, reflectance);
+	 PROF_END(PROF_LUX, prof_t, 1);
+	 REPORT("Lux", "Lux = %e\n", 1, result);
 	 return result;
 }
 ///===============================================
@@ -0,0 +1,260 @@
+///	Package:	circuit
+///	File:		interval.c
+///	Purpose:	Worst-case enclosures of the LED circuit and intensity chains
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "constants.h"
+#include "kernel.h"
+#include "montecarlo.h"
+#include "interval.h"
+
+#define IV_NAME(id, name) name,
+static const char *const iv_input_names[] = { IV_INPUTS(IV_NAME) };
+#undef IV_NAME
+
+static const char *const iv_verdict_names[] = { "pass", "exceeded", "ambiguous" };
+
+const char *iv_input_name(enum iv_input in) {
+	 return (in < IV_NINPUTS) ? iv_input_names[in] : "?";
+}
+
+const char *iv_verdict_name(enum iv_verdict v) {
+	 return (v <= IV_AMBIGUOUS) ? iv_verdict_names[v] : "?";
+}
+
+///===============================================
+/// Boxes
+
+/// The single design d
+void iv_box_point(struct iv_box *b, const struct C_design *d) {
+	 const float x[IV_NINPUTS] = { d->v, d->r, d->num, d->fixed_res, d->rtja, d->amb, d->ojt };
+	 int k;
+	 for (k = 0; k < IV_NINPUTS; k++) b->x[k] = iv_point(x[k]);
+}
+
+/// Widens input in by a relative tolerance: +/- 5% is rel 0.05
+void iv_box_tol(struct iv_box *b, enum iv_input in, double rel) {
+	 struct ival a = b->x[in];
+	 b->x[in] = iv_make(iv_down(a.lo - fabs(a.lo) * rel), iv_up(a.hi + fabs(a.hi) * rel));
+}
+
+/// nominal * (1 +/- s), whichever sign nominal has
+static struct ival iv_spread(const struct mc_param *p, double nsigma) {
+	 double s = (p->dist == MC_UNIFORM) ? p->spread : (p->dist == MC_NORMAL) ? nsigma * p->spread : 0;
+	 double a = p->nominal * (1 - s), c = p->nominal * (1 + s);
+	 return iv_out(fmin(a, c), fmax(a, c));
+}
+
+/** The box a montecarlo.h design samples from. A uniform tolerance is
+	covered whole; a normal one has no bounds, so it is cut at nsigma
+	standard deviations. fixed_res and ojt come from base, which
+	montecarlo.h does not spread.
+**/
+void iv_box_from_mc(struct iv_box *b, const struct C_design *base, const struct mc_design *mc, double nsigma) {
+	 iv_box_point(b, base);
+	 b->x[IV_V] = iv_spread(&mc->v, nsigma);
+	 b->x[IV_R] = iv_spread(&mc->r, nsigma);
+	 b->x[IV_RTJA] = iv_spread(&mc->rtja, nsigma);
+	 b->x[IV_AMB] = iv_spread(&mc->amb, nsigma);
+	 b->x[IV_NUM] = iv_point(mc->num);
+}
+
+///===============================================
+/// k_chain on intervals
+
+/// fixed * p / (fixed - p) at one point, enclosed
+static struct ival iv_trim_at(double p, double fixed) {
+	 return iv_div(iv_mul(iv_point(fixed), iv_point(p)), iv_sub(iv_point(fixed), iv_point(p)));
+}
+
+/** The trim resistor. For 0 < p < fixed it rises with p and falls with
+	fixed, so the ends of the range are at opposite corners; anywhere
+	else the plain operations are still safe, just wider.
+**/
+static struct ival iv_trim(struct ival p, struct ival fixed) {
+	 if (p.lo > 0 && fixed.lo > p.hi)
+		 return iv_make(iv_trim_at(p.lo, fixed.hi).lo, iv_trim_at(p.hi, fixed.lo).hi);
+	 return iv_div(iv_mul(fixed, p), iv_sub(fixed, p));
+}
+
+/// max - r * slope, clipped at 0, r clamped at DE_MIN_RES: both steps
+/// are monotone, so they apply to the ends
+static struct ival iv_response(struct ival r, double max, double slope) {
+	 struct ival rc = iv_make((r.lo >= DE_MIN_RES) ? r.lo : DE_MIN_RES, (r.hi >= DE_MIN_RES) ? r.hi : DE_MIN_RES);
+	 struct ival y = iv_sub(iv_point(max), iv_mul(iv_point(slope), rc));
+	 return iv_make(fmax(y.lo, 0), fmax(y.hi, 0));
+}
+
+static enum iv_verdict iv_exceeded(struct ival temp_rise, struct ival ojt) {
+	 if (temp_rise.lo >= ojt.hi) return IV_EXCEEDED;
+	 if (temp_rise.hi < ojt.lo) return IV_PASS;
+	 return IV_AMBIGUOUS;
+}
+
+/** Every k_chain output over box b. par_res is 1/(n * (1/r)) = r/n and
+	power v * (n * v/r) = n * v^2 / r, the same values with each input
+	used once.
+**/
+void iv_chain(const struct iv_box *b, struct iv_result *out) {
+	 struct ival v = b->x[IV_V], r = b->x[IV_R];
+	 struct ival num = iv_make(trunc(b->x[IV_NUM].lo), trunc(b->x[IV_NUM].hi));
+
+	 out->par_res = iv_div(r, num);
+	 out->var_res = iv_trim(out->par_res, b->x[IV_FIXED_RES]);
+	 out->branch_i = iv_div(v, r);
+	 out->total_i = iv_mul(num, out->branch_i);
+	 out->power = iv_div(iv_mul(num, iv_sqr(v)), r);
+	 out->temp_rise = iv_add(iv_mul(b->x[IV_RTJA], out->power), b->x[IV_AMB]);
+	 out->ojt_diff = iv_sub(b->x[IV_OJT], out->temp_rise);
+	 out->exceeded = iv_exceeded(out->temp_rise, b->x[IV_OJT]);
+	 out->lux = iv_response(r, DE_MAX_LUX, DE_LUX_SLOPE);
+	 out->percent = iv_response(r, DE_MAX_PERCENT, DE_PERCENT_SLOPE);
+}
+
+///===============================================
+/// Adaptive splitting
+
+/// The inputs the verdict depends on
+static const enum iv_input iv_split_inputs[] = { IV_V, IV_R, IV_NUM, IV_RTJA, IV_AMB, IV_OJT };
+#define IV_NSPLIT 	(sizeof iv_split_inputs / sizeof iv_split_inputs[0])
+
+/// How far apart the temperature and its limit can be
+static double iv_margin_width(const struct iv_box *b) {
+	 struct iv_result res;
+	 iv_chain(b, &res);
+	 return iv_width(res.temp_rise) + iv_width(b->x[IV_OJT]);
+}
+
+static int iv_splittable(const struct iv_box *b, enum iv_input in) {
+	 if (in == IV_NUM) return trunc(b->x[in].lo) < trunc(b->x[in].hi);
+	 return b->x[in].lo < b->x[in].hi;
+}
+
+/** The input to split: the one that, held at its midpoint, narrows the
+	margin the most. -1 if nothing can be split.
+**/
+static int iv_pick(const struct iv_box *b) {
+	 double base = iv_margin_width(b), best = -1;
+	 int pick = -1;
+	 size_t k;
+
+	 for (k = 0; k < IV_NSPLIT; k++) {
+		 enum iv_input in = iv_split_inputs[k];
+		 struct iv_box mid = *b;
+		 double gain, m;
+		 if (!iv_splittable(b, in)) continue;
+		 m = b->x[in].lo + iv_width(b->x[in]) / 2;
+		 if (in == IV_NUM) m = trunc(m);
+		 mid.x[in] = iv_point(m);
+		 gain = base - iv_margin_width(&mid);
+		 if (gain > best) {
+			 best = gain;
+			 pick = in;
+		 }
+	 }
+	 return pick;
+}
+
+/// Halves input in of b into lo and hi. Returns the share of b's volume
+/// that lo has: a half, or for num its share of the whole branch counts.
+static double iv_bisect(const struct iv_box *b, enum iv_input in, struct iv_box *lo, struct iv_box *hi) {
+	 struct ival a = b->x[in];
+	 double m;
+
+	 *lo = *hi = *b;
+	 if (in == IV_NUM) {
+		 double n0 = trunc(a.lo), n1 = trunc(a.hi);
+		 m = floor((n0 + n1) / 2);
+		 lo->x[in] = iv_make(n0, m);
+		 hi->x[in] = iv_make(m + 1, n1);
+		 return (m - n0 + 1) / (n1 - n0 + 1);
+	 }
+	 m = a.lo + iv_width(a) / 2;
+	 lo->x[in] = iv_make(a.lo, m);
+	 hi->x[in] = iv_make(m, a.hi);
+	 return 0.5;
+}
+
+static void iv_visit(const struct iv_box *b, int depth, double frac, struct iv_split *out) {
+	 struct iv_result res;
+	 struct iv_box lo, hi;
+	 double share;
+	 int in;
+
+	 iv_chain(b, &res);
+	 in = (res.exceeded == IV_AMBIGUOUS && depth > 0) ? iv_pick(b) : -1;
+	 if (in >= 0) {
+		 share = iv_bisect(b, in, &lo, &hi);
+		 iv_visit(&lo, depth - 1, frac * share, out);
+		 iv_visit(&hi, depth - 1, frac * (1 - share), out);
+		 return;
+	 }
+
+	 out->leaves++;
+	 out->temp_rise = iv_hull(out->temp_rise, res.temp_rise);
+	 switch (res.exceeded) {
+	 case IV_PASS:		out->pass++;		out->pass_frac += frac;		break;
+	 case IV_EXCEEDED:	out->exceeded++;	out->exceeded_frac += frac;	break;
+	 default:		out->ambiguous++;	out->ambiguous_frac += frac;	break;
+	 }
+}
+
+/** The temperature verdict for every design in box b. Boxes that
+	straddle the limit are split in two, up to depth times, along the
+	input that narrows the margin most. IV_EXCEEDED if some part of b
+	surely exceeds the limit, IV_PASS if every part surely does not,
+	IV_AMBIGUOUS if what is left undecided could go either way. out, if
+	not NULL, gets the details.
+**/
+enum iv_verdict iv_check(const struct iv_box *b, int depth, struct iv_split *out) {
+	 struct iv_split s;
+
+	 memset(&s, 0, sizeof s);
+	 s.temp_rise = iv_make(INFINITY, -INFINITY);
+	 if (depth > IV_MAX_DEPTH) depth = IV_MAX_DEPTH;
+	 iv_visit(b, depth, 1, &s);
+	 if (out != NULL) *out = s;
+	 if (s.exceeded > 0) return IV_EXCEEDED;
+	 return (s.ambiguous > 0) ? IV_AMBIGUOUS : IV_PASS;
+}
+
+///===============================================
+/// The intensity kernels of kernel.h on intervals
+
+/// The real pi, not just its double
+static struct ival iv_pi(void) {
+	 return iv_out(PI, PI);
+}
+
+struct ival iv_intensity(int c, struct ival ri, struct ival eps0, struct ival efield) {
+	 struct ival k = iv_div(iv_mul(iv_mul(iv_point(c), ri), eps0), iv_point(2));
+	 return iv_mul(k, iv_sqr(efield));
+}
+
+struct ival iv_irradiance(int c, struct ival mu0, struct ival efield) {
+	 return iv_div(iv_sqr(efield), iv_mul(iv_point(c), mu0));
+}
+
+/// As k_Electric_Field, num_charges does not enter. E_CONSTANT is
+/// enclosed from MU0 and LIGHT_SPEED the way constants.h defines it.
+struct ival iv_Electric_Field(struct ival num_charges, struct ival charge, struct ival radius) {
+	 struct ival eps0 = iv_div(iv_point(1), iv_mul(iv_point(MU0), iv_sqr(iv_point(LIGHT_SPEED))));
+	 struct ival coulomb = iv_div(iv_point(1), iv_mul(iv_mul(iv_point(4), iv_pi()), eps0));
+	 (void)num_charges;
+	 return iv_div(iv_mul(coulomb, iv_mul(iv_point(2), charge)), iv_sqr(radius));
+}
+
+struct ival iv_Lux(struct ival received_illuminance, struct ival reflectance) {
+	 return iv_div(iv_mul(received_illuminance, reflectance), iv_pi());
+}
@@ -0,0 +1,189 @@
+// interval.h //
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <math.h>
+#include "kernel.h"
+#include "montecarlo.h"
+
+/** Worst-case analysis by interval arithmetic. Every input is a range
+	[lo, hi], and every output comes back as a range that is sure to
+	hold the exact value of the formula for every input in the box: one
+	evaluation covers all the corners and everything between them.
+
+	The arithmetic is in double, each bound rounded outward: the result
+	of a double operation is within half an ulp of the exact one, so
+	stepping the lower bound down one ulp and the upper bound up one
+	with nextafter encloses it. That needs no fesetround, which -O2
+	without -frounding-math is free to ignore.
+
+	The enclosures are of the exact model, not of k_chain's float
+	rounding of it; a float result near a bound may lie outside by a few
+	float ulps. The chain is written so every input appears once where
+	it can be (power as num * v^2 / r, var_res from its monotone
+	endpoints), which makes the ranges tight, not just safe.
+
+	The temperature verdict has a third answer: a box whose temperature
+	range straddles the limit is IV_AMBIGUOUS. iv_check splits those
+	boxes until each part is decided or the depth runs out.
+**/
+
+struct ival {
+    double 	lo;
+    double 	hi;
+};
+
+/// Input, name. The same order as C_design.
+#define IV_INPUTS(X) \
+	X(IV_V,		"v") \
+	X(IV_R,		"r") \
+	X(IV_NUM,	"num") \
+	X(IV_FIXED_RES,	"fixed_res") \
+	X(IV_RTJA,	"rtja") \
+	X(IV_AMB,	"amb") \
+	X(IV_OJT,	"ojt")
+
+#define IV_ID(id, name) id,
+enum iv_input {
+	IV_INPUTS(IV_ID)
+	IV_NINPUTS
+};
+#undef IV_ID
+
+/// A box of designs. num is truncated at each end like k_chain does.
+struct iv_box {
+    struct ival 	x[IV_NINPUTS];
+};
+
+/// Is the junction temperature limit reached, for a whole box
+enum iv_verdict {
+    IV_PASS = 0,	// for no design in the box
+    IV_EXCEEDED,	// for every design in the box
+    IV_AMBIGUOUS	// for some
+};
+
+/// The C_result of a box
+struct iv_result {
+    struct ival 	par_res;
+    struct ival 	var_res;
+    struct ival 	branch_i;
+    struct ival 	total_i;
+    struct ival 	power;
+    struct ival 	temp_rise;
+    struct ival 	ojt_diff;
+    enum iv_verdict 	exceeded;
+    struct ival 	lux;
+    struct ival 	percent;
+};
+
+/// What iv_check found. The fractions are of the box's volume, num
+/// counted in whole branches; the leaves are the boxes it stopped at.
+struct iv_split {
+    size_t 		leaves;
+    size_t 		pass;
+    size_t 		exceeded;
+    size_t 		ambiguous;
+    double 		pass_frac;
+    double 		exceeded_frac;
+    double 		ambiguous_frac;
+    struct ival 	temp_rise;	// hull over the leaves
+};
+
+#define IV_MAX_DEPTH 	24	// iv_check visits at most 2^depth leaves
+
+///===============================================
+/// Outward rounding and the basic operations
+
+static inline double iv_down(double x) {
+	 return nextafter(x, -INFINITY);
+}
+
+static inline double iv_up(double x) {
+	 return nextafter(x, INFINITY);
+}
+
+static inline struct ival iv_make(double lo, double hi) {
+	 struct ival a = { lo, hi };
+	 return a;
+}
+
+/// Exactly x; no rounding has happened yet
+static inline struct ival iv_point(double x) {
+	 return iv_make(x, x);
+}
+
+/// lo and hi as computed with round to nearest, made safe
+static inline struct ival iv_out(double lo, double hi) {
+	 return iv_make(iv_down(lo), iv_up(hi));
+}
+
+static inline struct ival iv_entire(void) {
+	 return iv_make(-INFINITY, INFINITY);
+}
+
+static inline int iv_contains(struct ival a, double x) {
+	 return a.lo <= x && x <= a.hi;
+}
+
+static inline double iv_width(struct ival a) {
+	 return a.hi - a.lo;
+}
+
+static inline struct ival iv_hull(struct ival a, struct ival b) {
+	 return iv_make(fmin(a.lo, b.lo), fmax(a.hi, b.hi));
+}
+
+static inline struct ival iv_add(struct ival a, struct ival b) {
+	 return iv_out(a.lo + b.lo, a.hi + b.hi);
+}
+
+static inline struct ival iv_sub(struct ival a, struct ival b) {
+	 return iv_out(a.lo - b.hi, a.hi - b.lo);
+}
+
+static inline struct ival iv_mul(struct ival a, struct ival b) {
+	 double p1 = a.lo * b.lo, p2 = a.lo * b.hi, p3 = a.hi * b.lo, p4 = a.hi * b.hi;
+	 return iv_out(fmin(fmin(p1, p2), fmin(p3, p4)), fmax(fmax(p1, p2), fmax(p3, p4)));
+}
+
+/// Everything, when b holds 0
+static inline struct ival iv_div(struct ival a, struct ival b) {
+	 double q1, q2, q3, q4;
+	 if (b.lo <= 0 && b.hi >= 0) return iv_entire();
+	 q1 = a.lo / b.lo;	q2 = a.lo / b.hi;	q3 = a.hi / b.lo;	q4 = a.hi / b.hi;
+	 return iv_out(fmin(fmin(q1, q2), fmin(q3, q4)), fmax(fmax(q1, q2), fmax(q3, q4)));
+}
+
+/// a^2, tighter than iv_mul(a, a): it knows both factors are the same
+static inline struct ival iv_sqr(struct ival a) {
+	 double l = a.lo * a.lo, h = a.hi * a.hi;
+	 if (a.lo >= 0) return iv_out(l, h);
+	 if (a.hi <= 0) return iv_out(h, l);
+	 return iv_make(0, iv_up(fmax(l, h)));
+}
+
+///===============================================
+
+const char *iv_input_name(enum iv_input in);
+const char *iv_verdict_name(enum iv_verdict v);
+
+void iv_box_point(struct iv_box *b, const struct C_design *d);
+void iv_box_tol(struct iv_box *b, enum iv_input in, double rel);
+void iv_box_from_mc(struct iv_box *b, const struct C_design *base, const struct mc_design *mc, double nsigma);
+
+void iv_chain(const struct iv_box *b, struct iv_result *out);
+enum iv_verdict iv_check(const struct iv_box *b, int depth, struct iv_split *out);
+
+struct ival iv_intensity(int c, struct ival ri, struct ival eps0, struct ival efield);
+struct ival iv_irradiance(int c, struct ival mu0, struct ival efield);
+struct ival iv_Electric_Field(struct ival num_charges, struct ival charge, struct ival radius);
+struct ival iv_Lux(struct ival received_illuminance, struct ival reflectance);
+
+#endif
@@ -0,0 +1,206 @@
+///	Package:	circuit
+///	File:		inverse.c
+///	Purpose:	Resistor for a target lux, percent, current or OJT margin
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * Brent, "Algorithms for Minimization without Derivatives", ch. 4
+ * https://en.wikipedia.org/wiki/Brent%27s_method
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include "kernel.h"
+#include "inverse.h"
+
+///===============================================
+/// The forward model: the target quantity of design d with resistor r.
+
+float inv_eval(enum inv_target target, const struct C_design *d, float r) {
+	 struct C_design x = *d;
+	 struct C_result res;
+	 x.r = r;
+	 k_chain(&x, &res);
+	 switch (target) {
+		case INV_LUX:		return res.lux;
+		case INV_PERCENT:	return res.percent;
+		case INV_TOTAL_CURRENT:	return res.total_i;
+		case INV_OJT_MARGIN:	return res.ojt_diff;
+	 }
+	 return NAN;
+}
+
+///===============================================
+/// Resistors that hit a point of the clamp-and-slope LED response:
+/// y = max_y - r*slope on [DE_MIN_RES, max_y/slope], flat above and below.
+
+static int inv_response(double value, double max_y, double slope, double *lo, double *hi) {
+	 double top = max_y - DE_MIN_RES * slope;	// value at and below DE_MIN_RES
+	 double zero = max_y / slope;			// first resistor giving 0
+	 if (value > top || value < 0) return -1;
+	 if (value == top) { *lo = 0; *hi = DE_MIN_RES; return 0; }
+	 if (value == 0) { *lo = zero; *hi = INFINITY; return 0; }
+	 *lo = *hi = (max_y - value) / slope;
+	 return 0;
+}
+
+///===============================================
+/// Solves for the branch resistor that makes target equal value, in closed
+/// form. The model is monotone in r for every target, so each constraint
+/// is a lower or upper bound on r and the answer is an interval test.
+
+enum inv_status inv_solve(enum inv_target target, float value, const struct C_design *d,
+	const struct inv_constraints *c, struct inv_result *out) {
+	 struct inv_constraints none = { 0, 0, 0, 0 };
+	 double num = (int)d->num, v = d->v;
+	 double k = (double)d->rtja * num * v * v;	// temp rise * r
+	 double head = (double)d->ojt - d->amb;		// margin as r -> infinity
+	 double lo, hi, t_lo, t_hi, room;
+	 int rc = 0;
+
+	 if (c == NULL) c = &none;
+	 memset(out, 0, sizeof *out);
+	 out->status = INV_INFEASIBLE;
+	 out->r = NAN;
+
+	 /// Allowed interval from the constraints
+	 lo = (c->r_min > 0) ? c->r_min : 0;
+	 hi = (c->r_max > 0) ? c->r_max : INFINITY;
+	 room = head - c->min_margin;
+	 if (k > 0) {
+		 if (room <= 0) return out->status;
+		 if (k / room > lo) lo = k / room;
+	 } else if (room < 0) {
+		 return out->status;
+	 }
+	 if (c->max_current > 0 && num * v / c->max_current > lo) lo = num * v / c->max_current;
+	 if (lo > hi) return out->status;
+	 out->r_lo = lo;
+	 out->r_hi = hi;
+
+	 /// Resistors that hit the target
+	 switch (target) {
+		case INV_LUX:
+			rc = inv_response(value, DE_MAX_LUX, DE_LUX_SLOPE, &t_lo, &t_hi);
+			break;
+		case INV_PERCENT:
+			rc = inv_response(value, DE_MAX_PERCENT, DE_PERCENT_SLOPE, &t_lo, &t_hi);
+			break;
+		case INV_TOTAL_CURRENT:
+			rc = (value > 0 && num * v > 0) ? 0 : -1;
+			t_lo = t_hi = num * v / value;
+			break;
+		case INV_OJT_MARGIN:
+			rc = (k > 0 && head - value > 0) ? 0 : -1;
+			t_lo = t_hi = k / (head - value);
+			break;
+		default:
+			rc = -1;
+			break;
+	 }
+	 if (rc != 0) return out->status;
+
+	 /// Intersect the two
+	 if (t_hi < lo) {
+		 out->status = INV_CONSTRAINED;
+		 out->r = lo;
+	 } else if (t_lo > hi) {
+		 out->status = INV_CONSTRAINED;
+		 out->r = hi;
+	 } else if (t_lo == t_hi) {
+		 out->status = INV_OK;
+		 out->r = t_lo;
+	 } else {
+		 out->status = INV_FLAT;
+		 out->r_lo = (t_lo > lo) ? t_lo : lo;
+		 out->r_hi = (t_hi < hi) ? t_hi : hi;
+		 out->r = out->r_lo;
+	 }
+	 out->achieved = inv_eval(target, d, out->r);
+	 return out->status;
+}
+
+///===============================================
+/// Brent's method for f(r) = target on [lo, hi], for response curves
+/// with no closed-form inverse (measured or tabulated curves).
+/// f(lo) - target and f(hi) - target must differ in sign.
+
+enum inv_status inv_brent(inv_fn f, void *ctx, double target, double lo, double hi,
+	double tol, int max_iter, struct inv_result *out) {
+	 double a = lo, b = hi, c, d, e;
+	 double fa = f(a, ctx) - target, fb = f(b, ctx) - target, fc;
+	 int it;
+
+	 memset(out, 0, sizeof *out);
+	 out->r_lo = lo;
+	 out->r_hi = hi;
+	 out->status = INV_NO_BRACKET;
+	 out->r = NAN;
+	 if ((fa > 0 && fb > 0) || (fa < 0 && fb < 0)) return out->status;
+
+	 c = a; fc = fa; d = e = b - a;
+	 out->status = INV_MAX_ITER;
+	 /// it steps taken; the test runs again after the last one
+	 for (it = 0; ; it++) {
+		 double m, tol1, p, q, r, s;
+		 if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0)) {
+			 c = a; fc = fa; d = e = b - a;
+		 }
+		 if (fabs(fc) < fabs(fb)) {
+			 a = b; b = c; c = a;
+			 fa = fb; fb = fc; fc = fa;
+		 }
+		 tol1 = 2 * DBL_EPSILON * fabs(b) + 0.5 * tol;
+		 m = 0.5 * (c - b);
+		 if (fabs(m) <= tol1 || fb == 0) {
+			 out->status = INV_OK;
+			 break;
+		 }
+		 if (it == max_iter) break;
+		 if (fabs(e) >= tol1 && fabs(fa) > fabs(fb)) {
+			 /// Secant or inverse quadratic interpolation
+			 s = fb / fa;
+			 if (a == c) {
+				 p = 2 * m * s;
+				 q = 1 - s;
+			 } else {
+				 q = fa / fc;
+				 r = fb / fc;
+				 p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+				 q = (q - 1) * (r - 1) * (s - 1);
+			 }
+			 if (p > 0) q = -q;
+			 else p = -p;
+			 if (2 * p < fmin(3 * m * q - fabs(tol1 * q), fabs(e * q))) {
+				 e = d;
+				 d = p / q;
+			 } else {
+				 d = m;
+				 e = m;
+			 }
+		 } else {
+			 /// Bisection
+			 d = m;
+			 e = m;
+		 }
+		 a = b;
+		 fa = fb;
+		 b += (fabs(d) > tol1) ? d : ((m > 0) ? tol1 : -tol1);
+		 fb = f(b, ctx) - target;
+	 }
+	 /// b, not c, is the end with the smaller |f|
+	 out->r = b;
+	 out->achieved = fb + target;
+	 out->iterations = it;
+	 return out->status;
+}
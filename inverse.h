@@ -0,0 +1,68 @@
+// inverse.h //
+#ifndef INVERSE_H
+#define INVERSE_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include "kernel.h"
+
+/// What the resistor should achieve
+enum inv_target {
+    INV_LUX = 0,		// DE_ResToLux
+    INV_PERCENT,		// DE_ResToPercent
+    INV_TOTAL_CURRENT,		// total_current
+    INV_OJT_MARGIN		// temp_diff_OJT_TR against d->ojt
+};
+
+/** Status codes
+	INV_OK		r is the one resistor that hits the target
+	INV_FLAT	the target sits on a clamp of the model, every r in
+			[r_lo, r_hi] hits it, and r is the smallest of them
+	INV_CONSTRAINED	the target needs a resistor outside the constraints,
+			r is the closest allowed value and achieved what it gives
+	INV_INFEASIBLE	no resistor reaches the target
+	INV_NO_BRACKET	inv_brent was not given a sign change
+	INV_MAX_ITER	inv_brent ran max_iter iterations without converging,
+			r is the end of its last bracket nearer the target
+**/
+enum inv_status {
+    INV_OK = 0,
+    INV_FLAT = 1,
+    INV_CONSTRAINED = -1,
+    INV_INFEASIBLE = -2,
+    INV_NO_BRACKET = -3,
+    INV_MAX_ITER = -4
+};
+
+/** Limits on the answer. A zeroed struct means: any positive resistor,
+	OJT margin at least 0 (junction limit not reached), no current cap.
+**/
+struct inv_constraints {
+    float 	r_min;		// Ohms, 0 == no lower limit
+    float 	r_max;		// Ohms, 0 == no upper limit
+    float 	min_margin;	// deg C below d->ojt
+    float 	max_current;	// Amps total, 0 == no limit
+};
+
+struct inv_result {
+    enum inv_status 	status;
+    float 		r;		// the answer
+    float 		r_lo;		// allowed resistor interval after constraints
+    float 		r_hi;
+    float 		achieved;	// target quantity at r
+    int 		iterations;	// root-finder iterations, 0 for closed form
+};
+
+typedef double (*inv_fn)(double r, void *ctx);
+
+float inv_eval(enum inv_target target, const struct C_design *d, float r);
+enum inv_status inv_solve(enum inv_target target, float value, const struct C_design *d,
+	const struct inv_constraints *c, struct inv_result *out);
+enum inv_status inv_brent(inv_fn f, void *ctx, double target, double lo, double hi,
+	double tol, int max_iter, struct inv_result *out);
+
+#endif
@@ -0,0 +1,295 @@
+///	Package:	intensity
+///	File:		irradiance.c
+///	Purpose:	Irradiance / lux map of the LED array over the sample plate
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * Moreno and Sun, "Modeling the radiation pattern of LEDs", Opt. Express 16 (2008)
+ * https://en.wikipedia.org/wiki/Lambert%27s_cosine_law
+ * https://en.wikipedia.org/wiki/Inverse-square_law
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "pool.h"
+#include "irradiance.h"
+#include "cpu.h"
+#include "prof.h"
+
+#define IRR_BLOCK 	16	// plate columns summed together, a multiple of the SIMD width
+#define IRR_MAX_ROWS 	64	// emitter rows
+
+/** A plate point at distance d from an emitter sees it at angle theta with
+	cos(theta) = height/d, so it receives
+		intensity * cos^order(theta) * cos(theta) / d^2
+		= intensity * height^(order+1) * s^-(order+3)/2,   s = d^2
+	and s = (x - xi)^2 + ((y - yj)^2 + height^2) splits into a column
+	term and a row term. The column terms are tabulated once; each plate
+	row then costs one add, one divide and a few multiplies per emitter.
+**/
+struct irr_job {
+    const struct irr_array 	*a;
+    const struct irr_plate 	*p;
+    float 			*out;
+    size_t 			wc;		// plate columns computed (half when mirrored)
+    size_t 			hc;		// plate rows computed
+    size_t 			stride;		// wc rounded up to IRR_BLOCK
+    int 			mirror_x;
+    int 			mirror_y;
+    float 			*ax;		// cols x stride, (x - xi)^2
+    double 			*ey;		// rows, yj
+    double 			scale;		// intensity * height^(order+1)
+    double 			shift;		// center value, keeps the variance sums small
+    float 			*scratch;	// IRR_TILE_ROWS x stride per worker
+    struct irr_band 		*bands;		// one per task, merged in order
+};
+
+/// Sums over one band of plate rows, shifted by job->shift
+struct irr_band {
+    double 	min;
+    double 	max;
+    double 	sum;
+    double 	sumsq;
+};
+
+///===============================================
+/// Lambertian order m of an emitter whose intensity halves at
+/// half_angle_deg off axis: cos^m(half) = 1/2.
+
+int irr_lambert_order(double half_angle_deg) {
+	 double c = cos(half_angle_deg * M_PI / 180.0);
+	 double m;
+	 if (c <= 0) return 0;
+	 if (c >= 1) return IRR_MAX_ORDER;
+	 m = floor(-M_LN2 / log(c) + 0.5);
+	 if (m < 0) m = 0;
+	 if (m > IRR_MAX_ORDER) m = IRR_MAX_ORDER;
+	 return (int)m;
+}
+
+///===============================================
+/// Map value at plate point (x, y), summed emitter by emitter in double.
+/// The reference for irr_render.
+
+double irr_point(const struct irr_array *a, double x, double y) {
+	 double h = a->height, sum = 0;
+	 int i, j;
+	 for (j = 0; j < a->rows; j++) {
+		 double dy = y - (a->oy + (j - 0.5 * (a->rows - 1)) * a->pitch_y);
+		 for (i = 0; i < a->cols; i++) {
+			 double dx = x - (a->ox + (i - 0.5 * (a->cols - 1)) * a->pitch_x);
+			 double s = dx * dx + dy * dy + h * h;
+			 sum += pow(s, -0.5 * (a->order + 3));
+		 }
+	 }
+	 return a->intensity * pow(h, a->order + 1) * sum;
+}
+
+///===============================================
+/// Row kernels: acc[c] = sum over emitters of s^-(order+3)/2 for columns
+/// [c0, c1) of one plate row, with by[j] the row term of emitter row j.
+/// One instance per common order so the power is a fixed expression the
+/// compiler vectorizes across IRR_BLOCK columns, and one copy of each
+/// instance per CPU variant: NAME[cpu_isa()] is the one to call.
+
+#define IRR_ROW_PARAMS 	(const struct irr_job *job, const float *restrict by, size_t c0, size_t c1, float *restrict acc)
+#define IRR_ROW_ARGS 	(job, by, c0, c1, acc)
+
+#define IRR_KERNEL(NAME, TERM) \
+CPU_KERNEL void NAME##_body IRR_ROW_PARAMS { \
+	 const float *restrict ax = job->ax; \
+	 size_t stride = job->stride, c; \
+	 int ncol = job->a->cols, nrow = job->a->rows, i, j, l; \
+	 for (c = c0; c < c1; c += IRR_BLOCK) { \
+		 float sum[IRR_BLOCK] = { 0 }; \
+		 for (j = 0; j < nrow; j++) { \
+			 float b = by[j]; \
+			 for (i = 0; i < ncol; i++) { \
+				 const float *restrict x = ax + i * stride + c; \
+				 for (l = 0; l < IRR_BLOCK; l++) { \
+					 float inv = 1.0f / (x[l] + b); \
+					 sum[l] += TERM; \
+				 } \
+			 } \
+		 } \
+		 for (l = 0; l < IRR_BLOCK; l++) acc[c + l] = sum[l]; \
+	 } \
+} \
+CPU_CLONES(NAME, IRR_ROW_PARAMS, IRR_ROW_ARGS)
+
+IRR_KERNEL(irr_row_m0, inv * sqrtf(inv))
+IRR_KERNEL(irr_row_m1, inv * inv)
+IRR_KERNEL(irr_row_m2, inv * inv * sqrtf(inv))
+IRR_KERNEL(irr_row_m3, inv * inv * inv)
+
+/// Any other order: s^-(order+3)/2 as a run of multiplies, which still
+/// vectorizes where powf would not
+CPU_KERNEL void irr_row_any_body IRR_ROW_PARAMS {
+	 const float *restrict ax = job->ax;
+	 size_t stride = job->stride, c;
+	 int ncol = job->a->cols, nrow = job->a->rows, i, j, k, l;
+	 int odd = (job->a->order + 3) & 1, half = (job->a->order + 3) / 2;
+	 for (c = c0; c < c1; c += IRR_BLOCK) {
+		 float sum[IRR_BLOCK] = { 0 }, inv[IRR_BLOCK], t[IRR_BLOCK];
+		 for (j = 0; j < nrow; j++) {
+			 for (i = 0; i < ncol; i++) {
+				 const float *restrict x = ax + i * stride + c;
+				 for (l = 0; l < IRR_BLOCK; l++) inv[l] = 1.0f / (x[l] + by[j]);
+				 for (l = 0; l < IRR_BLOCK; l++) t[l] = odd ? sqrtf(inv[l]) : 1.0f;
+				 for (k = 0; k < half; k++) {
+					 for (l = 0; l < IRR_BLOCK; l++) t[l] *= inv[l];
+				 }
+				 for (l = 0; l < IRR_BLOCK; l++) sum[l] += t[l];
+			 }
+		 }
+		 for (l = 0; l < IRR_BLOCK; l++) acc[c + l] = sum[l];
+	 }
+}
+
+CPU_CLONES(irr_row_any, IRR_ROW_PARAMS, IRR_ROW_ARGS)
+
+///===============================================
+/// One task: plate rows [band*IRR_TILE_ROWS, ...) of the computed part.
+/// Column tiles are the outer loop so each tile's column terms stay in
+/// cache for all the rows of the band. Then the rows are scaled, mirrored
+/// into place and folded into the band's statistics.
+
+static void irr_band_task(void *ctx, size_t band, int worker) {
+	 struct irr_job *job = ctx;
+	 const struct irr_array *a = job->a;
+	 const struct irr_plate *p = job->p;
+	 struct irr_band *st = &job->bands[band];
+	 float *rows = job->scratch + (size_t)worker * IRR_TILE_ROWS * job->stride;
+	 float by[IRR_TILE_ROWS][IRR_MAX_ROWS];
+	 size_t r0 = band * IRR_TILE_ROWS, r1 = r0 + IRR_TILE_ROWS, r, c, c0;
+	 double dy = (double)p->height / p->h, h2 = (double)a->height * a->height;
+	 void (*row)(const struct irr_job *, const float *, size_t, size_t, float *);
+	 enum cpu_isa isa = cpu_isa();
+	 int j;
+	 PROF_BEGIN(prof_t);
+
+	 switch (a->order) {
+		case 0:		row = irr_row_m0[isa]; break;
+		case 1:		row = irr_row_m1[isa]; break;
+		case 2:		row = irr_row_m2[isa]; break;
+		case 3:		row = irr_row_m3[isa]; break;
+		default:	row = irr_row_any[isa]; break;
+	 }
+	 if (r1 > job->hc) r1 = job->hc;
+	 for (r = r0; r < r1; r++) {
+		 double y = -0.5 * p->height + (r + 0.5) * dy;
+		 for (j = 0; j < a->rows; j++) by[r - r0][j] = (float)((y - job->ey[j]) * (y - job->ey[j]) + h2);
+	 }
+	 for (c0 = 0; c0 < job->stride; c0 += IRR_TILE_COLS) {
+		 size_t c1 = (c0 + IRR_TILE_COLS < job->stride) ? c0 + IRR_TILE_COLS : job->stride;
+		 for (r = r0; r < r1; r++) row(job, by[r - r0], c0, c1, rows + (r - r0) * job->stride);
+	 }
+
+	 st->min = INFINITY;
+	 st->max = -INFINITY;
+	 st->sum = st->sumsq = 0;
+	 for (r = r0; r < r1; r++) {
+		 const float *acc = rows + (r - r0) * job->stride;
+		 float *dst = job->out + r * p->w;
+		 double wy = (job->mirror_y && p->h - 1 - r != r) ? 2 : 1, sum = 0, sumsq = 0;
+		 for (c = 0; c < job->wc; c++) {
+			 float v = (float)(job->scale * acc[c]);
+			 double wx = (job->mirror_x && p->w - 1 - c != c) ? 2 : 1, d = v - job->shift;
+			 dst[c] = v;
+			 if (job->mirror_x) dst[p->w - 1 - c] = v;
+			 if (v < st->min) st->min = v;
+			 if (v > st->max) st->max = v;
+			 sum += wx * d;
+			 sumsq += wx * d * d;
+		 }
+		 st->sum += wy * sum;
+		 st->sumsq += wy * sumsq;
+		 if (wy == 2) memcpy(job->out + (p->h - 1 - r) * p->w, dst, p->w * sizeof *dst);
+	 }
+	 PROF_END(PROF_IRR_BAND, prof_t, (r1 > r0) ? (r1 - r0) * job->wc : 0);
+}
+
+///===============================================
+/// Renders the map into out (p->w * p->h floats, row-major) on nthreads
+/// threads (0 == all cores) and fills st (may be NULL) in the same pass.
+/// When the array is centered on the plate the map is mirror symmetric,
+/// so only one half or quadrant is computed. Results do not depend on
+/// the thread count. Returns 0, or -1 on bad input or allocation failure.
+
+int irr_render(const struct irr_array *a, const struct irr_plate *p, float *out,
+	int nthreads, struct irr_stats *st) {
+	 struct irr_job job;
+	 size_t nbands, npix = p->w * p->h, c, k;
+	 double dx = (double)p->width / p->w, n = (double)npix;
+	 double sum = 0, sumsq = 0, var;
+	 int i, rc = 0;
+
+	 if (a->cols < 1 || a->rows < 1 || a->rows > IRR_MAX_ROWS || !(a->height > 0)) return -1;
+	 if (a->order < 0 || a->order > IRR_MAX_ORDER) return -1;
+	 if (p->w == 0 || p->h == 0 || !(p->width > 0) || !(p->height > 0)) return -1;
+
+	 memset(&job, 0, sizeof job);
+	 job.a = a;
+	 job.p = p;
+	 job.out = out;
+	 job.mirror_x = (a->ox == 0);
+	 job.mirror_y = (a->oy == 0);
+	 job.wc = job.mirror_x ? (p->w + 1) / 2 : p->w;
+	 job.hc = job.mirror_y ? (p->h + 1) / 2 : p->h;
+	 job.stride = (job.wc + IRR_BLOCK - 1) / IRR_BLOCK * IRR_BLOCK;
+	 job.scale = a->intensity * pow(a->height, a->order + 1);
+	 job.shift = irr_point(a, 0, 0);
+	 nbands = (job.hc + IRR_TILE_ROWS - 1) / IRR_TILE_ROWS;
+	 nthreads = pool_threads(nthreads, nbands);
+
+	 job.ax = malloc((size_t)a->cols * job.stride * sizeof *job.ax);
+	 job.ey = malloc(a->rows * sizeof *job.ey);
+	 job.scratch = malloc((size_t)nthreads * IRR_TILE_ROWS * job.stride * sizeof *job.scratch);
+	 job.bands = malloc(nbands * sizeof *job.bands);
+	 if (job.ax == NULL || job.ey == NULL || job.scratch == NULL || job.bands == NULL) rc = -1;
+
+	 if (rc == 0) {
+		 /// Column terms, padding columns included so the kernels never
+		 /// need a remainder loop
+		 for (i = 0; i < a->cols; i++) {
+			 double xi = a->ox + (i - 0.5 * (a->cols - 1)) * a->pitch_x;
+			 for (c = 0; c < job.stride; c++) {
+				 double x = -0.5 * p->width + (c + 0.5) * dx;
+				 job.ax[i * job.stride + c] = (float)((x - xi) * (x - xi));
+			 }
+		 }
+		 for (i = 0; i < a->rows; i++) job.ey[i] = a->oy + (i - 0.5 * (a->rows - 1)) * a->pitch_y;
+		 rc = pool_run(nthreads, nbands, irr_band_task, &job);
+	 }
+
+	 if (rc == 0 && st != NULL) {
+		 st->min = INFINITY;
+		 st->max = -INFINITY;
+		 for (k = 0; k < nbands; k++) {
+			 if (job.bands[k].min < st->min) st->min = job.bands[k].min;
+			 if (job.bands[k].max > st->max) st->max = job.bands[k].max;
+			 sum += job.bands[k].sum;
+			 sumsq += job.bands[k].sumsq;
+		 }
+		 var = sumsq / n - (sum / n) * (sum / n);
+		 st->mean = job.shift + sum / n;
+		 st->stddev = (var > 0) ? sqrt(var) : 0;
+		 st->cov = (st->mean != 0) ? st->stddev / st->mean : 0;
+		 st->min_mean = (st->mean != 0) ? st->min / st->mean : 0;
+	 }
+
+	 free(job.ax);
+	 free(job.ey);
+	 free(job.scratch);
+	 free(job.bands);
+	 return rc;
+}
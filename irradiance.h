@@ -0,0 +1,65 @@
+// irradiance.h //
+#ifndef IRRADIANCE_H
+#define IRRADIANCE_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+
+#define IRR_ARRAY_COLS 		19
+#define IRR_ARRAY_ROWS 		6
+#define IRR_ARRAY_HEIGHT 	0.35	// meters, LED_ARRAY_RADIUS
+#define IRR_TILE_ROWS 		8	// plate rows per task
+#define IRR_TILE_COLS 		512	// plate columns per cache tile
+
+/** The LED array: cols x rows emitters on a rectangular pitch, facing
+	straight down from height above the plate, centered over the point
+	(ox, oy) of the plate. Each emitter is a generalized Lambertian source
+	I(theta) = intensity * cos^order(theta); order 1 is a plain Lambertian
+	LED and irr_lambert_order gives the order for a datasheet half angle.
+	intensity in candela gives a lux map, in W/sr an irradiance map in W/m^2.
+**/
+struct irr_array {
+    int 	cols;
+    int 	rows;
+    float 	pitch_x;	// meters between columns
+    float 	pitch_y;	// meters between rows
+    float 	height;		// meters above the plate
+    float 	ox;		// meters, array center over the plate
+    float 	oy;
+    float 	intensity;	// on-axis, per emitter
+    int 	order;		// 0 .. IRR_MAX_ORDER
+};
+
+#define IRR_MAX_ORDER 	60
+
+/** The sample plate, width x height meters centered on the origin and
+	sampled at the centers of w x h pixels. Pixel (i, j) is out[j*w + i].
+**/
+struct irr_plate {
+    size_t 	w;
+    size_t 	h;
+    float 	width;
+    float 	height;
+};
+
+/// Uniformity of the map
+struct irr_stats {
+    double 	min;
+    double 	max;
+    double 	mean;
+    double 	stddev;
+    double 	cov;		// stddev / mean
+    double 	min_mean;	// min / mean
+};
+
+int irr_lambert_order(double half_angle_deg);
+double irr_point(const struct irr_array *a, double x, double y);
+int irr_render(const struct irr_array *a, const struct irr_plate *p, float *out,
+	int nthreads, struct irr_stats *st);
+
+#endif
@@ -0,0 +1,257 @@
+// kernel.h //
+#ifndef KERNEL_H
+#define KERNEL_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** Quiet kernels for the circuit and intensity models.
+	These compute exactly what the calc_* and DE_* functions in
+	circuit.c and intensity.c compute, with the same expressions and the
+	same float/double types, but they never print. The calc_* functions
+	are wrappers that call a kernel and hand the result to the active
+	report sink (see report.h). Sweeps should call these directly.
+	The circuit and thermal kernels are written on the typed units of
+	units.h, which compile to the same float arithmetic.
+**/
+
+#include "constants.h"
+#include "units.h"
+
+/// DEFINITIONS FOR LED ARRAY THERMAL CALCULATIONS
+#define R_THETA_JA_TPS61169	263.8		// Junction to Ambient, in degrees C/Watt
+#define ROOM_TEMP1 25.0				// = 77 deg F
+#define ROOM_TEMP2 26.7 			// = 80.1 deg F
+#define ROOM_TEMP3 40.0 			// = 104.0 deg F
+#define MAX_TEMP_TPS61169 100.0			// = 212.0 deg F
+#define MAX_OP_JUNCT_TEMP_TPS61169 125.0	// = 257.0 deg F
+
+/// DEFINITIONS FOR THE LED ARRAY RESPONSE MODEL (DE_* functions)
+#define DE_LUX_SLOPE		30.0f	// lux per Ohm
+#define DE_MAX_LUX		1900	// lux at or below DE_MIN_RES
+#define DE_MIN_RES		10	// Ohms, resistor values below this are clamped
+#define DE_PERCENT_SLOPE	1.875f	// percent of max per Ohm
+#define DE_MAX_PERCENT		118.75f
+
+///===============================================
+
+/** This data structure holds one design point for the full
+	resistor -> current -> thermal -> lux chain.
+		1. voltage at the Feedback input
+		2. branch resistor value
+		3. number of branches
+		4. fixed resistor placed in parallel with the trim pot
+		5. R Theta JA of the driver
+		6. ambient temperature
+		7. temperature limit the margin is measured against
+**/
+struct C_design {
+    float 	v;		// voltage
+    float 	r;		// resistor
+    float 	num;		// number of branches
+    float 	fixed_res;	// fixed (trim) resistor
+    float 	rtja;		// junction to ambient, deg C/Watt
+    float 	amb;		// ambient temperature, deg C
+    float 	ojt;		// temperature limit, deg C
+};
+
+/// Everything the chain produces for one design point
+struct C_result {
+    float 	par_res;	// net parallel resistance
+    float 	var_res;	// variable resistance setting
+    float 	branch_i;	// branch current
+    float 	total_i;	// total current
+    float 	power;		// V*I power
+    float 	temp_rise;	// temperature rise (junction temperature)
+    float 	ojt_diff;	// OJT - temperature rise
+    int 	exceeded;	// 1 == temperature limit reached
+    float 	lux;		// LUX output
+    float 	percent;	// percent of maximum LUX
+};
+
+/// What DE_ResToAll reports
+struct DE_result {
+    float 	lux;		// lumen/m^2
+    float 	percent;	// percent of max
+    float 	res;		// resistor value after clamping
+};
+
+/** This data structure holds the test inputs for our circuit object. 
+	All we need are:
+		1. voltage at the Feedback input
+		2. current value
+		3. resistor value
+		4. number of branches
+**/
+struct C_test {
+    float 	v;	// voltage
+    float 	i; 	// current
+    float 	r;	// resistor
+    float 	num;	// number of branches 
+};
+
+/** This data structure holds the test inputs for our intensity object. 
+	All we need are:
+		1. The speed of light in whatever medium we are in
+		2. The refractive index of light in whatever medium we are in
+		3. The permittivity of free space
+		4. The strength of our electric field 
+**/
+struct I_test {
+    float 	c;		// speed of light in medium
+    float 	ri;		// refractive index of medium
+    float 	e0;		// permittivity of free space 
+    double 	Efield;	// electric field
+};
+
+///===============================================
+/// Circuit kernels (float, see circuit.c)
+
+static inline float k_parallel_resistance(float resistor_value, int num_branches) {
+	 return u_parallel(u_ohms(resistor_value), num_branches).val;
+}
+
+static inline float k_var_resistance(float desired_res, float fixed_res) {
+	 return u_trim(u_ohms(desired_res), u_ohms(fixed_res)).val;
+}
+
+static inline float k_output_resistance(float fixed_res, float var_res) {
+	 return u_parallel2(u_ohms(fixed_res), u_ohms(var_res)).val;
+}
+
+static inline float k_total_current(float voltage, float resistance, int num_branches) {
+	 return u_amps_scale(u_current(u_volts(voltage), u_ohms(resistance)), num_branches).val;
+}
+
+static inline float k_branch_current(float voltage, float resistance) {
+	 return u_current(u_volts(voltage), u_ohms(resistance)).val;
+}
+
+static inline float k_power_VI(float voltage, float current) {
+	 return u_power(u_volts(voltage), u_amps(current)).val;
+}
+
+/// (num * V) * I, each branch at V and I
+static inline float k_total_power(float voltage, float current, int num_branches) {
+	 return u_power(u_volts_scale(u_volts(voltage), num_branches), u_amps(current)).val;
+}
+
+///===============================================
+/// Thermal kernels
+
+/// Power dissipated across the driver: (Vin - Vout) * I
+static inline float k_pow_diss(float inVoltage, float outVoltage, float curr) {
+	 struct u_volts Vdrop = u_volts_sub(u_volts(inVoltage), u_volts(outVoltage));
+	 return u_power(Vdrop, u_amps(curr)).val;
+}
+
+static inline float k_temp_rise(float inVoltage, float outVoltage, float curr, float rtja, float amb) {
+	 struct u_watts pow_diss = u_watts(k_pow_diss(inVoltage, outVoltage, curr));
+	 return u_junction(pow_diss, u_cpw(rtja), u_celsius(amb)).val;
+}
+
+static inline int k_junct_temp_exceeded(float tempRise, float opJunct_Temp) {
+	 return (tempRise >= opJunct_Temp) ? 1 : 0;
+}
+
+static inline float k_temp_diff_OJT_TR(float tempRise, float opJunct_Temp) {
+	 return u_celsius_sub(u_celsius(opJunct_Temp), u_celsius(tempRise)).val;
+}
+
+///===============================================
+/// LED array response kernels
+
+static inline float k_clamp_res(float resistor) {
+	 return (resistor >= DE_MIN_RES) ? resistor : DE_MIN_RES;
+}
+
+static inline float k_ResToLux(float resistor) {
+	 resistor = k_clamp_res(resistor);
+	 return (DE_MAX_LUX - (resistor * DE_LUX_SLOPE) >= 0) ? DE_MAX_LUX - (resistor * DE_LUX_SLOPE) : 0;
+}
+
+static inline float k_ResToPercent(float resistor) {
+	 resistor = k_clamp_res(resistor);
+	 return (DE_MAX_PERCENT - (resistor * DE_PERCENT_SLOPE) >= 0) ? DE_MAX_PERCENT - (resistor * DE_PERCENT_SLOPE) : 0;
+}
+
+static inline struct DE_result k_ResToAll(float resistor) {
+	 struct DE_result result;
+	 result.lux = k_ResToLux(resistor);
+	 result.percent = k_ResToPercent(resistor);
+	 result.res = k_clamp_res(resistor);
+	 return result;
+}
+
+///===============================================
+/// The chain's arithmetic, written once for every type it runs in: T is
+/// float or double for one design point (k_chain, precision.h), or a
+/// vector type for batch.c. Declares k_par .. k_pct of type T and k_exc
+/// of TI from inputs of type T, num already truncated to whole branches.
+/// K(T, x) makes the constant x of type T and SEL(T, TI, c, a, b) picks a
+/// where c holds, b elsewhere. The expressions are those of the k_*
+/// kernels above, so in float the results are theirs bit for bit.
+
+#define K_CHAIN_BODY(T, TI, K, SEL, v, r, num, fixed, rtja, amb, ojt) \
+	 T k_par = K(T, 1) / ((num) * (K(T, 1) / (r))); \
+	 T k_var = ((fixed) * k_par) / ((fixed) - k_par); \
+	 T k_bi = (v) / (r); \
+	 T k_ti = (num) * k_bi; \
+	 T k_pw = (v) * k_ti; \
+	 T k_tr = ((rtja) * (((v) - K(T, 0)) * k_ti)) + (amb); \
+	 T k_ojt_diff = (ojt) - k_tr; \
+	 TI k_exc = (k_tr >= (ojt)) & 1; \
+	 T k_rc = SEL(T, TI, (r) >= K(T, DE_MIN_RES), (r), K(T, DE_MIN_RES)); \
+	 T k_lux = K(T, DE_MAX_LUX) - k_rc * K(T, DE_LUX_SLOPE); \
+	 T k_pct = K(T, DE_MAX_PERCENT) - k_rc * K(T, DE_PERCENT_SLOPE); \
+	 k_lux = SEL(T, TI, k_lux >= K(T, 0), k_lux, K(T, 0)); \
+	 k_pct = SEL(T, TI, k_pct >= K(T, 0), k_pct, K(T, 0))
+
+/// The K and SEL of K_CHAIN_BODY for scalar types
+#define K_CONST(T, x) 			((T)(x))
+#define K_SELECT(T, TI, c, a, b) 	((c) ? (a) : (b))
+
+///===============================================
+/// Runs one design point through the whole chain, in the same order
+/// as the sweep loops in circuit.c main():
+/// parallel resistance -> var resistance -> currents -> power ->
+/// temperature rise -> OJT margin -> lux/percent
+
+static inline void k_chain(const struct C_design *d, struct C_result *out) {
+	 K_CHAIN_BODY(float, int, K_CONST, K_SELECT, d->v, d->r, (float)(int)d->num, d->fixed_res,
+		d->rtja, d->amb, d->ojt);
+	 out->par_res = k_par;
+	 out->var_res = k_var;
+	 out->branch_i = k_bi;
+	 out->total_i = k_ti;
+	 out->power = k_pw;
+	 out->temp_rise = k_tr;
+	 out->ojt_diff = k_ojt_diff;
+	 out->exceeded = k_exc;
+	 out->lux = k_lux;
+	 out->percent = k_pct;
+}
+
+///===============================================
+/// Intensity kernels (double, see intensity.c)
+
+static inline double k_intensity(int c, double ri, double eps0, double efield) {
+	 return ((c * ri * eps0)/(2)) * (efield*efield);
+}
+
+static inline double k_irradiance(int c, double mu0, double efield) {
+	 return (efield*efield)/(c * mu0);
+}
+
+static inline double k_Electric_Field(double num_charges, double charge, double radius) {
+	 return E_CONSTANT * (2*(charge))/(radius*radius);
+}
+
+static inline double k_Lux(double received_illuminance, double reflectance) {
+	 return (received_illuminance * reflectance)/PI;
+}
+
+#endif
@@ -44,26 +44,11 @@
 #include <check.h>
 #include "intensity.h"
 #include "circuit.h"
+#include "constants.h"
+#include "stream.h"
+#include "prof.h"
 
-/// STANDARD DEFINITIONS FOR PROJECT SCICALC 
-#define PI		3.14159265358979323846 // ad infinitum
-#define LIGHT_SPEED	299792458.0 // meters per second
-#define DATA_SIZE 	1000
-#define MICRO 		1.0e-6
-#define NANO 		1.0e-9
-#define PICO 		1.0e-12
-#define KILO 		1.0e3
-#define MEGA 		1.0e6
-#define GIGA 		1.0e9
-#define TERA 		1.0e12 
-#define AIR_REFRACTIVE_INDEX 1.00027717
-#define E0 		8.8541878128*PICO	// Permittivity of Free Space in Farads per meter
-#define MU0 		1.25663706212*MICRO	// Permeability of Free Space in Newtons per square meter
-#define EPSILON_0 	1/(MU0*(LIGHT_SPEED*LIGHT_SPEED)) // Permittivity of Free Space Equation
-#define ELECTRON_CHARGE 1.6e-19 // Charge of an electron in Coulombs
-#define RADIUS_HELIUM_ATOM 26.5e-12
-#define LED_ARRAY_RADIUS 0.35 // meters from LED array to sample plate
-#define E_CONSTANT 	1/(4*PI*EPSILON_0)
+/// STANDARD DEFINITIONS and the physical constants are in constants.h
 
 void getUserInput(){
 	int exitFlag = 0;	
@@ -123,7 +108,44 @@ void getUserInput(){
 	//~ else getUserInput();
 }
 
+/// Streaming mode: main -b [file] reads text records, main -B [file]
+/// binary ones (see stream.h), from stdin when file is missing or "-".
+/// Results go to stdout and the record counts to stderr. Built with
+/// PROF=1 it also prints the probe summary to stderr, and writes a
+/// trace to the file named by PROF_TRACE if that is set.
+int runStream(int argc, char const *argv[]) {
+	struct stream_config cfg = { STREAM_TEXT, 0, 0, 0, 0 };
+	struct stream_stats st;
+	FILE *in = stdin;
+	int rc;
+
+	if (0 == strcmp(argv[1], "-B")) cfg.format = STREAM_BINARY;
+	if (argc > 2 && 0 != strcmp(argv[2], "-")) {
+		in = fopen(argv[2], (cfg.format == STREAM_BINARY) ? "rb" : "r");
+		if (NULL == in) {
+			fprintf(stderr, "cannot open %s\n", argv[2]);
+			return 1;
+		}
+	}
+	prof_trace(getenv("PROF_TRACE") != NULL);
+	prof_reset();
+	rc = stream_run(in, stdout, &cfg, &st);
+	if (in != stdin) fclose(in);
+	fprintf(stderr, "%zu records (%zu C, %zu I), %zu bad", st.records, st.c_records, st.i_records, st.bad);
+	if (st.bad) fprintf(stderr, ", first at %s %zu", (cfg.format == STREAM_BINARY) ? "record" : "line", st.first_bad);
+	fprintf(stderr, "\n");
+	if (0 != rc) fprintf(stderr, "stream failed\n");
+#ifdef PROF_ENABLE
+	prof_summary(stderr);
+	if (NULL != getenv("PROF_TRACE") && 0 != prof_write_trace(getenv("PROF_TRACE"))) {
+		fprintf(stderr, "cannot write %s\n", getenv("PROF_TRACE"));
+	}
+#endif
+	return (0 != rc) ? 1 : 0;
+}
+
 int main(int argc, char const *argv[]) {
+  if (argc > 1 && (0 == strcmp(argv[1], "-b") || 0 == strcmp(argv[1], "-B"))) return runStream(argc, argv);
   printf("\nRunning main\n");
   getUserInput();
   //~ double ari = AIR_REFRACTIVE_INDEX;
@@ -29,47 +29,290 @@
 #************************************************************************
 
 CC=gcc
-CFLAGS=-Wall -g
+CFLAGS=-Wall -g -O2 -fno-math-errno -fno-trapping-math -ffp-contract=off
+## -ffp-contract=off: the cpu.h kernel variants must round alike, so no
+## multiply-add is ever fused, AVX-512 or not
+
+## make -f make-test.mk PROF=1 ... builds with the prof.h probes compiled in
+ifdef PROF
+CFLAGS += -DPROF_ENABLE
+PROF_OBJ = prof.o
+endif
+
 DEPS =	main.c \
 	intensity.c intensity.h \
 	circuit.c circuit.h \
+	kernel.h constants.h units.h report.c report.h \
+	batch.c batch.h \
+	pool.c pool.h sweep.c sweep.h \
+	montecarlo.c montecarlo.h \
+	inverse.c inverse.h \
+	eseries.c eseries.h \
+	curve.c curve.h \
+	irradiance.c irradiance.h \
+	gaussbeam.c gaussbeam.h \
+	thermal.c thermal.h \
+	mna.c mna.h \
+	electrothermal.c electrothermal.h \
+	stream.c stream.h \
+	bench.c \
+	prof.c prof.h \
+	precision.c precision.h \
+	cpu.c cpu.h \
+	memo.c memo.h \
+	model.c model.h \
+	sens.c sens.h \
+	interval.c interval.h \
+	colfile.c colfile.h \
+	photometry.c photometry.h \
+	refine.c refine.h \
+	testgrid.h \
 		
 OBJ = 	main.o \
 	circuit.o \
 	intensity.o \
+	report.o \
+	batch.o \
+	pool.o \
+	sweep.o \
+	montecarlo.o \
+	inverse.o \
+	eseries.o \
+	curve.o \
+	irradiance.o \
+	gaussbeam.o \
+	thermal.o \
+	mna.o \
+	electrothermal.o \
+	stream.o \
+	bench.o \
+	prof.o \
+	precision.o \
+	cpu.o \
+	memo.o \
+	model.o \
+	sens.o \
+	interval.o \
+	colfile.o \
+	photometry.o \
+	refine.o \
 	intensitytest.o \
-	circuittest.o
+	circuittest.o \
+	batchtest.o \
+	sweeptest.o \
+	montecarlotest.o \
+	inversetest.o \
+	eseriestest.o \
+	curvetest.o \
+	irradiancetest.o \
+	gaussbeamtest.o \
+	thermaltest.o \
+	mnatest.o \
+	electrothermaltest.o \
+	streamtest.o \
+	proftest.o \
+	precisiontest.o \
+	cputest.o \
+	memotest.o \
+	modeltest.o \
+	senstest.o \
+	intervaltest.o \
+	colfiletest.o \
+	photometrytest.o \
+	refinetest.o
 	
 DEBUG=-g
 LIBS=-lcheck -lm -lpthread -lrt -lsubunit -lcheck_pic
 
 #************************************************************************
 ##### AUTOMATED TEST BATTERIES ##### 
-all: main circuit intensity intensitytest circuittest
+all: main circuit intensity intensitytest circuittest batchtest sweeptest montecarlotest inversetest eseriestest curvetest irradiancetest gaussbeamtest thermaltest mnatest electrothermaltest streamtest proftest precisiontest cputest memotest modeltest senstest intervaltest colfiletest photometrytest refinetest
 
 ## TARGETS
-main: $(OBJ)
-	$(CC) $(CFLAGS) -o main main.o $(LIBS)
+main: $(OBJ) $(PROF_OBJ)
+	$(CC) $(CFLAGS) -o main main.o stream.o batch.o cpu.o $(PROF_OBJ) $(LIBS)
 
-circuit: $(OBJ)
-	$(CC) $(CFLAGS) -o circuit circuit.o $(LIBS)
+circuit: $(OBJ) $(PROF_OBJ)
+	$(CC) $(CFLAGS) -DCIRCUIT_MAIN -o circuit circuit.c report.o $(PROF_OBJ) $(LIBS)
 
-intensity: $(OBJ)
-	$(CC) $(CFLAGS) -o intensity intensity.o $(LIBS)
+intensity: $(OBJ) $(PROF_OBJ)
+	$(CC) $(CFLAGS) -o intensity intensity.o report.o $(PROF_OBJ) $(LIBS)
 
 intensitytest.o: $(DEPS) 
 	checkmk intensitytest.check >intensitytest.c
 	$(CC) $(CFLAGS) -c intensitytest.c	
 	
-intensitytest: intensitytest.o 
-	$(CC) -o intensitytest intensitytest.o $(LIBS)
+intensitytest: intensitytest.o report.o $(PROF_OBJ)
+	$(CC) -o intensitytest intensitytest.o report.o $(PROF_OBJ) $(LIBS)
 
 circuittest.o: $(DEPS) 
 	checkmk circuittest.check >circuittest.c
 	$(CC) $(CFLAGS) -c circuittest.c	
 	
-circuittest: circuittest.o 
-	$(CC) -o circuittest circuittest.o $(LIBS)
+circuittest: circuittest.o report.o $(PROF_OBJ)
+	$(CC) -o circuittest circuittest.o report.o $(PROF_OBJ) $(LIBS)
+
+batchtest.o: $(DEPS) 
+	checkmk batchtest.check >batchtest.c
+	$(CC) $(CFLAGS) -c batchtest.c	
+	
+batchtest: batchtest.o cpu.o $(PROF_OBJ)
+	$(CC) -o batchtest batchtest.o cpu.o $(PROF_OBJ) $(LIBS)
+
+sweeptest.o: $(DEPS) 
+	checkmk sweeptest.check >sweeptest.c
+	$(CC) $(CFLAGS) -c sweeptest.c	
+	
+sweeptest: sweeptest.o batch.o pool.o precision.o cpu.o memo.o colfile.o $(PROF_OBJ)
+	$(CC) -o sweeptest sweeptest.o batch.o pool.o precision.o cpu.o memo.o colfile.o $(PROF_OBJ) $(LIBS)
+
+montecarlotest.o: $(DEPS) 
+	checkmk montecarlotest.check >montecarlotest.c
+	$(CC) $(CFLAGS) -c montecarlotest.c	
+	
+montecarlotest: montecarlotest.o pool.o $(PROF_OBJ)
+	$(CC) -o montecarlotest montecarlotest.o pool.o $(PROF_OBJ) $(LIBS)
+
+inversetest.o: $(DEPS) 
+	checkmk inversetest.check >inversetest.c
+	$(CC) $(CFLAGS) -c inversetest.c	
+	
+inversetest: inversetest.o $(PROF_OBJ)
+	$(CC) -o inversetest inversetest.o $(PROF_OBJ) $(LIBS)
+
+eseriestest.o: $(DEPS) 
+	checkmk eseriestest.check >eseriestest.c
+	$(CC) $(CFLAGS) -c eseriestest.c	
+	
+eseriestest: eseriestest.o $(PROF_OBJ)
+	$(CC) -o eseriestest eseriestest.o $(PROF_OBJ) $(LIBS)
+
+curvetest.o: $(DEPS) 
+	checkmk curvetest.check >curvetest.c
+	$(CC) $(CFLAGS) -c curvetest.c	
+	
+curvetest: curvetest.o $(PROF_OBJ)
+	$(CC) -o curvetest curvetest.o $(PROF_OBJ) $(LIBS)
+
+irradiancetest.o: $(DEPS) 
+	checkmk irradiancetest.check >irradiancetest.c
+	$(CC) $(CFLAGS) -c irradiancetest.c	
+	
+irradiancetest: irradiancetest.o pool.o cpu.o $(PROF_OBJ)
+	$(CC) -o irradiancetest irradiancetest.o pool.o cpu.o $(PROF_OBJ) $(LIBS)
+
+gaussbeamtest.o: $(DEPS) 
+	checkmk gaussbeamtest.check >gaussbeamtest.c
+	$(CC) $(CFLAGS) -c gaussbeamtest.c	
+	
+gaussbeamtest: gaussbeamtest.o $(PROF_OBJ)
+	$(CC) -o gaussbeamtest gaussbeamtest.o $(PROF_OBJ) $(LIBS)
+
+thermaltest.o: $(DEPS) 
+	checkmk thermaltest.check >thermaltest.c
+	$(CC) $(CFLAGS) -c thermaltest.c	
+	
+thermaltest: thermaltest.o pool.o cpu.o $(PROF_OBJ)
+	$(CC) -o thermaltest thermaltest.o pool.o cpu.o $(PROF_OBJ) $(LIBS)
+
+mnatest.o: $(DEPS) 
+	checkmk mnatest.check >mnatest.c
+	$(CC) $(CFLAGS) -c mnatest.c	
+	
+mnatest: mnatest.o $(PROF_OBJ)
+	$(CC) -o mnatest mnatest.o $(PROF_OBJ) $(LIBS)
+
+electrothermaltest.o: $(DEPS) 
+	checkmk electrothermaltest.check >electrothermaltest.c
+	$(CC) $(CFLAGS) -c electrothermaltest.c	
+	
+electrothermaltest: electrothermaltest.o batch.o pool.o cpu.o $(PROF_OBJ)
+	$(CC) -o electrothermaltest electrothermaltest.o batch.o pool.o cpu.o $(PROF_OBJ) $(LIBS)
+
+streamtest.o: $(DEPS) 
+	checkmk streamtest.check >streamtest.c
+	$(CC) $(CFLAGS) -c streamtest.c	
+	
+streamtest: streamtest.o batch.o cpu.o $(PROF_OBJ)
+	$(CC) -o streamtest streamtest.o batch.o cpu.o $(PROF_OBJ) $(LIBS)
+
+proftest.o: $(DEPS) 
+	checkmk proftest.check >proftest.c
+	$(CC) $(CFLAGS) -c proftest.c	
+	
+proftest: proftest.o pool.o
+	$(CC) -o proftest proftest.o pool.o $(LIBS)
+
+precisiontest.o: $(DEPS) 
+	checkmk precisiontest.check >precisiontest.c
+	$(CC) $(CFLAGS) -c precisiontest.c	
+	
+precisiontest: precisiontest.o batch.o pool.o sweep.o cpu.o memo.o colfile.o $(PROF_OBJ)
+	$(CC) -o precisiontest precisiontest.o batch.o pool.o sweep.o cpu.o memo.o colfile.o $(PROF_OBJ) $(LIBS)
+
+cputest.o: $(DEPS) 
+	checkmk cputest.check >cputest.c
+	$(CC) $(CFLAGS) -c cputest.c	
+	
+cputest: cputest.o batch.o thermal.o irradiance.o pool.o $(PROF_OBJ)
+	$(CC) -o cputest cputest.o batch.o thermal.o irradiance.o pool.o $(PROF_OBJ) $(LIBS)
+
+memotest.o: $(DEPS) 
+	checkmk memotest.check >memotest.c
+	$(CC) $(CFLAGS) -c memotest.c	
+	
+memotest: memotest.o batch.o pool.o sweep.o precision.o cpu.o colfile.o $(PROF_OBJ)
+	$(CC) -o memotest memotest.o batch.o pool.o sweep.o precision.o cpu.o colfile.o $(PROF_OBJ) $(LIBS)
+
+modeltest.o: $(DEPS) 
+	checkmk modeltest.check >modeltest.c
+	$(CC) $(CFLAGS) -c modeltest.c	
+	
+modeltest: modeltest.o batch.o cpu.o $(PROF_OBJ)
+	$(CC) -o modeltest modeltest.o batch.o cpu.o $(PROF_OBJ) $(LIBS)
+
+senstest.o: $(DEPS) 
+	checkmk senstest.check >senstest.c
+	$(CC) $(CFLAGS) -c senstest.c	
+	
+senstest: senstest.o batch.o cpu.o $(PROF_OBJ)
+	$(CC) -o senstest senstest.o batch.o cpu.o $(PROF_OBJ) $(LIBS)
+
+intervaltest.o: $(DEPS) 
+	checkmk intervaltest.check >intervaltest.c
+	$(CC) $(CFLAGS) -c intervaltest.c	
+	
+intervaltest: intervaltest.o $(PROF_OBJ)
+	$(CC) -o intervaltest intervaltest.o $(PROF_OBJ) $(LIBS)
+
+colfiletest.o: $(DEPS) 
+	checkmk colfiletest.check >colfiletest.c
+	$(CC) $(CFLAGS) -c colfiletest.c	
+	
+colfiletest: colfiletest.o batch.o pool.o sweep.o precision.o cpu.o memo.o $(PROF_OBJ)
+	$(CC) -o colfiletest colfiletest.o batch.o pool.o sweep.o precision.o cpu.o memo.o $(PROF_OBJ) $(LIBS)
+
+photometrytest.o: $(DEPS) 
+	checkmk photometrytest.check >photometrytest.c
+	$(CC) $(CFLAGS) -c photometrytest.c	
+	
+photometrytest: photometrytest.o cpu.o $(PROF_OBJ)
+	$(CC) -o photometrytest photometrytest.o cpu.o $(PROF_OBJ) $(LIBS)
+
+refinetest.o: $(DEPS) 
+	checkmk refinetest.check >refinetest.c
+	$(CC) $(CFLAGS) -c refinetest.c	
+	
+refinetest: refinetest.o batch.o cpu.o $(PROF_OBJ)
+	$(CC) -o refinetest refinetest.o batch.o cpu.o $(PROF_OBJ) $(LIBS)
+
+## Benchmarks: builds and runs bench, leaving the results in bench.csv.
+## Pass a baseline to fail on regressions, e.g.
+## make -f make-test.mk bench BENCH_FLAGS="-b bench.baseline -r 10"
+.PHONY: bench
+bench: bench.o circuit.o intensity.o report.o batch.o sweep.o pool.o precision.o cpu.o memo.o model.o sens.o colfile.o photometry.o $(PROF_OBJ)
+	$(CC) $(CFLAGS) -o bench bench.o circuit.o intensity.o report.o batch.o sweep.o pool.o precision.o cpu.o memo.o model.o sens.o colfile.o photometry.o $(PROF_OBJ) $(LIBS)
+	./bench -o bench.csv $(BENCH_FLAGS)
 
 clean:
 	rm -f $(OBJ)
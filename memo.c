@@ -0,0 +1,318 @@
+///	Package:	circuit
+///	File:		memo.c
+///	Purpose:	Persistent, memory-mapped memo of chain results
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "kernel.h"
+#include "batch.h"
+#include "precision.h"
+#include "memo.h"
+
+_Static_assert(sizeof(struct memo_header) == 64, "memo_header is the first 64 bytes of the file");
+_Static_assert(sizeof(struct memo_slot) == 80, "memo_slot layout is part of the file format");
+
+///===============================================
+/// FNV-1a, 64 bits
+
+static uint64_t memo_fnv(uint64_t h, const void *p, size_t n) {
+	 const unsigned char *c = p;
+	 size_t k;
+	 for (k = 0; k < n; k++) h = (h ^ c[k]) * 0x100000001b3ULL;
+	 return h;
+}
+
+/// The model as the memo sees it: MEMO_VERSION, the slot layout and
+/// the chain's results on probe designs that between them reach every
+/// constant of the chain, in float and in double.
+uint64_t memo_fingerprint(void) {
+	 const struct C_design probes[] = {
+		{ 0.21, 24.9, 19, 3.3, R_THETA_JA_TPS61169, ROOM_TEMP1, MAX_TEMP_TPS61169 },
+		{ 0.20, 5, 6, 47, R_THETA_JA_TPS61169, ROOM_TEMP3, MAX_OP_JUNCT_TEMP_TPS61169 },
+		{ 0.35, 70, 1, 10, R_THETA_JA_TPS61169, ROOM_TEMP2, MAX_TEMP_TPS61169 },
+		{ 1.5, 2.2, 24, 4.7, R_THETA_JA_TPS61169, ROOM_TEMP1, MAX_OP_JUNCT_TEMP_TPS61169 } };
+	 uint64_t h = 0xcbf29ce484222325ULL, v = MEMO_VERSION, sz = sizeof(struct memo_slot);
+	 size_t k;
+
+	 h = memo_fnv(h, &v, sizeof v);
+	 h = memo_fnv(h, &sz, sizeof sz);
+	 for (k = 0; k < sizeof probes / sizeof probes[0]; k++) {
+		 struct C_result res;
+		 double out[PREC_NOUT];
+		 int exceeded;
+		 k_chain(&probes[k], &res);
+		 prec_chain_d(&probes[k], out, &exceeded);
+		 h = memo_fnv(h, &res, sizeof res);
+		 h = memo_fnv(h, out, sizeof out);
+		 h = memo_fnv(h, &exceeded, sizeof exceeded);
+	 }
+	 return h;
+}
+
+/// Mixes a key as four 64-bit words, in two chains that run side by
+/// side rather than one eight multiplies long
+static uint64_t memo_hash(const struct memo_key *k) {
+	 uint64_t w[4], a, b, h;
+	 memcpy(w, k, sizeof w);
+	 a = (w[0] ^ 0x9e3779b97f4a7c15ULL) * 0xff51afd7ed558ccdULL + w[1] * 0xc4ceb9fe1a85ec53ULL;
+	 b = (w[2] ^ 0x94d049bb133111ebULL) * 0xbf58476d1ce4e5b9ULL + w[3] * 0x9e3779b97f4a7c15ULL;
+	 a ^= a >> 32;
+	 b ^= b >> 29;
+	 h = (a ^ (b << 17 | b >> 47)) * 0xff51afd7ed558ccdULL;
+	 return h ^ (h >> 32);
+}
+
+///===============================================
+/// File handling. Every opener takes an exclusive flock while it checks
+/// or sets up the file, and lets go once it is mapped; from then on all
+/// access is through the slot states.
+
+static int memo_header_ok(const struct memo_header *h, uint64_t fp, off_t size) {
+	 return memcmp(h->magic, MEMO_MAGIC, sizeof h->magic) == 0 && h->fingerprint == fp
+		&& h->slot_size == sizeof(struct memo_slot) && h->nslots >= MEMO_MIN_SLOTS
+		&& (h->nslots & (h->nslots - 1)) == 0
+		&& (uint64_t)size == sizeof *h + h->nslots * sizeof(struct memo_slot);
+}
+
+/// Sizes fd for nslots empty slots and writes the header. Returns 0 or -1.
+static int memo_init(int fd, size_t nslots, uint64_t fp) {
+	 struct memo_header h;
+	 memset(&h, 0, sizeof h);
+	 memcpy(h.magic, MEMO_MAGIC, sizeof h.magic);
+	 h.fingerprint = fp;
+	 h.nslots = nslots;
+	 h.slot_size = sizeof(struct memo_slot);
+	 if (ftruncate(fd, 0) != 0 || ftruncate(fd, sizeof h + nslots * sizeof(struct memo_slot)) != 0) return -1;
+	 return (pwrite(fd, &h, sizeof h, 0) == sizeof h) ? 0 : -1;
+}
+
+/// A new file set up beside path and renamed over it, so whoever still
+/// maps the old one is left alone. Returns its descriptor, or -1.
+static int memo_replace(const char *path, size_t nslots, uint64_t fp) {
+	 size_t len = strlen(path);
+	 char *tmp = malloc(len + 8);
+	 int fd;
+
+	 if (tmp == NULL) return -1;
+	 memcpy(tmp, path, len);
+	 memcpy(tmp + len, ".XXXXXX", 8);
+	 fd = mkstemp(tmp);
+	 if (fd >= 0 && (fchmod(fd, 0644) != 0 || memo_init(fd, nslots, fp) != 0 || rename(tmp, path) != 0)) {
+		 close(fd);
+		 unlink(tmp);
+		 fd = -1;
+	 }
+	 free(tmp);
+	 return fd;
+}
+
+///===============================================
+/// Opens, or creates, the memo at path. A new file gets nslots slots,
+/// rounded up to a power of 2 and at least MEMO_MIN_SLOTS; an existing
+/// one for this model keeps its size. Returns 0, or -1 on an I/O or
+/// mapping failure.
+
+int memo_open(struct memo *m, const char *path, size_t nslots) {
+	 struct memo_header h;
+	 struct stat st, sp;
+	 uint64_t fp = memo_fingerprint();
+	 size_t n = MEMO_MIN_SLOTS;
+	 void *map;
+	 int fd, ok;
+
+	 memset(m, 0, sizeof *m);
+	 while (n < nslots) n *= 2;
+	 for (;;) {
+		 fd = open(path, O_RDWR | O_CREAT, 0644);
+		 if (fd < 0) return -1;
+		 if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+			 close(fd);
+			 return -1;
+		 }
+		 /// Someone replaced it while we waited for the lock
+		 if (stat(path, &sp) == 0 && sp.st_ino == st.st_ino && sp.st_dev == st.st_dev) break;
+		 close(fd);
+	 }
+
+	 ok = (st.st_size >= (off_t)sizeof h && pread(fd, &h, sizeof h, 0) == sizeof h
+		&& memo_header_ok(&h, fp, st.st_size));
+	 if (ok) {
+		 n = h.nslots;
+	 } else if (st.st_size == 0) {
+		 ok = (memo_init(fd, n, fp) == 0);
+	 } else {
+		 /// Another model's results, or a damaged file
+		 int nfd = memo_replace(path, n, fp);
+		 close(fd);
+		 fd = nfd;
+		 ok = (fd >= 0);
+	 }
+	 if (!ok) {
+		 if (fd >= 0) close(fd);
+		 return -1;
+	 }
+
+	 m->bytes = sizeof(struct memo_header) + n * sizeof(struct memo_slot);
+	 map = mmap(NULL, m->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	 /// The mapping keeps the open file, and with it the lock, alive
+	 flock(fd, LOCK_UN);
+	 close(fd);
+	 if (map == MAP_FAILED) {
+		 memset(m, 0, sizeof *m);
+		 return -1;
+	 }
+	 m->hdr = map;
+	 m->slots = (struct memo_slot *)((char *)map + sizeof(struct memo_header));
+	 m->mask = n - 1;
+	 return 0;
+}
+
+void memo_close(struct memo *m) {
+	 if (m->hdr != NULL) munmap(m->hdr, m->bytes);
+	 memset(m, 0, sizeof *m);
+}
+
+size_t memo_used(const struct memo *m) {
+	 return atomic_load_explicit(&m->hdr->used, memory_order_relaxed);
+}
+
+///===============================================
+/// The key of row i of b
+
+void memo_key(const struct C_batch *b, size_t i, enum prec_mode mode, struct memo_key *k) {
+	 k->mode = mode;
+	 k->in[0] = b->v[i];
+	 k->in[1] = b->r[i];
+	 k->in[2] = (float)(int)b->num[i];
+	 k->in[3] = b->fixed_res[i];
+	 k->in[4] = b->rtja[i];
+	 k->in[5] = b->amb[i];
+	 k->in[6] = b->ojt[i];
+}
+
+static const struct memo_slot *memo_lookup(const struct memo *m, const struct memo_key *k, uint64_t h) {
+	 uint32_t tag = (uint32_t)(h >> 32);
+	 size_t j;
+
+	 for (j = 0; j < MEMO_PROBE; j++) {
+		 const struct memo_slot *s = &m->slots[(h + j) & m->mask];
+		 uint32_t st = atomic_load_explicit(&s->state, memory_order_acquire);
+		 if (st == MEMO_EMPTY) return NULL;
+		 if (st == MEMO_FULL && s->tag == tag && memcmp(&s->key, k, sizeof *k) == 0) return s;
+	 }
+	 return NULL;
+}
+
+/// The slot holding k's results, or NULL. The pointer is into the map
+/// and stays valid until memo_close.
+const struct memo_slot *memo_find(const struct memo *m, const struct memo_key *k) {
+	 return memo_lookup(m, k, memo_hash(k));
+}
+
+/// Stores row i of b's results under k. Returns 0, or -1 if the table
+/// is too full to take it.
+int memo_put(struct memo *m, const struct memo_key *k, const struct C_batch *b, size_t i) {
+	 uint64_t h = memo_hash(k);
+	 size_t j;
+
+	 if (memo_used(m) >= MEMO_MAX_LOAD * (m->mask + 1)) return -1;
+	 for (j = 0; j < MEMO_PROBE; j++) {
+		 struct memo_slot *s = &m->slots[(h + j) & m->mask];
+		 uint32_t st = MEMO_EMPTY;
+		 if (!atomic_compare_exchange_strong_explicit(&s->state, &st, MEMO_BUSY,
+			memory_order_acquire, memory_order_relaxed)) continue;
+		 atomic_fetch_add_explicit(&m->hdr->used, 1, memory_order_relaxed);
+		 s->tag = (uint32_t)(h >> 32);
+		 s->key = *k;
+		 s->out[PREC_PAR_RES] = b->par_res[i];
+		 s->out[PREC_VAR_RES] = b->var_res[i];
+		 s->out[PREC_BRANCH_I] = b->branch_i[i];
+		 s->out[PREC_TOTAL_I] = b->total_i[i];
+		 s->out[PREC_POWER] = b->power[i];
+		 s->out[PREC_TEMP_RISE] = b->temp_rise[i];
+		 s->out[PREC_OJT_DIFF] = b->ojt_diff[i];
+		 s->out[PREC_LUX] = b->lux[i];
+		 s->out[PREC_PERCENT] = b->percent[i];
+		 s->exceeded = b->exceeded[i];
+		 atomic_store_explicit(&s->state, MEMO_FULL, memory_order_release);
+		 return 0;
+	 }
+	 return -1;
+}
+
+/// Copies s's results into row i of b
+void memo_get(const struct memo_slot *s, struct C_batch *b, size_t i) {
+	 b->par_res[i] = s->out[PREC_PAR_RES];
+	 b->var_res[i] = s->out[PREC_VAR_RES];
+	 b->branch_i[i] = s->out[PREC_BRANCH_I];
+	 b->total_i[i] = s->out[PREC_TOTAL_I];
+	 b->power[i] = s->out[PREC_POWER];
+	 b->temp_rise[i] = s->out[PREC_TEMP_RISE];
+	 b->ojt_diff[i] = s->out[PREC_OJT_DIFF];
+	 b->lux[i] = s->out[PREC_LUX];
+	 b->percent[i] = s->out[PREC_PERCENT];
+	 b->exceeded[i] = s->exceeded;
+}
+
+///===============================================
+/// Batch helpers for the sweep. memo_fetch looks up rows [0, n) of b
+/// and copies nothing: hit[i] is row i's slot in the map, or NULL, and
+/// the NULL rows are listed in miss, their count returned. Each slot is
+/// a cache miss, and a TLB miss too once the table is of any size, so the
+/// slots of the next MEMO_AHEAD rows are prefetched, both lines of
+/// them, while this one is probed. memo_store remembers rows [0, n)
+/// and returns how many it kept.
+
+#define MEMO_AHEAD 	16		// a power of 2
+
+size_t memo_fetch(const struct memo *m, const struct C_batch *b, size_t n, enum prec_mode mode,
+	const struct memo_slot **hit, size_t *miss) {
+	 struct memo_key k[MEMO_AHEAD];
+	 uint64_t h[MEMO_AHEAD];
+	 size_t i, nmiss = 0;
+
+	 for (i = 0; i < n + MEMO_AHEAD; i++) {
+		 size_t a = i % MEMO_AHEAD;
+		 if (i >= MEMO_AHEAD) {
+			 size_t j = i - MEMO_AHEAD;
+			 hit[j] = memo_lookup(m, &k[a], h[a]);
+			 if (hit[j] == NULL) miss[nmiss++] = j;
+		 }
+		 if (i < n) {
+			 const char *s;
+			 memo_key(b, i, mode, &k[a]);
+			 h[a] = memo_hash(&k[a]);
+			 s = (const char *)&m->slots[h[a] & m->mask];
+			 __builtin_prefetch(s);
+			 __builtin_prefetch(s + sizeof(struct memo_slot) - 1);
+		 }
+	 }
+	 return nmiss;
+}
+
+size_t memo_store(struct memo *m, const struct C_batch *b, size_t n, enum prec_mode mode) {
+	 size_t i, kept = 0;
+
+	 for (i = 0; i < n; i++) {
+		 struct memo_key k;
+		 memo_key(b, i, mode, &k);
+		 if (memo_put(m, &k, b, i) == 0) kept++;
+	 }
+	 return kept;
+}
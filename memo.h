@@ -0,0 +1,114 @@
+// memo.h //
+#ifndef MEMO_H
+#define MEMO_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "kernel.h"
+#include "batch.h"
+#include "precision.h"
+
+/** Persistent memo of chain results, content addressed: a result is
+	found by its inputs, so repeated and overlapping sweeps only compute
+	the points no earlier run has. The table lives in a file mapped
+	MAP_SHARED and results are read where they lie: memo_find and
+	memo_fetch hand out pointers to slots in the mapping, and a sweep
+	reduces its hits from those. memo_get copies a slot into a batch row
+	for the callers that want whole rows, a sweep hook or column file.
+
+	The key is the design point with num truncated to the branch count
+	the chain uses, plus the precision it was computed in. Other inputs
+	are compared bit for bit, so -0 and 0 are different points, as they
+	can be to the chain. PREC_VALIDATE runs are never cached.
+
+	Slots are claimed lock-free, EMPTY -> BUSY -> FULL, so the threads
+	of a sweep, and other processes with the same file open, can look up
+	and store at once. Two threads missing the same point both store it
+	and the second copy is never found, which costs a slot and nothing
+	else. A slot left BUSY by a crash is skipped.
+
+	The header holds a fingerprint of the model: MEMO_VERSION and the
+	chain's results on a few fixed probe designs in both precisions.
+	Change a constant or a formula and the fingerprint changes, and
+	memo_open starts a new, empty file in place of the old one. The old
+	file is replaced by rename, never truncated, so a process still
+	mapping it keeps working until it closes.
+
+	The table does not grow. Past MEMO_MAX_LOAD, or when MEMO_PROBE
+	slots in a row are taken, points are no longer stored; they are
+	still computed, just not remembered.
+
+	A hit is a random read into a table far bigger than the cache: a
+	cache miss and a TLB miss, which prefetching overlaps only in part.
+	That is still dearer than running today's chain, float or double,
+	at a few tens of ns a point: in bench, sweep_run_memo takes about
+	three times as long as sweep_run and half again sweep_run_double.
+	The memo pays for what costs more than that to compute, and for
+	keeping results across runs.
+**/
+
+#define MEMO_VERSION 	2		// bump when the file layout or the chain changes
+#define MEMO_MAGIC 	"LEDMEMO1"
+#define MEMO_PROBE 	64		// slots looked at per lookup, at most
+#define MEMO_MAX_LOAD 	0.75		// fraction of slots in use before stores stop
+#define MEMO_MIN_SLOTS 	1024
+
+enum memo_state {
+    MEMO_EMPTY = 0,
+    MEMO_BUSY,
+    MEMO_FULL
+};
+
+/// v, r, num, fixed_res, rtja, amb, ojt, and the precision
+struct memo_key {
+    uint32_t 	mode;			// enum prec_mode
+    float 	in[7];
+};
+
+/// One result, 80 bytes. out[] is in PREC_OUTPUTS order, intensity left out.
+struct memo_slot {
+    _Atomic uint32_t 	state;		// enum memo_state
+    uint32_t 		tag;		// high half of the key hash
+    struct memo_key 	key;
+    float 		out[PREC_NCHAIN];
+    int32_t 		exceeded;
+};
+
+/// The first 64 bytes of the file
+struct memo_header {
+    char 		magic[8];
+    uint64_t 		fingerprint;
+    uint64_t 		nslots;		// a power of 2
+    uint64_t 		slot_size;
+    _Atomic uint64_t 	used;		// slots claimed
+    uint8_t 		pad[24];
+};
+
+struct memo {
+    struct memo_header 	*hdr;
+    struct memo_slot 	*slots;
+    size_t 		mask;		// nslots - 1
+    size_t 		bytes;		// mapped
+};
+
+uint64_t memo_fingerprint(void);
+int memo_open(struct memo *m, const char *path, size_t nslots);
+void memo_close(struct memo *m);
+size_t memo_used(const struct memo *m);
+
+void memo_key(const struct C_batch *b, size_t i, enum prec_mode mode, struct memo_key *k);
+const struct memo_slot *memo_find(const struct memo *m, const struct memo_key *k);
+int memo_put(struct memo *m, const struct memo_key *k, const struct C_batch *b, size_t i);
+void memo_get(const struct memo_slot *s, struct C_batch *b, size_t i);
+
+size_t memo_fetch(const struct memo *m, const struct C_batch *b, size_t n, enum prec_mode mode,
+	const struct memo_slot **hit, size_t *miss);
+size_t memo_store(struct memo *m, const struct C_batch *b, size_t n, enum prec_mode mode);
+
+#endif
@@ -0,0 +1,435 @@
+///	Package:	circuit
+///	File:		mna.c
+///	Purpose:	Sparse nodal analysis of arbitrary LED array netlists
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * Ho, Ruehli and Brennan, "The Modified Nodal Approach to Network
+ *	Analysis", IEEE Trans. Circuits and Systems, 1975
+ * Cuthill and McKee, "Reducing the Bandwidth of Sparse Symmetric
+ *	Matrices", ACM National Conference, 1969
+ * George and Liu, "Computer Solution of Large Sparse Positive Definite
+ *	Systems", 1981, chapter 4 (envelope methods)
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "mna.h"
+#include "prof.h"
+
+#define MNA_PIVOT_TOL 	1e-12	// relative pivot below which a node is floating
+
+///===============================================
+/// Netlist building. mna_add returns the element's index, or -1 for a
+/// bad element or allocation failure.
+
+int mna_netlist_init(struct mna_netlist *nl, int nodes) {
+	 memset(nl, 0, sizeof *nl);
+	 if (nodes < 1) return -1;
+	 nl->nodes = nodes;
+	 return 0;
+}
+
+int mna_add(struct mna_netlist *nl, enum mna_kind kind, int a, int b, double value, double value2) {
+	 struct mna_elem *e;
+	 if (a < 0 || b < 0 || a >= nl->nodes || b >= nl->nodes || a == b) return -1;
+	 if (kind == MNA_R && !(value > 0)) return -1;
+	 if (kind == MNA_LED && !(value2 > 0)) return -1;
+	 if (kind == MNA_V && a != 0 && b != 0) return -1;
+	 if (kind > MNA_LED) return -1;
+	 if (nl->n == nl->cap) {
+		 size_t cap = nl->cap ? 2 * nl->cap : 64;
+		 e = realloc(nl->e, cap * sizeof *e);
+		 if (e == NULL) return -1;
+		 nl->e = e;
+		 nl->cap = cap;
+	 }
+	 e = &nl->e[nl->n];
+	 e->kind = kind;
+	 e->a = a;
+	 e->b = b;
+	 e->value = value;
+	 e->value2 = value2;
+	 return (int)nl->n++;
+}
+
+void mna_netlist_free(struct mna_netlist *nl) {
+	 free(nl->e);
+	 memset(nl, 0, sizeof *nl);
+}
+
+///===============================================
+/// Conductance elements are the ones that stamp into G.
+
+static int mna_conducts(enum mna_kind kind) {
+	 return kind == MNA_R || kind == MNA_LED;
+}
+
+///===============================================
+/// Reverse Cuthill-McKee over the free nodes. adj/start is the free node
+/// graph in CSR form, indexed by free node; order receives the new
+/// position of each. Each component is started from a pseudo-peripheral
+/// node, found by repeated breadth-first search from a low degree node.
+/// Returns 0, or -1 on allocation failure.
+
+static int mna_bfs(const int *start, const int *adj, int root, int *level, int *work, int *count) {
+	 int head = 0, tail = 0, depth = 0, k;
+	 level[root] = 0;
+	 work[tail++] = root;
+	 while (head < tail) {
+		 int u = work[head++];
+		 for (k = start[u]; k < start[u + 1]; k++) {
+			 int w = adj[k];
+			 if (level[w] < 0) {
+				 level[w] = depth = level[u] + 1;
+				 work[tail++] = w;
+			 }
+		 }
+	 }
+	 *count = tail;
+	 return depth;
+}
+
+static int mna_degree(const int *start, int u) {
+	 return start[u + 1] - start[u];
+}
+
+static int mna_rcm(int n, const int *start, const int *adj, int *order) {
+	 int *level = malloc((n ? n : 1) * sizeof *level), *work = malloc((n ? n : 1) * sizeof *work);
+	 int *queue = malloc((n ? n : 1) * sizeof *queue);
+	 int placed = 0, i, k;
+
+	 if (!level || !work || !queue) {
+		 free(level);
+		 free(work);
+		 free(queue);
+		 return -1;
+	 }
+	 for (i = 0; i < n; i++) level[i] = -1;
+	 for (i = 0; i < n; i++) {
+		 int root = i, depth, count, head, tail;
+		 if (level[i] == -2) continue;
+
+		 /// Pseudo-peripheral root: restart from the lowest degree node on
+		 /// the deepest level until the depth stops growing
+		 depth = mna_bfs(start, adj, root, level, work, &count);
+		 for (;;) {
+			 int cand = root, newdepth;
+			 for (k = 0; k < count; k++) {
+				 int u = work[k];
+				 if (level[u] == depth && (cand == root || mna_degree(start, u) < mna_degree(start, cand)))
+					 cand = u;
+			 }
+			 for (k = 0; k < count; k++) level[work[k]] = -1;
+			 if (cand == root) break;
+			 newdepth = mna_bfs(start, adj, cand, level, work, &count);
+			 if (newdepth <= depth) {
+				 for (k = 0; k < count; k++) level[work[k]] = -1;
+				 break;
+			 }
+			 root = cand;
+			 depth = newdepth;
+		 }
+
+		 /// Cuthill-McKee: breadth first, neighbours by increasing degree.
+		 /// level -2 marks placed nodes.
+		 head = tail = placed;
+		 level[root] = -2;
+		 queue[tail++] = root;
+		 while (head < tail) {
+			 int u = queue[head++], from = tail;
+			 for (k = start[u]; k < start[u + 1]; k++) {
+				 int w = adj[k];
+				 if (level[w] != -2) {
+					 level[w] = -2;
+					 queue[tail++] = w;
+				 }
+			 }
+			 for (k = from + 1; k < tail; k++) {
+				 int w = queue[k], d = mna_degree(start, w), j = k;
+				 while (j > from && mna_degree(start, queue[j - 1]) > d) {
+					 queue[j] = queue[j - 1];
+					 j--;
+				 }
+				 queue[j] = w;
+			 }
+		 }
+		 placed = tail;
+	 }
+	 for (i = 0; i < n; i++) order[queue[i]] = n - 1 - i;
+	 free(level);
+	 free(work);
+	 free(queue);
+	 return 0;
+}
+
+///===============================================
+/// Orders the unknowns and lays out the envelope for nl's topology.
+/// Returns 0, or -1 for a bad netlist (a node fixed by two voltage
+/// sources) or allocation failure.
+
+int mna_compile(const struct mna_netlist *nl, struct mna_system *sys) {
+	 int nodes = nl->nodes, nfree = 0, i, *fid = NULL, *start = NULL, *adj = NULL;
+	 int *order = NULL, *fill = NULL, rc = -1;
+	 size_t k, nadj = 0;
+
+	 memset(sys, 0, sizeof *sys);
+	 sys->nodes = nodes;
+	 sys->nelem = nl->n;
+	 sys->row = malloc(nodes * sizeof *sys->row);
+	 sys->src = malloc(nodes * sizeof *sys->src);
+	 fid = malloc(nodes * sizeof *fid);
+	 sys->g = calloc(nl->n ? nl->n : 1, sizeof *sys->g);
+	 sys->stamp = calloc(nl->n ? nl->n : 1, sizeof *sys->stamp);
+	 if (!sys->row || !sys->src || !fid || !sys->g || !sys->stamp) goto done;
+
+	 /// Fixed nodes, then the free ones in netlist order
+	 for (i = 0; i < nodes; i++) sys->src[i] = -1;
+	 for (k = 0; k < nl->n; k++) {
+		 const struct mna_elem *e = &nl->e[k];
+		 int f = e->a ? e->a : e->b;
+		 if (e->kind != MNA_V) continue;
+		 if (sys->src[f] >= 0) goto done;
+		 sys->src[f] = (int)k;
+	 }
+	 for (i = 0; i < nodes; i++) fid[i] = (i > 0 && sys->src[i] < 0) ? nfree++ : -1;
+	 sys->nfree = nfree;
+
+	 /// Free node graph
+	 start = calloc(nfree + 1, sizeof *start);
+	 sys->node = malloc((nfree ? nfree : 1) * sizeof *sys->node);
+	 sys->first = malloc((nfree ? nfree : 1) * sizeof *sys->first);
+	 sys->diag = malloc((nfree ? nfree : 1) * sizeof *sys->diag);
+	 sys->rhs = malloc((nfree ? nfree : 1) * sizeof *sys->rhs);
+	 order = malloc((nfree ? nfree : 1) * sizeof *order);
+	 fill = malloc((nfree ? nfree : 1) * sizeof *fill);
+	 if (!start || !sys->node || !sys->first || !sys->diag || !sys->rhs || !order || !fill) goto done;
+	 for (k = 0; k < nl->n; k++) {
+		 const struct mna_elem *e = &nl->e[k];
+		 if (mna_conducts(e->kind) && fid[e->a] >= 0 && fid[e->b] >= 0) {
+			 start[fid[e->a] + 1]++;
+			 start[fid[e->b] + 1]++;
+			 nadj += 2;
+		 }
+	 }
+	 for (i = 0; i < nfree; i++) start[i + 1] += start[i];
+	 adj = malloc((nadj ? nadj : 1) * sizeof *adj);
+	 if (adj == NULL) goto done;
+	 for (i = 0; i < nfree; i++) fill[i] = start[i];
+	 for (k = 0; k < nl->n; k++) {
+		 const struct mna_elem *e = &nl->e[k];
+		 if (mna_conducts(e->kind) && fid[e->a] >= 0 && fid[e->b] >= 0) {
+			 adj[fill[fid[e->a]]++] = fid[e->b];
+			 adj[fill[fid[e->b]]++] = fid[e->a];
+		 }
+	 }
+	 if (mna_rcm(nfree, start, adj, order) != 0) goto done;
+
+	 /// Unknown numbering and envelope
+	 for (i = 0; i < nodes; i++) {
+		 sys->row[i] = (fid[i] >= 0) ? order[fid[i]] : -1;
+		 if (fid[i] >= 0) sys->node[sys->row[i]] = i;
+	 }
+	 for (i = 0; i < nfree; i++) sys->first[i] = i;
+	 for (k = 0; k < nl->n; k++) {
+		 const struct mna_elem *e = &nl->e[k];
+		 int p = sys->row[e->a], q = sys->row[e->b];
+		 if (!mna_conducts(e->kind) || p < 0 || q < 0) continue;
+		 if (p < q) { int t = p; p = q; q = t; }
+		 if (q < sys->first[p]) sys->first[p] = q;
+	 }
+	 for (i = 0; i < nfree; i++)
+		 sys->diag[i] = ((i > 0) ? sys->diag[i - 1] + 1 : 0) + (size_t)(i - sys->first[i]);
+	 sys->size = nfree ? sys->diag[nfree - 1] + 1 : 0;
+	 sys->env = malloc((sys->size ? sys->size : 1) * sizeof *sys->env);
+	 if (sys->env == NULL) goto done;
+
+	 for (k = 0; k < nl->n; k++) {
+		 const struct mna_elem *e = &nl->e[k];
+		 struct mna_stamp *s = &sys->stamp[k];
+		 s->ra = sys->row[e->a];
+		 s->rb = sys->row[e->b];
+		 if (s->ra >= 0) s->aa = sys->diag[s->ra];
+		 if (s->rb >= 0) s->bb = sys->diag[s->rb];
+		 if (s->ra >= 0 && s->rb >= 0) {
+			 int p = (s->ra > s->rb) ? s->ra : s->rb, q = (s->ra > s->rb) ? s->rb : s->ra;
+			 s->ab = sys->diag[p] - (size_t)(p - q);
+		 }
+	 }
+	 rc = 0;
+
+done:
+	 free(fid);
+	 free(start);
+	 free(adj);
+	 free(order);
+	 free(fill);
+	 if (rc != 0) mna_free(sys);
+	 return rc;
+}
+
+///===============================================
+/// Dot product in four partial sums, so the envelope inner loops pipeline.
+
+static double mna_dot(const double *restrict x, const double *restrict y, size_t n) {
+	 double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	 size_t k = 0;
+	 for (; k + 4 <= n; k += 4) {
+		 s0 += x[k] * y[k];
+		 s1 += x[k + 1] * y[k + 1];
+		 s2 += x[k + 2] * y[k + 2];
+		 s3 += x[k + 3] * y[k + 3];
+	 }
+	 for (; k < n; k++) s0 += x[k] * y[k];
+	 return (s0 + s1) + (s2 + s3);
+}
+
+///===============================================
+/// Stamps the conductances of nl into G and factors it, G = L L^T, in
+/// place in the envelope. Row i of L holds columns first[i] .. i ending
+/// at diag[i]. Returns 0, or -1 when G is not positive definite, which
+/// means some node has no DC path to ground or a source.
+
+int mna_factor(struct mna_system *sys, const struct mna_netlist *nl) {
+	 double *env = sys->env;
+	 size_t k;
+	 int i, j;
+
+	 if (nl->n != sys->nelem) return -1;
+	 PROF_BEGIN(prof_t);
+	 memset(env, 0, sys->size * sizeof *env);
+	 for (k = 0; k < nl->n; k++) {
+		 const struct mna_elem *e = &nl->e[k];
+		 const struct mna_stamp *s = &sys->stamp[k];
+		 double g = (e->kind == MNA_R) ? 1 / e->value : (e->kind == MNA_LED) ? 1 / e->value2 : 0;
+		 sys->g[k] = g;
+		 if (g == 0) continue;
+		 if (s->ra >= 0) env[s->aa] += g;
+		 if (s->rb >= 0) env[s->bb] += g;
+		 if (s->ra >= 0 && s->rb >= 0) env[s->ab] -= g;
+	 }
+
+	 for (i = 0; i < sys->nfree; i++) {
+		 int fi = sys->first[i];
+		 double *li = env + (sys->diag[i] - (size_t)(i - fi));	// L(i, fi)
+		 double d0 = li[i - fi], d;
+		 for (j = fi; j < i; j++) {
+			 int fj = sys->first[j], k0 = (fi > fj) ? fi : fj;
+			 const double *lj = env + (sys->diag[j] - (size_t)(j - k0));	// L(j, k0)
+			 double s = li[j - fi] - mna_dot(li + (k0 - fi), lj, (size_t)(j - k0));
+			 li[j - fi] = s / lj[j - k0];
+		 }
+		 d = d0 - mna_dot(li, li, (size_t)(i - fi));
+		 if (!(d > MNA_PIVOT_TOL * d0)) {
+			 PROF_END(PROF_MNA_FACTOR, prof_t, (uint64_t)i);
+			 return -1;
+		 }
+		 li[i - fi] = sqrt(d);
+	 }
+	 PROF_END(PROF_MNA_FACTOR, prof_t, (uint64_t)sys->nfree);
+	 return 0;
+}
+
+///===============================================
+/// Node voltages for the current source values, v[0 .. nodes-1]. Uses
+/// the factor from the last mna_factor. Returns 0, or -1 if the netlist
+/// no longer matches the compiled topology.
+
+int mna_solve(struct mna_system *sys, const struct mna_netlist *nl, double *v) {
+	 const double *env = sys->env;
+	 double *x = sys->rhs;
+	 size_t k;
+	 int i, j;
+
+	 if (nl->n != sys->nelem) return -1;
+	 PROF_BEGIN(prof_t);
+	 for (i = 0; i < sys->nodes; i++) {
+		 int s = sys->src[i];
+		 v[i] = (s < 0) ? 0 : (nl->e[s].a == i) ? nl->e[s].value : -nl->e[s].value;
+	 }
+
+	 /// Right hand side: sources, LED drops and currents into fixed nodes
+	 memset(x, 0, sys->nfree * sizeof *x);
+	 for (k = 0; k < nl->n; k++) {
+		 const struct mna_elem *e = &nl->e[k];
+		 const struct mna_stamp *s = &sys->stamp[k];
+		 double g = sys->g[k], ia = 0;
+		 switch (e->kind) {
+			case MNA_R:	ia = 0; break;
+			case MNA_LED:	ia = g * e->value; break;
+			case MNA_I:	ia = -e->value; break;
+			default:	continue;
+		 }
+		 if (s->ra >= 0) x[s->ra] += ia + ((s->rb < 0) ? g * v[e->b] : 0);
+		 if (s->rb >= 0) x[s->rb] += -ia + ((s->ra < 0) ? g * v[e->a] : 0);
+	 }
+
+	 /// L y = rhs, then L^T x = y column by column
+	 for (i = 0; i < sys->nfree; i++) {
+		 int fi = sys->first[i];
+		 const double *li = env + (sys->diag[i] - (size_t)(i - fi));
+		 x[i] = (x[i] - mna_dot(li, x + fi, (size_t)(i - fi))) / li[i - fi];
+	 }
+	 for (i = sys->nfree - 1; i >= 0; i--) {
+		 int fi = sys->first[i];
+		 const double *li = env + (sys->diag[i] - (size_t)(i - fi));
+		 double xi = x[i] / li[i - fi];
+		 double *restrict y = x + fi;
+		 x[i] = xi;
+		 for (j = 0; j < i - fi; j++) y[j] -= li[j] * xi;
+	 }
+	 for (i = 0; i < sys->nfree; i++) v[sys->node[i]] = x[i];
+	 PROF_END(PROF_MNA_SOLVE, prof_t, (uint64_t)sys->nfree);
+	 return 0;
+}
+
+///===============================================
+/// Current through element k from a to b, given solved voltages. For a
+/// voltage source, the current it delivers out of terminal a into the
+/// rest of the circuit.
+
+double mna_current(const struct mna_system *sys, const struct mna_netlist *nl, const double *v, size_t k) {
+	 const struct mna_elem *e = &nl->e[k];
+	 double out = 0;
+	 int f;
+	 size_t m;
+
+	 switch (e->kind) {
+		case MNA_R:	return (v[e->a] - v[e->b]) / e->value;
+		case MNA_LED:	return (v[e->a] - v[e->b] - e->value) / e->value2;
+		case MNA_I:	return e->value;
+		default:	break;
+	 }
+	 /// KCL at the fixed node over everything else attached to it
+	 f = e->a ? e->a : e->b;
+	 for (m = 0; m < nl->n; m++) {
+		 const struct mna_elem *o = &nl->e[m];
+		 double i;
+		 if (m == k || o->kind == MNA_V || (o->a != f && o->b != f)) continue;
+		 i = mna_current(sys, nl, v, m);
+		 out += (o->a == f) ? i : -i;
+	 }
+	 return (f == e->a) ? out : -out;
+}
+
+void mna_free(struct mna_system *sys) {
+	 free(sys->row);
+	 free(sys->node);
+	 free(sys->src);
+	 free(sys->first);
+	 free(sys->diag);
+	 free(sys->env);
+	 free(sys->g);
+	 free(sys->rhs);
+	 free(sys->stamp);
+	 memset(sys, 0, sizeof *sys);
+}
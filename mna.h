@@ -0,0 +1,84 @@
+// mna.h //
+#ifndef MNA_H
+#define MNA_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+
+/** Netlist elements. Nodes are numbered 0 .. nodes-1, node 0 is ground.
+	MNA_R		resistor, value in Ohms
+	MNA_I		current source, value Amps flowing from a through the
+			source into b
+	MNA_V		voltage source, V(a) - V(b) = value. One terminal must
+			be ground; the other node is then fixed and drops out
+			of the system, which keeps it symmetric positive definite
+	MNA_LED		LED, anode a, cathode b, as the forward-biased piecewise
+			linear model I = (V(a) - V(b) - vf) / rd, value = vf in
+			Volts, value2 = rd in Ohms
+**/
+enum mna_kind {
+    MNA_R = 0,
+    MNA_I,
+    MNA_V,
+    MNA_LED
+};
+
+struct mna_elem {
+    enum mna_kind 	kind;
+    int 		a;		// first node (anode)
+    int 		b;		// second node (cathode)
+    double 		value;		// Ohms, Amps, Volts or LED vf
+    double 		value2;		// LED rd, Ohms
+};
+
+struct mna_netlist {
+    int 		nodes;		// including ground
+    size_t 		n;
+    size_t 		cap;
+    struct mna_elem 	*e;
+};
+
+/** Compiled system for one topology. mna_compile orders the free nodes
+	(reverse Cuthill-McKee) and lays out the envelope of the factor.
+	After that, mna_factor and mna_solve only touch values, so sweeps
+	that change element values but not the topology reuse it. Call
+	mna_factor again whenever an R or LED rd changed; source values
+	(MNA_I, MNA_V, LED vf) only need mna_solve.
+**/
+struct mna_stamp {
+    int 	ra, rb;		// unknowns of a and b, -1 when fixed or ground
+    size_t 	aa, bb, ab;	// positions of the G entries in env
+};
+
+struct mna_system {
+    int 		nodes;
+    int 		nfree;		// unknowns
+    size_t 		nelem;
+    int 		*row;		// node -> unknown, -1 == fixed by a source or ground
+    int 		*node;		// unknown -> node
+    int 		*src;		// node -> MNA_V element fixing it, -1 == none
+    int 		*first;		// unknown -> first column in its envelope row
+    size_t 		*diag;		// unknown -> position of the diagonal in env
+    size_t 		size;		// envelope entries
+    double 		*env;		// G, then its Cholesky factor, row by row
+    double 		*g;		// element conductance at the last mna_factor
+    double 		*rhs;		// unknowns
+    struct mna_stamp 	*stamp;
+};
+
+int mna_netlist_init(struct mna_netlist *nl, int nodes);
+int mna_add(struct mna_netlist *nl, enum mna_kind kind, int a, int b, double value, double value2);
+void mna_netlist_free(struct mna_netlist *nl);
+
+int mna_compile(const struct mna_netlist *nl, struct mna_system *sys);
+int mna_factor(struct mna_system *sys, const struct mna_netlist *nl);
+int mna_solve(struct mna_system *sys, const struct mna_netlist *nl, double *v);
+double mna_current(const struct mna_system *sys, const struct mna_netlist *nl, const double *v, size_t k);
+void mna_free(struct mna_system *sys);
+
+#endif
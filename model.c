@@ -0,0 +1,247 @@
+///	Package:	circuit
+///	File:		model.c
+///	Purpose:	Incremental recomputation of the LED circuit chain
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "batch.h"
+#include "cpu.h"
+#include "model.h"
+
+#define MODEL_BLOCK 	64	// rows per vectorized block
+
+#define MODEL_NAME(id, name, deps) name,
+static const char *const model_names[] = { MODEL_NODES(MODEL_NAME) };
+#undef MODEL_NAME
+
+#define MODEL_DEPS(id, name, deps) deps,
+static const uint32_t model_deps[] = { MODEL_NODES(MODEL_DEPS) };
+#undef MODEL_DEPS
+
+_Static_assert(MODEL_NNODES <= 32, "node sets are uint32_t masks");
+
+const char *model_name(enum model_node node) {
+	 return (node < MODEL_NNODES) ? model_names[node] : "?";
+}
+
+///===============================================
+/// Everything computed from node, directly or not. Nodes only depend on
+/// earlier ones, so one pass forward finds them all.
+
+uint32_t model_downstream(enum model_node node) {
+	 uint32_t mask = MODEL_BIT(node);
+	 int j;
+	 for (j = node + 1; j < MODEL_NNODES; j++) {
+		 if (model_deps[j] & mask) mask |= MODEL_BIT(j);
+	 }
+	 return mask & ~MODEL_BIT(node);
+}
+
+/// The dirty nodes that have to be computed to bring want up to date,
+/// found by one pass backward.
+static uint32_t model_need(uint32_t dirty, uint32_t want) {
+	 int j;
+	 for (j = MODEL_NNODES - 1; j >= 0; j--) {
+		 if (want & dirty & MODEL_BIT(j)) want |= model_deps[j];
+	 }
+	 return want & dirty;
+}
+
+///===============================================
+/// One node from its inputs, with k_chain's kernel for it
+
+static float model_eval(const float *x, enum model_node node) {
+	 switch (node) {
+	 case MODEL_PAR_RES:	return k_parallel_resistance(x[MODEL_R], (int)x[MODEL_NUM]);
+	 case MODEL_VAR_RES:	return k_var_resistance(x[MODEL_PAR_RES], x[MODEL_FIXED_RES]);
+	 case MODEL_BRANCH_I:	return k_branch_current(x[MODEL_V], x[MODEL_R]);
+	 case MODEL_TOTAL_I:	return k_total_current(x[MODEL_V], x[MODEL_R], (int)x[MODEL_NUM]);
+	 case MODEL_POWER:	return k_power_VI(x[MODEL_V], x[MODEL_TOTAL_I]);
+	 case MODEL_TEMP_RISE:	return k_temp_rise(x[MODEL_V], 0, x[MODEL_TOTAL_I], x[MODEL_RTJA], x[MODEL_AMB]);
+	 case MODEL_OJT_DIFF:	return k_temp_diff_OJT_TR(x[MODEL_TEMP_RISE], x[MODEL_OJT]);
+	 case MODEL_EXCEEDED:	return (float)k_junct_temp_exceeded(x[MODEL_TEMP_RISE], x[MODEL_OJT]);
+	 case MODEL_LUX:		return k_ResToLux(x[MODEL_R]);
+	 case MODEL_PERCENT:	return k_ResToPercent(x[MODEL_R]);
+	 default:		return x[node];
+	 }
+}
+
+/// Brings the nodes in want up to date
+static void model_update(struct model *m, uint32_t want) {
+	 uint32_t need = model_need(m->dirty, want);
+	 int j;
+	 for (j = MODEL_NINPUTS; j < MODEL_NNODES && need != 0; j++) {
+		 if (!(need & MODEL_BIT(j))) continue;
+		 m->val[j] = model_eval(m->val, j);
+		 m->evals++;
+	 }
+	 m->dirty &= ~need;
+}
+
+///===============================================
+/// Starts from design d with every output out of date.
+
+void model_init(struct model *m, const struct C_design *d) {
+	 memset(m, 0, sizeof *m);
+	 m->val[MODEL_V] = d->v;
+	 m->val[MODEL_R] = d->r;
+	 m->val[MODEL_NUM] = d->num;
+	 m->val[MODEL_FIXED_RES] = d->fixed_res;
+	 m->val[MODEL_RTJA] = d->rtja;
+	 m->val[MODEL_AMB] = d->amb;
+	 m->val[MODEL_OJT] = d->ojt;
+	 m->dirty = MODEL_OUTPUTS;
+}
+
+/// Sets an input. Setting the value it already has, bit for bit,
+/// invalidates nothing. Returns -1 if node is not an input.
+int model_set(struct model *m, enum model_node node, float x) {
+	 if (node >= MODEL_NINPUTS) return -1;
+	 if (memcmp(&m->val[node], &x, sizeof x) == 0) return 0;
+	 m->val[node] = x;
+	 m->dirty |= model_downstream(node);
+	 return 0;
+}
+
+float model_get(struct model *m, enum model_node node) {
+	 if (node >= MODEL_NNODES) return NAN;
+	 model_update(m, MODEL_BIT(node));
+	 return m->val[node];
+}
+
+/// Everything k_chain would give for the current inputs
+void model_result(struct model *m, struct C_result *out) {
+	 model_update(m, MODEL_OUTPUTS);
+	 out->par_res = m->val[MODEL_PAR_RES];
+	 out->var_res = m->val[MODEL_VAR_RES];
+	 out->branch_i = m->val[MODEL_BRANCH_I];
+	 out->total_i = m->val[MODEL_TOTAL_I];
+	 out->power = m->val[MODEL_POWER];
+	 out->temp_rise = m->val[MODEL_TEMP_RISE];
+	 out->ojt_diff = m->val[MODEL_OJT_DIFF];
+	 out->exceeded = (int)m->val[MODEL_EXCEEDED];
+	 out->lux = m->val[MODEL_LUX];
+	 out->percent = m->val[MODEL_PERCENT];
+}
+
+///===============================================
+/// Batches
+
+int model_batch_alloc(struct model_batch *mb, size_t cap) {
+	 mb->dirty = MODEL_OUTPUTS;
+	 mb->ran = 0;
+	 return batch_alloc(&mb->b, cap);
+}
+
+void model_batch_free(struct model_batch *mb) {
+	 batch_free(&mb->b);
+}
+
+void model_batch_set(struct model_batch *mb, size_t i, const struct C_design *d) {
+	 batch_set(&mb->b, i, d);
+	 mb->dirty = MODEL_OUTPUTS;
+}
+
+/// The column of input node
+static float *model_column(struct C_batch *b, enum model_node node) {
+	 float *cols[MODEL_NINPUTS] = { b->v, b->r, b->num, b->fixed_res, b->rtja, b->amb, b->ojt };
+	 return cols[node];
+}
+
+/// Input column node, to be written: what is downstream of it is
+/// marked out of date now. NULL if node is not an input.
+float *model_batch_edit(struct model_batch *mb, enum model_node node) {
+	 if (node >= MODEL_NINPUTS) return NULL;
+	 mb->dirty |= model_downstream(node);
+	 return model_column(&mb->b, node);
+}
+
+/// Sets input node to x in every row. Returns -1 if it is not an input.
+int model_batch_fill(struct model_batch *mb, enum model_node node, float x) {
+	 float *col = model_batch_edit(mb, node);
+	 size_t i;
+	 if (col == NULL) return -1;
+	 for (i = 0; i < mb->b.n; i++) col[i] = x;
+	 return 0;
+}
+
+/// Column kernels. MODEL_COLUMN(NAME, T, EXPR) makes NAME(o, a, b, c, d, n)
+/// setting o[l] = EXPR for rows [0, n), EXPR in terms of a[l] .. d[l].
+/// Rows go MODEL_BLOCK at a time through restrict pointers, a fixed
+/// trip count with nothing aliased, so the loop vectorizes; the tail
+/// is the same expression one row at a time. Unused inputs are passed
+/// some other column, never NULL.
+
+#define MODEL_COLUMN(NAME, T, EXPR) \
+CPU_KERNEL void NAME##_block(T *restrict o, const float *restrict a, const float *restrict b, \
+	const float *restrict c, const float *restrict d) { \
+	 int l; \
+	 for (l = 0; l < MODEL_BLOCK; l++) o[l] = EXPR; \
+} \
+CPU_KERNEL void NAME(T *o, const float *a, const float *b, const float *c, const float *d, size_t n) { \
+	 size_t i, l; \
+	 for (i = 0; i + MODEL_BLOCK <= n; i += MODEL_BLOCK) NAME##_block(o + i, a + i, b + i, c + i, d + i); \
+	 o += i;	a += i;	b += i;	c += i;	d += i; \
+	 for (l = 0; l < n - i; l++) o[l] = EXPR; \
+}
+
+MODEL_COLUMN(model_par_res, float, k_parallel_resistance(a[l], (int)b[l]))
+MODEL_COLUMN(model_var_res, float, k_var_resistance(a[l], b[l]))
+MODEL_COLUMN(model_branch_i, float, k_branch_current(a[l], b[l]))
+MODEL_COLUMN(model_total_i, float, k_total_current(a[l], b[l], (int)c[l]))
+MODEL_COLUMN(model_power, float, k_power_VI(a[l], b[l]))
+MODEL_COLUMN(model_temp_rise, float, k_temp_rise(a[l], 0, b[l], c[l], d[l]))
+MODEL_COLUMN(model_ojt_diff, float, k_temp_diff_OJT_TR(a[l], b[l]))
+MODEL_COLUMN(model_exceeded, int32_t, k_junct_temp_exceeded(a[l], b[l]))
+MODEL_COLUMN(model_lux, float, k_ResToLux(a[l]))
+MODEL_COLUMN(model_percent, float, k_ResToPercent(a[l]))
+
+/// One output column over rows [0, n)
+CPU_KERNEL void model_batch_eval_body(struct C_batch *b, enum model_node node, size_t n) {
+	 const float *v = b->v, *r = b->r, *num = b->num;
+
+	 switch (node) {
+	 case MODEL_PAR_RES:	model_par_res(b->par_res, r, num, r, r, n);				break;
+	 case MODEL_VAR_RES:	model_var_res(b->var_res, b->par_res, b->fixed_res, r, r, n);		break;
+	 case MODEL_BRANCH_I:	model_branch_i(b->branch_i, v, r, r, r, n);				break;
+	 case MODEL_TOTAL_I:	model_total_i(b->total_i, v, r, num, r, n);				break;
+	 case MODEL_POWER:	model_power(b->power, v, b->total_i, r, r, n);				break;
+	 case MODEL_TEMP_RISE:	model_temp_rise(b->temp_rise, v, b->total_i, b->rtja, b->amb, n);	break;
+	 case MODEL_OJT_DIFF:	model_ojt_diff(b->ojt_diff, b->temp_rise, b->ojt, r, r, n);		break;
+	 case MODEL_EXCEEDED:	model_exceeded(b->exceeded, b->temp_rise, b->ojt, r, r, n);		break;
+	 case MODEL_LUX:		model_lux(b->lux, r, r, r, r, n);					break;
+	 case MODEL_PERCENT:	model_percent(b->percent, r, r, r, r, n);				break;
+	 default:		break;
+	 }
+}
+
+CPU_CLONES(model_batch_eval, (struct C_batch *b, enum model_node node, size_t n), (b, node, n))
+
+/// Recomputes the out of date columns over rows [0, b.n), in node
+/// order, with the cpu.h variant in use. Returns the set of nodes it
+/// computed.
+uint32_t model_batch_run(struct model_batch *mb) {
+	 uint32_t need;
+	 enum cpu_isa isa = cpu_isa();
+	 int j;
+
+	 if (mb->b.n != mb->ran) mb->dirty = MODEL_OUTPUTS;
+	 need = mb->dirty & MODEL_OUTPUTS;
+	 for (j = MODEL_NINPUTS; j < MODEL_NNODES; j++) {
+		 if (need & MODEL_BIT(j)) model_batch_eval[isa](&mb->b, j, mb->b.n);
+	 }
+	 mb->dirty = 0;
+	 mb->ran = mb->b.n;
+	 return need;
+}
@@ -0,0 +1,96 @@
+// model.h //
+#ifndef MODEL_H
+#define MODEL_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "kernel.h"
+#include "batch.h"
+
+/** The design as a dependency graph. Each node is an input of
+	C_design or an output of k_chain, and each output lists the nodes
+	it is computed from. Setting an input marks everything downstream
+	of it dirty; reading a node recomputes the dirty nodes it needs,
+	and nothing else. An ambient-only edit redoes temp_rise, ojt_diff
+	and exceeded and leaves the resistances and currents alone.
+
+	The nodes are in the order k_chain computes them, so every node
+	comes after the ones it uses, and each one is computed by the same
+	kernel.h function k_chain calls: results match k_chain bit for bit
+	however they were reached.
+
+	model_batch does the same per column for a whole C_batch: edit an
+	input column and model_batch_run recomputes only the output columns
+	downstream of it.
+**/
+
+/// Node, name, the nodes it is computed from (0 for inputs)
+#define MODEL_NODES(X) \
+	X(MODEL_V,		"v",		0) \
+	X(MODEL_R,		"r",		0) \
+	X(MODEL_NUM,		"num",		0) \
+	X(MODEL_FIXED_RES,	"fixed_res",	0) \
+	X(MODEL_RTJA,		"rtja",		0) \
+	X(MODEL_AMB,		"amb",		0) \
+	X(MODEL_OJT,		"ojt",		0) \
+	X(MODEL_PAR_RES,	"par_res",	MODEL_BIT(MODEL_R) | MODEL_BIT(MODEL_NUM)) \
+	X(MODEL_VAR_RES,	"var_res",	MODEL_BIT(MODEL_PAR_RES) | MODEL_BIT(MODEL_FIXED_RES)) \
+	X(MODEL_BRANCH_I,	"branch_i",	MODEL_BIT(MODEL_V) | MODEL_BIT(MODEL_R)) \
+	X(MODEL_TOTAL_I,	"total_i",	MODEL_BIT(MODEL_V) | MODEL_BIT(MODEL_R) | MODEL_BIT(MODEL_NUM)) \
+	X(MODEL_POWER,		"power",	MODEL_BIT(MODEL_V) | MODEL_BIT(MODEL_TOTAL_I)) \
+	X(MODEL_TEMP_RISE,	"temp_rise",	MODEL_BIT(MODEL_V) | MODEL_BIT(MODEL_TOTAL_I) \
+						| MODEL_BIT(MODEL_RTJA) | MODEL_BIT(MODEL_AMB)) \
+	X(MODEL_OJT_DIFF,	"ojt_diff",	MODEL_BIT(MODEL_TEMP_RISE) | MODEL_BIT(MODEL_OJT)) \
+	X(MODEL_EXCEEDED,	"exceeded",	MODEL_BIT(MODEL_TEMP_RISE) | MODEL_BIT(MODEL_OJT)) \
+	X(MODEL_LUX,		"lux",		MODEL_BIT(MODEL_R)) \
+	X(MODEL_PERCENT,	"percent",	MODEL_BIT(MODEL_R))
+
+#define MODEL_ID(id, name, deps) id,
+enum model_node {
+	MODEL_NODES(MODEL_ID)
+	MODEL_NNODES
+};
+#undef MODEL_ID
+
+#define MODEL_BIT(node) 	((uint32_t)1 << (node))
+#define MODEL_NINPUTS 		(MODEL_OJT + 1)
+#define MODEL_INPUTS 		(MODEL_BIT(MODEL_NINPUTS) - 1)
+#define MODEL_OUTPUTS 		(MODEL_BIT(MODEL_NNODES) - 1 - MODEL_INPUTS)
+
+/// One design. exceeded is held as 0 or 1 like the rest, in a float.
+struct model {
+    float 	val[MODEL_NNODES];
+    uint32_t 	dirty;		// nodes whose val is out of date
+    size_t 	evals;		// nodes computed so far
+};
+
+/// A batch whose columns are recomputed as the nodes above are.
+/// Changing b.n, or any row through model_batch_set, redoes every column.
+struct model_batch {
+    struct C_batch 	b;
+    uint32_t 		dirty;		// output columns out of date
+    size_t 		ran;		// b.n at the last model_batch_run
+};
+
+const char *model_name(enum model_node node);
+uint32_t model_downstream(enum model_node node);
+
+void model_init(struct model *m, const struct C_design *d);
+int model_set(struct model *m, enum model_node node, float x);
+float model_get(struct model *m, enum model_node node);
+void model_result(struct model *m, struct C_result *out);
+
+int model_batch_alloc(struct model_batch *mb, size_t cap);
+void model_batch_free(struct model_batch *mb);
+void model_batch_set(struct model_batch *mb, size_t i, const struct C_design *d);
+float *model_batch_edit(struct model_batch *mb, enum model_node node);
+int model_batch_fill(struct model_batch *mb, enum model_node node, float x);
+uint32_t model_batch_run(struct model_batch *mb);
+
+#endif
@@ -0,0 +1,368 @@
+///	Package:	circuit
+///	File:		montecarlo.c
+///	Purpose:	Monte Carlo tolerance analysis of LED driver designs
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * Salmon, Moraes, Dror, Shaw, "Parallel Random Numbers: As Easy as 1, 2, 3", SC11
+ * https://en.wikipedia.org/wiki/Box%E2%80%93Muller_transform
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "pool.h"
+#include "montecarlo.h"
+#include "prof.h"
+
+#define MC_BLOCK 	256		// samples drawn together so the loops vectorize
+#define MC_WORD_UNIFORM 	0		// counter word 3 for a sample's uniforms
+#define MC_WORD_NORMAL 	1		// and for the uniforms its normals are made from
+#define TWO_PI 		6.28318530717958647692f
+#define LN2 		0.69314718055994530942f
+
+/// Philox4x32 constants from the Random123 paper
+#define PHILOX_M0 	0xD2511F53u
+#define PHILOX_M1 	0xCD9E8D57u
+#define PHILOX_W0 	0x9E3779B9u
+#define PHILOX_W1 	0xBB67AE85u
+
+/// Sums for one chunk, taken about a fixed shift so the variance
+/// does not cancel. Merged in chunk order for reproducible totals.
+struct mc_chunk {
+    double 	t_sum, t_sq, t_min, t_max;
+    double 	i_sum, i_sq, i_min, i_max;
+};
+
+/// Per-worker integer tallies; integer adds commute so these can be
+/// summed in any order.
+struct mc_tally {
+    uint64_t 	over_temp;
+    uint64_t 	over_ojt;
+    uint64_t 	underflow;
+    uint64_t 	overflow;
+    uint64_t 	hist[MC_HIST_BINS];
+};
+
+struct mc_job {
+    const struct mc_design 	*d;
+    struct mc_config 		cfg;
+    float 			t_shift;
+    float 			i_shift;
+    struct mc_chunk 		*chunks;
+    struct mc_tally 		*tally;
+};
+
+///===============================================
+/// Philox4x32-10: ten rounds of the counter-based generator.
+
+void mc_philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+	 uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+	 uint32_t k0 = key[0], k1 = key[1];
+	 int round;
+	 for (round = 0; round < 10; round++) {
+		 uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+		 uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+		 uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		 uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		 c1 = (uint32_t)p1;
+		 c3 = (uint32_t)p0;
+		 c0 = n0;
+		 c2 = n2;
+		 k0 += PHILOX_W0;
+		 k1 += PHILOX_W1;
+	 }
+	 out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+///===============================================
+/// The same generator across a block of consecutive counters
+/// {s + k, stream, word}, written column-wise so the rounds vectorize.
+/// Produces the same bits as mc_philox4x32.
+
+static void mc_philox_block(uint64_t s, uint32_t stream, uint32_t word, const uint32_t key[2],
+	uint32_t out[4][MC_BLOCK]) {
+	 uint32_t *c0 = out[0], *c1 = out[1], *c2 = out[2], *c3 = out[3];
+	 uint32_t k0 = key[0], k1 = key[1];
+	 int round, k;
+	 for (k = 0; k < MC_BLOCK; k++) {
+		 c0[k] = (uint32_t)(s + k);
+		 c1[k] = (uint32_t)((s + k) >> 32);
+		 c2[k] = stream;
+		 c3[k] = word;
+	 }
+	 for (round = 0; round < 10; round++) {
+		 for (k = 0; k < MC_BLOCK; k++) {
+			 uint64_t p0 = (uint64_t)PHILOX_M0 * c0[k];
+			 uint64_t p1 = (uint64_t)PHILOX_M1 * c2[k];
+			 uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1[k] ^ k0;
+			 uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3[k] ^ k1;
+			 c1[k] = (uint32_t)p1;
+			 c3[k] = (uint32_t)p0;
+			 c0[k] = n0;
+			 c2[k] = n2;
+		 }
+		 k0 += PHILOX_W0;
+		 k1 += PHILOX_W1;
+	 }
+}
+
+///===============================================
+/// Maps 32 random bits to a float strictly inside (0, 1).
+
+static inline float mc_unit(uint32_t x) {
+	 return ((float)(int32_t)(x >> 8) + 0.5f) * (1.0f / 16777216.0f);
+}
+
+/// Natural log of a unit uniform, x in (0, 1). Splits off the exponent
+/// and sums the atanh series of the mantissa; relative error ~2e-7, with
+/// no libm call so the Box-Muller loops vectorize.
+static inline float mc_log(float x) {
+	 uint32_t bits;
+	 int32_t e, big;
+	 float m, s, s2;
+	 memcpy(&bits, &x, sizeof bits);
+	 e = (int32_t)(bits >> 23);
+	 bits = (bits & 0x007fffffu) | 0x3f800000u;		// m in [1, 2)
+	 memcpy(&m, &bits, sizeof m);
+	 big = (m > 1.41421356f);				// fold to [0.707, 1.414)
+	 m *= 1.0f - 0.5f * (float)big;
+	 e += big;
+	 s = (m - 1.0f) / (m + 1.0f);
+	 s2 = s * s;
+	 return ((float)e - 127.0f) * LN2
+		+ 2.0f * s * (1.0f + s2 * (1.0f/3 + s2 * (1.0f/5 + s2 * (1.0f/7 + s2 * (1.0f/9)))));
+}
+
+/// Bitwise float helpers, so the quadrant fix-up below has no branches
+static inline float mc_blend(uint32_t mask, float a, float b) {
+	 uint32_t ia, ib, r;
+	 float f;
+	 memcpy(&ia, &a, sizeof ia);
+	 memcpy(&ib, &b, sizeof ib);
+	 r = (ia & mask) | (ib & ~mask);
+	 memcpy(&f, &r, sizeof f);
+	 return f;
+}
+
+static inline float mc_flip(uint32_t sign, float a) {
+	 uint32_t ia;
+	 memcpy(&ia, &a, sizeof ia);
+	 ia ^= sign;
+	 memcpy(&a, &ia, sizeof a);
+	 return a;
+}
+
+/// sin and cos of 2*pi*u for u in (0, 1): fold to the nearest quarter turn,
+/// evaluate Taylor polynomials on [-pi/4, pi/4], then rotate back.
+static inline void mc_sincos2pi(float u, float *sn, float *cs) {
+	 int quad = (int)(4.0f * u + 0.5f);			// u > 0, so this is a floor
+	 float t = TWO_PI * (u - 0.25f * (float)quad), t2 = t * t;
+	 float sp = t * (1.0f - t2 * (1.0f/6 - t2 * (1.0f/120 - t2 * (1.0f/5040))));
+	 float cp = 1.0f - t2 * (0.5f - t2 * (1.0f/24 - t2 * (1.0f/720 - t2 * (1.0f/40320))));
+	 uint32_t odd = 0u - (uint32_t)(quad & 1);
+	 *sn = mc_flip((uint32_t)(quad & 2) << 30, mc_blend(odd, cp, sp));
+	 *cs = mc_flip((uint32_t)((quad + 1) & 2) << 30, mc_blend(odd, sp, cp));
+}
+
+/// A parameter as nominal * (1 + su*(2u - 1) + sz*z), so every
+/// distribution is drawn by the same branch-free expression.
+struct mc_coef {
+    float 	nominal;
+    float 	su;		// uniform half-width, relative
+    float 	sz;		// normal sigma, relative
+};
+
+static struct mc_coef mc_coef_of(const struct mc_param *p) {
+	 struct mc_coef c = { p->nominal, 0, 0 };
+	 if (p->dist == MC_UNIFORM) c.su = p->spread;
+	 if (p->dist == MC_NORMAL) c.sz = p->spread;
+	 return c;
+}
+
+static inline float mc_draw(struct mc_coef c, float u, float z) {
+	 return c.nominal * (1.0f + c.su * (2.0f * u - 1.0f) + c.sz * z);
+}
+
+///===============================================
+/// Draws and evaluates the samples of one chunk.
+
+static void mc_chunk_run(void *ctx, size_t chunk, int worker) {
+	 struct mc_job *job = ctx;
+	 const struct mc_design *d = job->d;
+	 const struct mc_config *cfg = &job->cfg;
+	 struct mc_chunk *c = &job->chunks[chunk];
+	 struct mc_tally *t = &job->tally[worker];
+	 uint32_t key[2] = { (uint32_t)cfg->seed, (uint32_t)(cfg->seed >> 32) };
+	 uint64_t first = (uint64_t)chunk * MC_CHUNK;
+	 uint64_t end = first + MC_CHUNK;
+	 int normal01 = (d->r.dist == MC_NORMAL || d->v.dist == MC_NORMAL);
+	 int normal23 = (d->rtja.dist == MC_NORMAL || d->amb.dist == MC_NORMAL);
+	 struct mc_coef cr = mc_coef_of(&d->r), cv = mc_coef_of(&d->v);
+	 struct mc_coef crtja = mc_coef_of(&d->rtja), camb = mc_coef_of(&d->amb);
+	 int num = (int)d->num;
+	 float scale = MC_HIST_BINS / (cfg->hist_hi - cfg->hist_lo);
+	 uint32_t bits[4][MC_BLOCK], nbits[4][MC_BLOCK];
+	 float u[4][MC_BLOCK], z[4][MC_BLOCK] = { { 0 } }, temp[MC_BLOCK], curr[MC_BLOCK];
+	 uint64_t s;
+	 int k, j;
+	 PROF_BEGIN(prof_t);
+
+	 if (end > cfg->samples) end = cfg->samples;
+	 c->t_min = c->i_min = INFINITY;
+	 c->t_max = c->i_max = -INFINITY;
+
+	 for (s = first; s < end; s += MC_BLOCK) {
+		 int n = (end - s < MC_BLOCK) ? (int)(end - s) : MC_BLOCK;
+
+		 /// Whole blocks are always drawn (fixed trip counts vectorize best);
+		 /// samples past the end are simply not tallied.
+		 mc_philox_block(s, cfg->stream, MC_WORD_UNIFORM, key, bits);
+		 for (j = 0; j < 4; j++) {
+			 for (k = 0; k < MC_BLOCK; k++) u[j][k] = mc_unit(bits[j][k]);
+		 }
+		 /// Box-Muller on lane pairs (0,1) and (2,3), only when needed. The
+		 /// normals come from their own counters: a pair's uniforms also
+		 /// feed u[j] and u[j + 1], so a uniform parameter beside a normal
+		 /// one would otherwise set the normal's magnitude.
+		 if (normal01 || normal23) mc_philox_block(s, cfg->stream, MC_WORD_NORMAL, key, nbits);
+		 for (j = 0; j < 4; j += 2) {
+			 if (!(j == 0 ? normal01 : normal23)) continue;
+			 for (k = 0; k < MC_BLOCK; k++) {
+				 float m = sqrtf(-2.0f * mc_log(mc_unit(nbits[j][k])));
+				 float sn, cs;
+				 mc_sincos2pi(mc_unit(nbits[j + 1][k]), &sn, &cs);
+				 z[j][k] = m * cs;
+				 z[j + 1][k] = m * sn;
+			 }
+		 }
+		 /// The circuit chain: total_current then calc_temp_rise(v, 0, I, rtja, amb)
+		 for (k = 0; k < MC_BLOCK; k++) {
+			 float r = mc_draw(cr, u[0][k], z[0][k]);
+			 float v = mc_draw(cv, u[1][k], z[1][k]);
+			 float rtja = mc_draw(crtja, u[2][k], z[2][k]);
+			 float amb = mc_draw(camb, u[3][k], z[3][k]);
+			 curr[k] = k_total_current(v, r, num);
+			 temp[k] = k_temp_rise(v, 0, curr[k], rtja, amb);
+		 }
+		 for (k = 0; k < n; k++) {
+			 double dt = temp[k] - job->t_shift, di = curr[k] - job->i_shift;
+			 float pos = (temp[k] - cfg->hist_lo) * scale;
+			 c->t_sum += dt;
+			 c->t_sq += dt * dt;
+			 c->i_sum += di;
+			 c->i_sq += di * di;
+			 if (temp[k] < c->t_min) c->t_min = temp[k];
+			 if (temp[k] > c->t_max) c->t_max = temp[k];
+			 if (curr[k] < c->i_min) c->i_min = curr[k];
+			 if (curr[k] > c->i_max) c->i_max = curr[k];
+			 t->over_temp += (temp[k] >= cfg->temp_limit);
+			 t->over_ojt += (temp[k] >= cfg->ojt_limit);
+			 if (pos < 0) t->underflow++;
+			 else if (pos >= MC_HIST_BINS) t->overflow++;
+			 else t->hist[(int)pos]++;
+		 }
+	 }
+	 PROF_END(PROF_MC_CHUNK, prof_t, (end > first) ? end - first : 0);
+}
+
+///===============================================
+
+static void mc_stat_finish(struct mc_stat *st, double sum, double sq, double shift, size_t n) {
+	 double mean = sum / n;
+	 double var = (n > 1) ? (sq - sum * mean) / (n - 1) : 0;
+	 st->mean = shift + mean;
+	 st->stddev = (var > 0) ? sqrt(var) : 0;
+}
+
+///===============================================
+/// Draws cfg->samples samples of design d and runs them through the
+/// circuit and thermal chain. Returns 0, or -1 on bad input or no memory.
+
+int mc_run(const struct mc_design *d, const struct mc_config *cfg, struct mc_result *out) {
+	 struct mc_job job;
+	 size_t nchunks, c;
+	 double t_sum = 0, t_sq = 0, i_sum = 0, i_sq = 0;
+	 int nthreads, w, rc;
+
+	 memset(out, 0, sizeof *out);
+	 if (cfg->samples == 0) return -1;
+	 job.d = d;
+	 job.cfg = *cfg;
+	 if (job.cfg.temp_limit == 0) job.cfg.temp_limit = MAX_TEMP_TPS61169;
+	 if (job.cfg.ojt_limit == 0) job.cfg.ojt_limit = MAX_OP_JUNCT_TEMP_TPS61169;
+	 if (!(job.cfg.hist_hi > job.cfg.hist_lo)) {
+		 job.cfg.hist_lo = 0;
+		 job.cfg.hist_hi = 200;
+	 }
+	 job.i_shift = k_total_current(d->v.nominal, d->r.nominal, (int)d->num);
+	 job.t_shift = k_temp_rise(d->v.nominal, 0, job.i_shift, d->rtja.nominal, d->amb.nominal);
+
+	 nchunks = (cfg->samples + MC_CHUNK - 1) / MC_CHUNK;
+	 nthreads = pool_threads(cfg->nthreads, nchunks);
+	 job.chunks = calloc(nchunks, sizeof *job.chunks);
+	 job.tally = calloc(nthreads, sizeof *job.tally);
+	 rc = (job.chunks != NULL && job.tally != NULL) ? 0 : -1;
+	 if (rc == 0) rc = pool_run(nthreads, nchunks, mc_chunk_run, &job);
+
+	 if (rc == 0) {
+		 out->samples = cfg->samples;
+		 out->temp_rise.min = out->total_i.min = INFINITY;
+		 out->temp_rise.max = out->total_i.max = -INFINITY;
+		 for (c = 0; c < nchunks; c++) {
+			 struct mc_chunk *ch = &job.chunks[c];
+			 t_sum += ch->t_sum; t_sq += ch->t_sq;
+			 i_sum += ch->i_sum; i_sq += ch->i_sq;
+			 if (ch->t_min < out->temp_rise.min) out->temp_rise.min = ch->t_min;
+			 if (ch->t_max > out->temp_rise.max) out->temp_rise.max = ch->t_max;
+			 if (ch->i_min < out->total_i.min) out->total_i.min = ch->i_min;
+			 if (ch->i_max > out->total_i.max) out->total_i.max = ch->i_max;
+		 }
+		 for (w = 0; w < nthreads; w++) {
+			 struct mc_tally *t = &job.tally[w];
+			 out->over_temp += t->over_temp;
+			 out->over_ojt += t->over_ojt;
+			 out->underflow += t->underflow;
+			 out->overflow += t->overflow;
+			 for (c = 0; c < MC_HIST_BINS; c++) out->hist[c] += t->hist[c];
+		 }
+		 mc_stat_finish(&out->temp_rise, t_sum, t_sq, job.t_shift, out->samples);
+		 mc_stat_finish(&out->total_i, i_sum, i_sq, job.i_shift, out->samples);
+		 out->yield_temp = 1.0 - (double)out->over_temp / out->samples;
+		 out->yield_ojt = 1.0 - (double)out->over_ojt / out->samples;
+		 out->hist_lo = job.cfg.hist_lo;
+		 out->hist_hi = job.cfg.hist_hi;
+	 }
+	 free(job.chunks);
+	 free(job.tally);
+	 return rc;
+}
+
+///===============================================
+/// Temperature rise at quantile q (0..1), read from the histogram with
+/// linear interpolation inside the bin. Resolution is one bin width;
+/// quantiles that land in the under/overflow return the observed min/max.
+
+double mc_percentile(const struct mc_result *res, double q) {
+	 double want = q * res->samples, seen = res->underflow;
+	 double width = (res->hist_hi - res->hist_lo) / MC_HIST_BINS;
+	 int k;
+
+	 if (want <= seen) return res->temp_rise.min;
+	 for (k = 0; k < MC_HIST_BINS; k++) {
+		 if (seen + res->hist[k] >= want && res->hist[k] > 0) {
+			 return res->hist_lo + width * (k + (want - seen) / res->hist[k]);
+		 }
+		 seen += res->hist[k];
+	 }
+	 return res->temp_rise.max;
+}
@@ -0,0 +1,87 @@
+// montecarlo.h //
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MC_CHUNK 	65536	// samples per task, fixed so results never depend on threads
+#define MC_HIST_BINS 	1024
+
+/** Part-to-part spread of one input. spread is relative to nominal:
+	MC_UNIFORM	nominal * (1 + spread*u), u uniform on [-1, 1]  (a +/- tolerance)
+	MC_NORMAL	nominal * (1 + spread*z), z standard normal   (spread is sigma)
+**/
+enum mc_dist {
+    MC_FIXED = 0,
+    MC_UNIFORM,
+    MC_NORMAL
+};
+
+struct mc_param {
+    enum mc_dist 	dist;
+    float 		nominal;
+    float 		spread;
+};
+
+/// One LED driver design with its tolerances
+struct mc_design {
+    struct mc_param 	r;		// branch resistor
+    struct mc_param 	v;		// feedback voltage
+    struct mc_param 	rtja;		// R Theta JA
+    struct mc_param 	amb;		// ambient temperature
+    float 		num;		// number of branches
+};
+
+/** samples, seed and stream fix the random numbers completely: sample k
+	of stream s always draws its uniforms from Philox4x32-10(key = seed,
+	counter = {k, s, 0}) and its normals from counter {k, s, 1}, no
+	matter which thread runs it. temp_limit and ojt_limit default to
+	MAX_TEMP_TPS61169 and MAX_OP_JUNCT_TEMP_TPS61169 when 0, and the
+	temperature histogram spans [hist_lo, hist_hi) (0..200 deg C when equal).
+**/
+struct mc_config {
+    size_t 	samples;
+    uint64_t 	seed;
+    uint32_t 	stream;		// design number, gives each design its own streams
+    int 	nthreads;	// 0 == all cores
+    float 	temp_limit;
+    float 	ojt_limit;
+    float 	hist_lo;
+    float 	hist_hi;
+};
+
+/// Summary of one output over all samples
+struct mc_stat {
+    double 	mean;
+    double 	stddev;
+    double 	min;
+    double 	max;
+};
+
+struct mc_result {
+    size_t 		samples;
+    size_t 		over_temp;	// temperature rise >= temp_limit
+    size_t 		over_ojt;	// temperature rise >= ojt_limit
+    double 		yield_temp;	// fraction below temp_limit
+    double 		yield_ojt;	// fraction below ojt_limit
+    struct mc_stat 	temp_rise;
+    struct mc_stat 	total_i;
+    float 		hist_lo;
+    float 		hist_hi;
+    uint64_t 		underflow;
+    uint64_t 		overflow;
+    uint64_t 		hist[MC_HIST_BINS];
+};
+
+void mc_philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]);
+int mc_run(const struct mc_design *d, const struct mc_config *cfg, struct mc_result *out);
+double mc_percentile(const struct mc_result *res, double q);
+
+#endif
@@ -0,0 +1,234 @@
+///	Package:	circuit
+///	File:		photometry.c
+///	Purpose:	Lumens and lux from LED spectra and the CIE luminosity functions
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * https://cie.co.at/datatable/cie-spectral-luminous-efficiency-photopic-vision
+ * https://cie.co.at/datatable/cie-spectral-luminous-efficiency-scotopic-vision
+ * https://en.wikipedia.org/wiki/Luminosity_function
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "constants.h"
+#include "cpu.h"
+#include "photometry.h"
+
+#define PH_BLOCK 	64	// rows per vectorized block
+
+///===============================================
+/// CIE V(lambda) and V'(lambda), 380 .. 780 nm in 5 nm steps
+
+static const double ph_photopic[PH_TABLE_N] = {
+	0.000039, 0.000064, 0.00012, 0.000217, 0.000396, 0.00064, 0.00121, 0.00218,	// 380
+	0.004, 0.0073, 0.0116, 0.01684, 0.023, 0.0298, 0.038, 0.048,			// 420
+	0.06, 0.0739, 0.09098, 0.1126, 0.13902, 0.1693, 0.20802, 0.2586,		// 460
+	0.323, 0.4073, 0.503, 0.6082, 0.71, 0.7932, 0.862, 0.91485,			// 500
+	0.954, 0.9803, 0.99495, 1.0, 0.995, 0.9786, 0.952, 0.9154,			// 540
+	0.87, 0.8163, 0.757, 0.6949, 0.631, 0.5668, 0.503, 0.4412,			// 580
+	0.381, 0.321, 0.265, 0.217, 0.175, 0.1382, 0.107, 0.0816,			// 620
+	0.061, 0.04458, 0.032, 0.0232, 0.017, 0.01192, 0.00821, 0.005723,		// 660
+	0.004102, 0.002929, 0.002091, 0.001484, 0.001047, 0.00074, 0.00052, 0.000361,	// 700
+	0.000249, 0.000172, 0.00012, 0.0000848, 0.00006, 0.0000424, 0.00003, 0.0000212,	// 740
+	0.000015 };									// 780
+
+static const double ph_scotopic[PH_TABLE_N] = {
+	0.000589, 0.001108, 0.002209, 0.00453, 0.00929, 0.01852, 0.03484, 0.0604,	// 380
+	0.0966, 0.1436, 0.1998, 0.2625, 0.3281, 0.3931, 0.455, 0.513,			// 420
+	0.567, 0.62, 0.676, 0.734, 0.793, 0.851, 0.904, 0.949,				// 460
+	0.982, 0.998, 0.997, 0.975, 0.935, 0.88, 0.811, 0.733,				// 500
+	0.65, 0.564, 0.481, 0.402, 0.3288, 0.2639, 0.2076, 0.1602,			// 540
+	0.1212, 0.0899, 0.0655, 0.0469, 0.03315, 0.02312, 0.01593, 0.01088,		// 580
+	0.00737, 0.00497, 0.003335, 0.002235, 0.001497, 0.001005, 0.000677, 0.000459,	// 620
+	0.0003129, 0.0002146, 0.000148, 0.0001026, 0.0000715, 0.0000501, 0.00003533, 0.00002501,	// 660
+	0.0000178, 0.00001273, 0.00000914, 0.0000066, 0.00000478, 0.000003482, 0.000002546, 0.00000187,	// 700
+	0.000001379, 0.000001022, 0.00000076, 0.000000567, 0.000000425, 0.0000003196, 0.0000002413, 0.0000001829,	// 740
+	0.000000139 };									// 780
+
+/// The luminosity function, linear between table entries, 0 outside them
+double ph_V(enum ph_vision v, double lambda) {
+	 const double *t = (v == PH_SCOTOPIC) ? ph_scotopic : ph_photopic;
+	 double x = (lambda - PH_TABLE_MIN) / PH_TABLE_STEP;
+	 int k;
+
+	 if (!(x >= 0 && x <= PH_TABLE_N - 1)) return 0;
+	 k = (int)x;
+	 if (k == PH_TABLE_N - 1) k--;
+	 return t[k] + (x - k) * (t[k + 1] - t[k]);
+}
+
+/// Wavelength of grid point k, nm
+double ph_lambda(int k) {
+	 return PH_TABLE_MIN + k;
+}
+
+///===============================================
+/// Weights and spectra on the grid
+
+void ph_weights_init(struct ph_weights *w, enum ph_vision v) {
+	 double km = (v == PH_SCOTOPIC) ? KM_SCOTOPIC : KM_PHOTOPIC;
+	 int k;
+
+	 memset(w, 0, sizeof *w);
+	 w->vision = v;
+	 for (k = 0; k < PH_N; k++) {
+		 double dl = (k == 0 || k == PH_N - 1) ? 0.5 : 1.0;	// trapezoid, 1 nm
+		 w->w[k] = (float)(km * ph_V(v, ph_lambda(k)) * dl);
+	 }
+}
+
+/// Radiant power at current, W
+double ph_radiant(const struct ph_emitter *e, double current) {
+	 double p = e->radiant_per_amp * current * (1 - e->droop * current);
+	 return (p > 0) ? p : 0;
+}
+
+/** The spectral power at current on the grid, W/nm. Each band is a
+	normalized Gaussian, so the power of a band is its share whether or
+	not its tails reach past 380 or 780 nm; what does falls off the grid
+	and, rightly, adds no lumens.
+**/
+void ph_spectrum(const struct ph_emitter *e, double current, float spd[PH_NPAD]) {
+	 double p = ph_radiant(e, current), di = current - e->i_ref;
+	 double work[PH_N];
+	 int j, k;
+
+	 memset(work, 0, sizeof work);
+	 for (j = 0; j < e->nbands && j < PH_MAX_BANDS; j++) {
+		 const struct ph_band *b = &e->band[j];
+		 double peak = b->peak + e->shift_per_amp * di;
+		 double fwhm = b->fwhm + e->broaden_per_amp * di;
+		 double sigma, amp;
+		 if (fwhm < PH_MIN_FWHM) fwhm = PH_MIN_FWHM;
+		 sigma = fwhm / (2 * sqrt(2 * log(2)));
+		 amp = b->share * p / (sigma * sqrt(2 * PI));
+		 for (k = 0; k < PH_N; k++) {
+			 double d = (ph_lambda(k) - peak) / sigma;
+			 if (fabs(d) < 12) work[k] += amp * exp(-0.5 * d * d);
+		 }
+	 }
+	 for (k = 0; k < PH_N; k++) spd[k] = (float)work[k];
+	 for (; k < PH_NPAD; k++) spd[k] = 0;
+}
+
+/** Lumens of spectrum spd: PH_LANES running sums, each over every
+	PH_LANES'th point, added up at the end. The lanes are fixed, so the
+	answer does not depend on the vector width, and the loop is
+	straight-line code the compiler vectorizes.
+**/
+double ph_flux(const struct ph_weights *w, const float spd[PH_NPAD]) {
+	 float acc[PH_LANES] = { 0 };
+	 double sum = 0;
+	 int i, l;
+
+	 for (i = 0; i < PH_NPAD; i += PH_LANES) {
+		 _Pragma("GCC unroll 16")
+		 for (l = 0; l < PH_LANES; l++) acc[l] += w->w[i + l] * spd[i + l];
+	 }
+	 for (l = 0; l < PH_LANES; l++) sum += acc[l];
+	 return sum;
+}
+
+/// Luminous efficacy of the radiation at current, lm/W; 0 when dark
+double ph_efficacy(const struct ph_weights *w, const struct ph_emitter *e, double current) {
+	 float spd[PH_NPAD];
+	 double p = ph_radiant(e, current);
+	 if (p <= 0) return 0;
+	 ph_spectrum(e, current, spd);
+	 return ph_flux(w, spd) / p;
+}
+
+///===============================================
+/// Current to lumens, tabulated
+
+/// Tabulates e's lumens over [0, i_max]. Returns -1 if i_max is not > 0.
+int ph_lut_init(struct ph_lut *t, const struct ph_weights *w, const struct ph_emitter *e, float i_max) {
+	 float spd[PH_NPAD];
+	 int j;
+
+	 if (!(i_max > 0)) return -1;
+	 t->i_max = i_max;
+	 t->inv_step = PH_LUT_N / i_max;
+	 for (j = 0; j <= PH_LUT_N; j++) {
+		 ph_spectrum(e, (double)i_max * j / PH_LUT_N, spd);
+		 t->lm[j] = (float)ph_flux(w, spd);
+	 }
+	 for (j = 0; j < PH_LUT_N; j++) t->rise[j] = t->lm[j + 1] - t->lm[j];
+	 return 0;
+}
+
+/// Table position of current: x in [0, PH_LUT_N], NaN to 0, and its interval
+static inline float ph_lut_x(float inv_step, float current) {
+	 float x = current * inv_step;
+	 x = (x > 0) ? x : 0;
+	 return (x < PH_LUT_N) ? x : PH_LUT_N;
+}
+
+static inline int ph_lut_k(float x) {
+	 int k = (int)x;
+	 return (k < PH_LUT_N - 1) ? k : PH_LUT_N - 1;
+}
+
+/// Linear in the table; currents past its ends take the end value
+float ph_lut_lumens(const struct ph_lut *t, float current) {
+	 float x = ph_lut_x(t->inv_step, current);
+	 int k = ph_lut_k(x);
+	 return t->lm[k] + (x - (float)k) * t->rise[k];
+}
+
+/// Lux per lumen on axis
+float ph_lux_scale(const struct ph_geometry *g) {
+	 return (float)((g->order + 1) / (2 * PI * (double)g->distance * g->distance));
+}
+
+///===============================================
+/// lux[i] = num[i] emitters at current[i] each, num truncated like
+/// k_chain's branch count. PH_BLOCK rows at a time: positions first,
+/// into a local buffer, then the table reads. In one loop the compiler
+/// turns the clamps into branches to fixed table entries and gives up;
+/// split, both loops vectorize, the second with gathers. The tail is
+/// the same arithmetic a row at a time.
+
+CPU_KERNEL void ph_lux_block(float *restrict lux, const float *restrict current, const float *restrict num,
+	const float *restrict lm, const float *restrict rise, float inv_step, float scale) {
+	 float x[PH_BLOCK];
+	 int k[PH_BLOCK];
+	 int l;
+	 for (l = 0; l < PH_BLOCK; l++) {
+		 x[l] = ph_lut_x(inv_step, current[l]);
+		 k[l] = ph_lut_k(x[l]);
+	 }
+	 for (l = 0; l < PH_BLOCK; l++)
+		 lux[l] = (float)(int)num[l] * (lm[k[l]] + (x[l] - (float)k[l]) * rise[k[l]]) * scale;
+}
+
+CPU_KERNEL void ph_lux_range_body(const struct ph_lut *t, float scale, const float *current, const float *num,
+	size_t n, float *lux) {
+	 size_t i, l;
+	 for (i = 0; i + PH_BLOCK <= n; i += PH_BLOCK)
+		 ph_lux_block(lux + i, current + i, num + i, t->lm, t->rise, t->inv_step, scale);
+	 for (l = i; l < n; l++) lux[l] = (float)(int)num[l] * ph_lut_lumens(t, current[l]) * scale;
+}
+
+CPU_CLONES(ph_lux_range, (const struct ph_lut *t, float scale, const float *current, const float *num, size_t n, float *lux),
+	(t, scale, current, num, n, lux))
+
+/** Lux under n designs, num[i] emitters of table t each driven at
+	current[i], with the cpu.h variant in use. With a C_batch that is
+	ph_lux_batch(t, g, b->branch_i, b->num, b->n, out): the spectral
+	answer to the chain's resistor-based lux column.
+**/
+void ph_lux_batch(const struct ph_lut *t, const struct ph_geometry *g, const float *current,
+	const float *num, size_t n, float *lux) {
+	 ph_lux_range[cpu_isa()](t, ph_lux_scale(g), current, num, n, lux);
+}
@@ -0,0 +1,114 @@
+// photometry.h //
+#ifndef PHOTOMETRY_H
+#define PHOTOMETRY_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+
+/** Spectral photometry. Lumens are the emitter's spectral power weighed
+	by the eye's response and summed over wavelength,
+
+		flux = Km * integral S(lambda) V(lambda) dlambda
+
+	with the CIE 1924 photopic V(lambda), or the CIE 1951 scotopic
+	V'(lambda) for dark-adapted vision, built in at the CIE's 5 nm
+	steps from 380 to 780 nm.
+
+	The integral is taken by the trapezoid rule on a 1 nm grid, PH_N
+	points. Km V(lambda) times the trapezoid weight is worked out once
+	per vision into a ph_weights, so a flux is one dot product of the
+	spectrum with it. Arrays on the grid are PH_NPAD long, the tail
+	zero, so the dot product runs in whole vector blocks.
+
+	An emitter is one or more bands, each a Gaussian of given peak and
+	width carrying a share of the radiant power: a colored LED is one
+	band, a phosphor white LED a narrow blue one and a broad yellow one.
+	Radiant power, peak and width can all move with the drive current.
+
+	Sweeps ask for the flux at millions of currents, so ph_lut tabulates
+	it once per emitter over a current range, and ph_lux_batch turns a
+	column of currents into lux by interpolating in the table.
+**/
+
+#define PH_TABLE_MIN 	380	// nm, first CIE table entry
+#define PH_TABLE_STEP 	5	// nm between CIE table entries
+#define PH_TABLE_N 	81	// entries, 380 .. 780 nm
+#define PH_N 		401	// quadrature points, 380 .. 780 nm at 1 nm
+#define PH_NPAD 	416	// PH_N rounded up to PH_LANES
+#define PH_LANES 	16	// partial sums in the dot product
+#define PH_MAX_BANDS 	4
+#define PH_MIN_FWHM 	1.0f	// nm, narrower bands are widened to this
+#define PH_LUT_N 	256	// current intervals in a ph_lut
+
+enum ph_vision {
+    PH_PHOTOPIC = 0,
+    PH_SCOTOPIC
+};
+
+/// Km V(lambda_k) dlambda_k on the grid, 0 past PH_N
+struct ph_weights {
+    enum ph_vision 	vision;
+    float 		w[PH_NPAD] __attribute__((aligned(64)));
+};
+
+/// One Gaussian band at the reference current
+struct ph_band {
+    float 	peak;		// nm
+    float 	fwhm;		// nm, full width at half maximum
+    float 	share;		// of the radiant power
+};
+
+/** An LED as a light source. Radiant power is radiant_per_amp * I *
+	(1 - droop * I), never below 0. Away from i_ref each band's peak
+	moves by shift_per_amp and its width by broaden_per_amp per amp.
+**/
+struct ph_emitter {
+    int 		nbands;
+    struct ph_band 	band[PH_MAX_BANDS];
+    float 		radiant_per_amp;	// W/A
+    float 		droop;			// 1/A
+    float 		i_ref;			// A
+    float 		shift_per_amp;		// nm/A
+    float 		broaden_per_amp;	// nm/A
+};
+
+/** Lumens of one emitter at PH_LUT_N + 1 currents evenly over [0, i_max].
+	Each interval keeps its own rise, so a lookup reads two arrays at one
+	index rather than one array at two, which vectorizes as gathers.
+**/
+struct ph_lut {
+    float 	i_max;
+    float 	inv_step;	// PH_LUT_N / i_max
+    float 	lm[PH_LUT_N + 1];
+    float 	rise[PH_LUT_N];	// lm[k + 1] - lm[k]
+};
+
+/** Where the light lands: on axis, distance meters below emitters of
+	generalized Lambertian order (1 for a plain LED, see irradiance.h),
+	so one lumen gives (order + 1) / (2 pi distance^2) lux.
+**/
+struct ph_geometry {
+    float 	distance;
+    int 	order;
+};
+
+double ph_V(enum ph_vision v, double lambda);
+double ph_lambda(int k);
+void ph_weights_init(struct ph_weights *w, enum ph_vision v);
+double ph_radiant(const struct ph_emitter *e, double current);
+void ph_spectrum(const struct ph_emitter *e, double current, float spd[PH_NPAD]);
+double ph_flux(const struct ph_weights *w, const float spd[PH_NPAD]);
+double ph_efficacy(const struct ph_weights *w, const struct ph_emitter *e, double current);
+
+int ph_lut_init(struct ph_lut *t, const struct ph_weights *w, const struct ph_emitter *e, float i_max);
+float ph_lut_lumens(const struct ph_lut *t, float current);
+float ph_lux_scale(const struct ph_geometry *g);
+void ph_lux_batch(const struct ph_lut *t, const struct ph_geometry *g, const float *current,
+	const float *num, size_t n, float *lux);
+
+#endif
@@ -0,0 +1,152 @@
+///	Package:	intensity
+///	File:		pool.c
+///	Purpose:	Work-stealing thread pool for sweeps
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "pool.h"
+
+/// A worker's remaining tasks [lo, hi), packed as hi << 32 | lo so the
+/// owner and the thieves can both claim work with a single CAS.
+struct pool_worker {
+    _Alignas(64) _Atomic uint64_t range;
+    pthread_t 	thread;
+    int 	id;
+    struct pool_job *job;
+};
+
+struct pool_job {
+    pool_task_fn 	fn;
+    void 		*ctx;
+    int 		nthreads;
+    struct pool_worker 	*workers;
+};
+
+#define RANGE_LO(r) 		((uint32_t)((r) & 0xffffffffu))
+#define RANGE_HI(r) 		((uint32_t)((r) >> 32))
+#define RANGE_PACK(lo, hi) 	(((uint64_t)(hi) << 32) | (uint64_t)(lo))
+
+///===============================================
+/// Number of online cores, at least 1.
+
+int pool_threads_default(void) {
+	 long n = sysconf(_SC_NPROCESSORS_ONLN);
+	 if (n < 1) n = 1;
+	 if (n > POOL_MAX_THREADS) n = POOL_MAX_THREADS;
+	 return (int)n;
+}
+
+///===============================================
+/// Resolves a requested thread count: 0 means all cores, and there is
+/// never more than one thread per task.
+
+int pool_threads(int nthreads, size_t ntasks) {
+	 if (nthreads <= 0) nthreads = pool_threads_default();
+	 if (nthreads > POOL_MAX_THREADS) nthreads = POOL_MAX_THREADS;
+	 if ((size_t)nthreads > ntasks) nthreads = (ntasks > 0) ? (int)ntasks : 1;
+	 return nthreads;
+}
+
+///===============================================
+/// Claims the lowest task of our own range.
+
+static int pool_pop(struct pool_worker *w, size_t *task) {
+	 uint64_t r = atomic_load_explicit(&w->range, memory_order_acquire);
+	 while (RANGE_LO(r) < RANGE_HI(r)) {
+		 if (atomic_compare_exchange_weak_explicit(&w->range, &r, RANGE_PACK(RANGE_LO(r) + 1, RANGE_HI(r)),
+				memory_order_acq_rel, memory_order_acquire)) {
+			 *task = RANGE_LO(r);
+			 return 1;
+		 }
+	 }
+	 return 0;
+}
+
+///===============================================
+/// Takes the upper half of a victim's range. The first stolen task is
+/// returned and the rest becomes the thief's own range.
+
+static int pool_steal(struct pool_worker *self, struct pool_worker *victim, size_t *task) {
+	 uint64_t r = atomic_load_explicit(&victim->range, memory_order_acquire);
+	 while (RANGE_LO(r) < RANGE_HI(r)) {
+		 uint32_t lo = RANGE_LO(r), hi = RANGE_HI(r);
+		 uint32_t mid = lo + (hi - lo) / 2;
+		 if (atomic_compare_exchange_weak_explicit(&victim->range, &r, RANGE_PACK(lo, mid),
+				memory_order_acq_rel, memory_order_acquire)) {
+			 atomic_store_explicit(&self->range, RANGE_PACK(mid + 1, hi), memory_order_release);
+			 *task = mid;
+			 return 1;
+		 }
+	 }
+	 return 0;
+}
+
+///===============================================
+
+static void *pool_main(void *arg) {
+	 struct pool_worker *w = arg;
+	 struct pool_job *job = w->job;
+	 size_t task = 0;
+	 int k;
+
+	 for (;;) {
+		 while (pool_pop(w, &task)) job->fn(job->ctx, task, w->id);
+		 /// Out of work: look for a victim, starting with our neighbour
+		 for (k = 1; k < job->nthreads; k++) {
+			 struct pool_worker *victim = &job->workers[(w->id + k) % job->nthreads];
+			 if (pool_steal(w, victim, &task)) break;
+		 }
+		 if (k == job->nthreads) break;
+		 job->fn(job->ctx, task, w->id);
+	 }
+	 return NULL;
+}
+
+///===============================================
+/// Runs ntasks tasks on nthreads threads (0 == all cores). The calling
+/// thread works as worker 0. Returns 0, or -1 if ntasks does not fit the
+/// 32-bit task ranges or memory runs out.
+
+int pool_run(int nthreads, size_t ntasks, pool_task_fn fn, void *ctx) {
+	 struct pool_job job;
+	 struct pool_worker *workers;
+	 int k, started;
+
+	 if (ntasks == 0) return 0;
+	 if (ntasks > UINT32_MAX) return -1;
+	 nthreads = pool_threads(nthreads, ntasks);
+
+	 workers = aligned_alloc(_Alignof(struct pool_worker), nthreads * sizeof *workers);
+	 if (workers == NULL) return -1;
+	 job.fn = fn;
+	 job.ctx = ctx;
+	 job.nthreads = nthreads;
+	 job.workers = workers;
+
+	 for (k = 0; k < nthreads; k++) {
+		 size_t lo = ntasks * k / nthreads, hi = ntasks * (k + 1) / nthreads;
+		 atomic_init(&workers[k].range, RANGE_PACK(lo, hi));
+		 workers[k].id = k;
+		 workers[k].job = &job;
+	 }
+	 for (started = 1; started < nthreads; started++) {
+		 if (pthread_create(&workers[started].thread, NULL, pool_main, &workers[started]) != 0) break;
+	 }
+	 /// Any worker that failed to start simply has its range stolen
+	 pool_main(&workers[0]);
+	 for (k = 1; k < started; k++) pthread_join(workers[k].thread, NULL);
+	 free(workers);
+	 return 0;
+}
@@ -0,0 +1,29 @@
+// pool.h //
+#ifndef POOL_H
+#define POOL_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+
+/** Fork-join work-stealing thread pool.
+	pool_run calls fn(ctx, task, worker) once for every task in
+	[0, ntasks) and returns when all of them are done. Each worker starts
+	with a contiguous share of the tasks and, once it runs out, steals
+	the upper half of another worker's remaining range. No lock is
+	taken anywhere, and worker is in [0, nthreads) for per-thread scratch.
+**/
+
+#define POOL_MAX_THREADS 	256
+
+typedef void (*pool_task_fn)(void *ctx, size_t task, int worker);
+
+int pool_threads_default(void);
+int pool_threads(int nthreads, size_t ntasks);
+int pool_run(int nthreads, size_t ntasks, pool_task_fn fn, void *ctx);
+
+#endif
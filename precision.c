@@ -0,0 +1,140 @@
+///	Package:	circuit
+///	File:		precision.c
+///	Purpose:	Float fast path, double reference path and their comparison
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "batch.h"
+#include "precision.h"
+
+#define PREC_NAME(id, name) name,
+static const char *prec_names[PREC_NOUT] = { PREC_OUTPUTS(PREC_NAME) };
+#undef PREC_NAME
+
+const char *prec_output_name(enum prec_output k) {
+	 return (k >= 0 && k < PREC_NOUT) ? prec_names[k] : "?";
+}
+
+void prec_report_init(struct prec_report *rep) {
+	 memset(rep, 0, sizeof *rep);
+}
+
+///===============================================
+/// Relative error of f against the reference d.
+
+static double prec_rel(double f, double d) {
+	 if (f == d || (isnan(f) && isnan(d))) return 0;
+	 if (d == 0 || isnan(f) || isnan(d)) return INFINITY;
+	 return fabs((f - d) / d);
+}
+
+static void prec_note(struct prec_report *rep, enum prec_output k, double f, double d, size_t i) {
+	 double e = prec_rel(f, d);
+	 if (e > rep->max_rel[k]) {
+		 rep->max_rel[k] = e;
+		 rep->worst[k] = i;
+	 }
+}
+
+/// Folds from into into, as if from's points had come after into's.
+void prec_report_merge(struct prec_report *into, const struct prec_report *from) {
+	 int k;
+	 for (k = 0; k < PREC_NOUT; k++) {
+		 if (from->max_rel[k] > into->max_rel[k]) {
+			 into->max_rel[k] = from->max_rel[k];
+			 into->worst[k] = from->worst[k];
+		 }
+	 }
+	 into->points += from->points;
+	 into->exceeded += from->exceeded;
+}
+
+///===============================================
+/// Design points [begin, end) of b in the given precision, results in
+/// b's output columns either way. rep is only used by PREC_VALIDATE and
+/// may be NULL.
+
+void prec_run_range(struct C_batch *b, size_t begin, size_t end, enum prec_mode mode, struct prec_report *rep) {
+	 size_t i;
+	 int k;
+
+	 if (mode != PREC_DOUBLE) batch_run_range(b, begin, end);
+	 if (mode == PREC_FLOAT || (mode == PREC_VALIDATE && rep == NULL)) return;
+
+	 for (i = begin; i < end; i++) {
+		 struct C_design d = { b->v[i], b->r[i], b->num[i], b->fixed_res[i], b->rtja[i], b->amb[i], b->ojt[i] };
+		 double out[PREC_NOUT];
+		 int exceeded;
+		 prec_chain_d(&d, out, &exceeded);
+		 if (mode == PREC_DOUBLE) {
+			 b->par_res[i] = (float)out[PREC_PAR_RES];
+			 b->var_res[i] = (float)out[PREC_VAR_RES];
+			 b->branch_i[i] = (float)out[PREC_BRANCH_I];
+			 b->total_i[i] = (float)out[PREC_TOTAL_I];
+			 b->power[i] = (float)out[PREC_POWER];
+			 b->temp_rise[i] = (float)out[PREC_TEMP_RISE];
+			 b->ojt_diff[i] = (float)out[PREC_OJT_DIFF];
+			 b->exceeded[i] = exceeded;
+			 b->lux[i] = (float)out[PREC_LUX];
+			 b->percent[i] = (float)out[PREC_PERCENT];
+		 } else {
+			 float f[PREC_NOUT] = { b->par_res[i], b->var_res[i], b->branch_i[i], b->total_i[i], b->power[i],
+				b->temp_rise[i], b->ojt_diff[i], b->lux[i], b->percent[i], 0 };
+			 for (k = 0; k < PREC_NCHAIN; k++) prec_note(rep, k, f[k], out[k], i);
+			 rep->exceeded += (b->exceeded[i] != exceeded);
+		 }
+	 }
+	 if (mode == PREC_VALIDATE) rep->points += end - begin;
+}
+
+void prec_run(struct C_batch *b, enum prec_mode mode, struct prec_report *rep) {
+	 prec_run_range(b, 0, b->n, mode, rep);
+}
+
+///===============================================
+/// Intensities of n I_test records into out (n doubles). PREC_VALIDATE
+/// writes the float results.
+
+void prec_run_intensity(const struct I_test *t, size_t n, double *out, enum prec_mode mode, struct prec_report *rep) {
+	 size_t i;
+
+	 for (i = 0; i < n; i++) {
+		 float f = prec_intensity_f(t[i].c, t[i].ri, t[i].e0, (float)t[i].Efield);
+		 double d = 0;
+		 if (mode != PREC_FLOAT) d = prec_intensity_d(t[i].c, t[i].ri, t[i].e0, t[i].Efield);
+		 out[i] = (mode == PREC_DOUBLE) ? d : f;
+		 if (mode == PREC_VALIDATE && rep != NULL) prec_note(rep, PREC_INTENSITY, f, d, i);
+	 }
+	 if (mode == PREC_VALIDATE && rep != NULL) rep->points += n;
+}
+
+///===============================================
+/// One line per output: the max relative error, the point it was at,
+/// and about how many bits of float's 24 it leaves. Returns 0, or -1 on
+/// a write error.
+
+int prec_report_print(FILE *fp, const struct prec_report *rep) {
+	 int k;
+
+	 fprintf(fp, "float vs double over %zu points, %zu temperature limit disagreements\n", rep->points, rep->exceeded);
+	 fprintf(fp, "%-10s %12s %10s %6s\n", "output", "max rel err", "at", "bits");
+	 for (k = 0; k < PREC_NOUT; k++) {
+		 double e = rep->max_rel[k];
+		 double bits = (e > 0) ? -log2(e) : 24;
+		 if (bits > 24) bits = 24;
+		 if (bits < 0) bits = 0;
+		 fprintf(fp, "%-10s %12.3g %10zu %6.1f\n", prec_names[k], e, rep->worst[k], bits);
+	 }
+	 return ferror(fp) ? -1 : 0;
+}
@@ -0,0 +1,112 @@
+// precision.h //
+#ifndef PRECISION_H
+#define PRECISION_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "kernel.h"
+#include "batch.h"
+
+/** Precision-selectable kernels.
+	PREC_FLOAT	float throughout: batch_run's SIMD path in whichever
+			cpu.h variant is running, and the same results as k_chain
+	PREC_DOUBLE	every step in double from the same float inputs, the
+			sign-off reference; results are rounded to float once,
+			at the end
+	PREC_VALIDATE	runs both, keeps the float results and reports the
+			largest relative error of each output against double
+
+	The chain below is kernel.h's K_CHAIN_BODY, the one copy of its
+	formulas, stamped out per type by PREC_CHAIN; the intensity kernel
+	is stamped out by PREC_INTENSITY_FN. Unlike calc_intensity,
+	whose int c was kept for its callers, the speed of light is a real
+	number of the kernel's type here.
+**/
+enum prec_mode {
+    PREC_FLOAT = 0,
+    PREC_DOUBLE,
+    PREC_VALIDATE
+};
+
+/// Output, name
+#define PREC_OUTPUTS(X) \
+	X(PREC_PAR_RES,		"par_res") \
+	X(PREC_VAR_RES,		"var_res") \
+	X(PREC_BRANCH_I,	"branch_i") \
+	X(PREC_TOTAL_I,		"total_i") \
+	X(PREC_POWER,		"power") \
+	X(PREC_TEMP_RISE,	"temp_rise") \
+	X(PREC_OJT_DIFF,	"ojt_diff") \
+	X(PREC_LUX,		"lux") \
+	X(PREC_PERCENT,		"percent") \
+	X(PREC_INTENSITY,	"intensity")
+
+#define PREC_ID(id, name) id,
+enum prec_output {
+	PREC_OUTPUTS(PREC_ID)
+	PREC_NOUT,
+	PREC_NCHAIN = PREC_INTENSITY	// outputs of the chain, the ones before intensity
+};
+#undef PREC_ID
+
+/** What PREC_VALIDATE found. rel is |float - double| / |double|, 0 where
+	both are equal (NaNs included) and infinite where only the double
+	is 0 or only one is NaN. worst is the point index of max_rel, the
+	first one on ties. exceeded counts points where the two paths
+	disagree on the temperature limit.
+**/
+struct prec_report {
+    size_t 	points;				// compared so far
+    double 	max_rel[PREC_NOUT];
+    size_t 	worst[PREC_NOUT];
+    size_t 	exceeded;
+};
+
+///===============================================
+/// k_chain for one design point in type T, from the same K_CHAIN_BODY.
+
+#define PREC_CHAIN(NAME, T) \
+static inline void NAME(const struct C_design *d, T out[PREC_NOUT], int *exceeded) { \
+	 K_CHAIN_BODY(T, int, K_CONST, K_SELECT, (T)d->v, (T)d->r, (T)(int)d->num, (T)d->fixed_res, \
+		(T)d->rtja, (T)d->amb, (T)d->ojt); \
+	 out[PREC_PAR_RES] = k_par; \
+	 out[PREC_VAR_RES] = k_var; \
+	 out[PREC_BRANCH_I] = k_bi; \
+	 out[PREC_TOTAL_I] = k_ti; \
+	 out[PREC_POWER] = k_pw; \
+	 out[PREC_TEMP_RISE] = k_tr; \
+	 out[PREC_OJT_DIFF] = k_ojt_diff; \
+	 out[PREC_LUX] = k_lux; \
+	 out[PREC_PERCENT] = k_pct; \
+	 out[PREC_INTENSITY] = 0; \
+	 *exceeded = k_exc; \
+}
+
+/// k_intensity in type T, c included
+#define PREC_INTENSITY_FN(NAME, T) \
+static inline T NAME(T c, T ri, T eps0, T efield) { \
+	 return ((c * ri * eps0) / 2) * (efield * efield); \
+}
+
+PREC_CHAIN(prec_chain_f, float)
+PREC_CHAIN(prec_chain_d, double)
+PREC_INTENSITY_FN(prec_intensity_f, float)
+PREC_INTENSITY_FN(prec_intensity_d, double)
+
+const char *prec_output_name(enum prec_output k);
+void prec_report_init(struct prec_report *rep);
+void prec_report_merge(struct prec_report *into, const struct prec_report *from);
+int prec_report_print(FILE *fp, const struct prec_report *rep);
+
+void prec_run_range(struct C_batch *b, size_t begin, size_t end, enum prec_mode mode, struct prec_report *rep);
+void prec_run(struct C_batch *b, enum prec_mode mode, struct prec_report *rep);
+void prec_run_intensity(const struct I_test *t, size_t n, double *out, enum prec_mode mode, struct prec_report *rep);
+
+#endif
@@ -0,0 +1,286 @@
+///	Package:	intensity
+///	File:		prof.c
+///	Purpose:	Per-thread call counters, timers and traces (-DPROF_ENABLE)
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * Chrome Trace Event Format, "Complete" (ph "X") events
+**/
+
+/** Every thread gets a prof_thread record the first time it records
+	anything, taken under prof_lock and linked into prof_threads. From
+	then on the thread writes only to its own record. When the thread
+	exits its record goes on a free list and the next new thread takes
+	it over, still holding the old counts, so the pool's short-lived
+	workers don't pile up records and the totals stay right.
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "prof.h"
+
+#ifdef PROF_ENABLE
+
+#include <time.h>
+#include <pthread.h>
+
+#define PROF_CALIBRATE_NS 	20e6	// shortest span to measure the tick rate over
+
+struct prof_event {
+    uint64_t 	t0;
+    uint64_t 	ticks;
+    int32_t 	probe;
+};
+
+struct prof_thread {
+    uint64_t 		calls[PROF_NPROBES];
+    uint64_t 		items[PROF_NPROBES];
+    uint64_t 		ticks[PROF_NPROBES];
+    uint64_t 		hist[PROF_NPROBES][PROF_BUCKETS];
+    struct prof_event 	*events;	// ring of PROF_TRACE_EVENTS when tracing
+    size_t 		nevents;	// ever recorded; the ring holds the last ones
+    int 		tid;		// trace thread id, from 1
+    struct prof_thread 	*next;		// all records
+    struct prof_thread 	*next_free;
+};
+
+#define PROF_NAME(id, name) name,
+static const char *prof_names[PROF_NPROBES] = { PROF_PROBES(PROF_NAME) };
+#undef PROF_NAME
+
+static pthread_mutex_t prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t prof_once = PTHREAD_ONCE_INIT;
+static pthread_key_t prof_key;
+static struct prof_thread *prof_threads;
+static struct prof_thread *prof_free;
+static int prof_nthreads;
+static int prof_tracing;
+static _Thread_local struct prof_thread *prof_self;
+
+/// Start of the run, for the wall time and the tick rate
+static uint64_t prof_t0;
+static double prof_ns0;
+
+static double prof_clock_ns(void) {
+	 struct timespec ts;
+	 clock_gettime(CLOCK_MONOTONIC, &ts);
+	 return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+///===============================================
+/// Thread records.
+
+static void prof_detach(void *arg) {
+	 struct prof_thread *p = arg;
+	 pthread_mutex_lock(&prof_lock);
+	 p->next_free = prof_free;
+	 prof_free = p;
+	 pthread_mutex_unlock(&prof_lock);
+}
+
+static void prof_init(void) {
+	 pthread_key_create(&prof_key, prof_detach);
+	 prof_t0 = prof_now();
+	 prof_ns0 = prof_clock_ns();
+}
+
+static struct prof_thread *prof_attach(void) {
+	 struct prof_thread *p;
+
+	 pthread_once(&prof_once, prof_init);
+	 pthread_mutex_lock(&prof_lock);
+	 p = prof_free;
+	 if (p != NULL) {
+		 prof_free = p->next_free;
+	 } else if ((p = calloc(1, sizeof *p)) != NULL) {
+		 p->tid = ++prof_nthreads;
+		 p->next = prof_threads;
+		 prof_threads = p;
+	 }
+	 pthread_mutex_unlock(&prof_lock);
+	 if (p != NULL) pthread_setspecific(prof_key, p);
+	 prof_self = p;
+	 return p;
+}
+
+static inline int prof_bucket(uint64_t ticks) {
+	 int b = 63 - __builtin_clzll(ticks | 1);
+	 return (b < PROF_BUCKETS) ? b : PROF_BUCKETS - 1;
+}
+
+///===============================================
+/// The hot path: one call of probe that started at tick t0.
+
+void prof_end(enum prof_probe probe, uint64_t t0, uint64_t items) {
+	 uint64_t d = prof_now() - t0;
+	 struct prof_thread *p = prof_self;
+
+	 if (p == NULL && (p = prof_attach()) == NULL) return;
+	 p->calls[probe]++;
+	 p->items[probe] += items;
+	 p->ticks[probe] += d;
+	 p->hist[probe][prof_bucket(d)]++;
+	 if (prof_tracing) {
+		 if (p->events == NULL) p->events = malloc(PROF_TRACE_EVENTS * sizeof *p->events);
+		 if (p->events != NULL) {
+			 struct prof_event *e = &p->events[p->nevents++ & (PROF_TRACE_EVENTS - 1)];
+			 e->t0 = t0;
+			 e->ticks = d;
+			 e->probe = probe;
+		 }
+	 }
+}
+
+void prof_count(enum prof_probe probe, uint64_t items) {
+	 struct prof_thread *p = prof_self;
+	 if (p == NULL && (p = prof_attach()) == NULL) return;
+	 p->calls[probe]++;
+	 p->items[probe] += items;
+}
+
+///===============================================
+/// Zeroes every thread's counts and trace and restarts the clock.
+
+void prof_reset(void) {
+	 struct prof_thread *p;
+
+	 pthread_once(&prof_once, prof_init);
+	 pthread_mutex_lock(&prof_lock);
+	 for (p = prof_threads; p != NULL; p = p->next) {
+		 memset(p->calls, 0, sizeof p->calls);
+		 memset(p->items, 0, sizeof p->items);
+		 memset(p->ticks, 0, sizeof p->ticks);
+		 memset(p->hist, 0, sizeof p->hist);
+		 p->nevents = 0;
+	 }
+	 prof_t0 = prof_now();
+	 prof_ns0 = prof_clock_ns();
+	 pthread_mutex_unlock(&prof_lock);
+}
+
+void prof_trace(int on) {
+	 prof_tracing = on;
+}
+
+///===============================================
+/// Nanoseconds per tick, measured against the monotonic clock over the
+/// run so far (at least PROF_CALIBRATE_NS of it).
+
+double prof_ns_per_tick(void) {
+	 double ns;
+	 uint64_t t;
+
+#if defined(__x86_64__) || defined(__i386__)
+	 pthread_once(&prof_once, prof_init);
+	 do {
+		 t = prof_now();
+		 ns = prof_clock_ns();
+	 } while (ns - prof_ns0 < PROF_CALIBRATE_NS);
+	 return (t > prof_t0) ? (ns - prof_ns0) / (double)(t - prof_t0) : 1.0;
+#else
+	 (void)ns;
+	 (void)t;
+	 return 1.0;
+#endif
+}
+
+void prof_stat(enum prof_probe probe, struct prof_total *out) {
+	 struct prof_thread *p;
+	 int b;
+
+	 memset(out, 0, sizeof *out);
+	 pthread_mutex_lock(&prof_lock);
+	 for (p = prof_threads; p != NULL; p = p->next) {
+		 out->calls += p->calls[probe];
+		 out->items += p->items[probe];
+		 out->ticks += p->ticks[probe];
+		 for (b = 0; b < PROF_BUCKETS; b++) out->hist[b] += p->hist[probe][b];
+	 }
+	 pthread_mutex_unlock(&prof_lock);
+	 out->ns = (double)out->ticks * prof_ns_per_tick();
+}
+
+/// Upper edge, in ticks, of the bucket holding the q quantile
+static double prof_quantile(const struct prof_total *s, double q) {
+	 uint64_t want = (uint64_t)ceil(q * (double)s->calls), seen = 0;
+	 int b;
+	 for (b = 0; b < PROF_BUCKETS; b++) {
+		 seen += s->hist[b];
+		 if (seen >= want && seen > 0) return ldexp(1.0, b + 1);
+	 }
+	 return ldexp(1.0, PROF_BUCKETS);
+}
+
+///===============================================
+/// Writes one line per probe that was hit: calls, total time and its
+/// share of the wall time since prof_reset, the mean and the histogram
+/// p50/p99 per call, and design points per second. Nested probes are
+/// each counted in full. Returns 0, or -1 on a write error.
+
+int prof_summary(FILE *fp) {
+	 double tick = prof_ns_per_tick(), wall = prof_clock_ns() - prof_ns0;
+	 int k;
+
+	 fprintf(fp, "prof: %.3f ms wall, %d thread records\n", wall * 1e-6, prof_nthreads);
+	 fprintf(fp, "%-26s %12s %12s %7s %10s %10s %10s %12s\n",
+		"probe", "calls", "total ms", "wall%", "ns/call", "p50 ns", "p99 ns", "items/s");
+	 for (k = 0; k < PROF_NPROBES; k++) {
+		 struct prof_total s;
+		 prof_stat(k, &s);
+		 if (s.calls == 0) continue;
+		 if (s.ticks == 0) {
+			 fprintf(fp, "%-26s %12llu %12s %7s %10s %10s %10s %12s\n", prof_names[k],
+				(unsigned long long)s.calls, "-", "-", "-", "-", "-", "-");
+			 continue;
+		 }
+		 fprintf(fp, "%-26s %12llu %12.3f %6.1f%% %10.4g %10.4g %10.4g %12.4g\n", prof_names[k],
+			(unsigned long long)s.calls, s.ns * 1e-6, 100 * s.ns / wall, s.ns / (double)s.calls,
+			prof_quantile(&s, 0.5) * tick, prof_quantile(&s, 0.99) * tick,
+			s.items ? (double)s.items * 1e9 / s.ns : 0.0);
+	 }
+	 return ferror(fp) ? -1 : 0;
+}
+
+///===============================================
+/// Writes the traced calls as Chrome trace JSON, times in microseconds
+/// from prof_reset. Returns 0, or -1 if path can't be written.
+
+int prof_write_trace(const char *path) {
+	 FILE *fp = fopen(path, "w");
+	 double tick = prof_ns_per_tick();
+	 struct prof_thread *p;
+	 const char *sep = "";
+	 int rc;
+
+	 if (fp == NULL) return -1;
+	 fprintf(fp, "{\"traceEvents\":[");
+	 pthread_mutex_lock(&prof_lock);
+	 for (p = prof_threads; p != NULL; p = p->next) {
+		 size_t n = (p->nevents < PROF_TRACE_EVENTS) ? p->nevents : PROF_TRACE_EVENTS;
+		 size_t first = p->nevents - n, k;
+		 if (p->events == NULL) continue;
+		 for (k = first; k < p->nevents; k++) {
+			 const struct prof_event *e = &p->events[k & (PROF_TRACE_EVENTS - 1)];
+			 fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				sep, prof_names[e->probe], p->tid,
+				(double)(int64_t)(e->t0 - prof_t0) * tick * 1e-3, (double)e->ticks * tick * 1e-3);
+			 sep = ",";
+		 }
+	 }
+	 pthread_mutex_unlock(&prof_lock);
+	 fprintf(fp, "\n]}\n");
+	 rc = ferror(fp) ? -1 : 0;
+	 if (fclose(fp) != 0) rc = -1;
+	 return rc;
+}
+
+#endif
@@ -0,0 +1,133 @@
+// prof.h //
+#ifndef PROF_H
+#define PROF_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Hot-path instrumentation, built only with -DPROF_ENABLE
+	(make -f make-test.mk PROF=1 ...). Without it every macro below is
+	an empty statement and every function an empty inline, so the
+	instrumented code is exactly the code without them.
+
+	PROF_BEGIN(t)			starts a timer in a new local t (prof_t
+					by convention, clear of real locals)
+	PROF_END(probe, t, items)	counts one call of probe, its time since t
+					and the design points it handled
+	PROF_COUNT(probe, items)	counts a call without timing it
+
+	Each thread records into its own counters and latency histogram
+	(log2 buckets of the tick count), so nothing is shared on the hot
+	path; prof_summary and prof_stat add the threads up afterwards.
+	With tracing on, each thread also keeps its last PROF_TRACE_EVENTS
+	timed calls for prof_write_trace, in the Chrome trace event JSON
+	format (chrome://tracing or ui.perfetto.dev). Ticks are the TSC on
+	x86 and clock_gettime nanoseconds elsewhere.
+
+	prof_reset and prof_summary are meant to be called between runs,
+	with no other thread recording.
+**/
+
+#define PROF_BUCKETS 		48		// log2 latency buckets, in ticks
+#define PROF_TRACE_EVENTS 	(1 << 16)	// per thread
+
+/// Probe, name
+#define PROF_PROBES(X) \
+	X(PROF_PARALLEL_RESISTANCE,	"calc_parallel_resistance") \
+	X(PROF_VAR_RESISTANCE,		"calc_var_resistance") \
+	X(PROF_OUTPUT_RESISTANCE,	"calc_output_resistance") \
+	X(PROF_TOTAL_CURRENT,		"total_current") \
+	X(PROF_BRANCH_CURRENT,		"branch_current") \
+	X(PROF_POWER_VI,		"calc_power_VI") \
+	X(PROF_TOTAL_POWER,		"calc_total_power") \
+	X(PROF_TEMP_RISE,		"calc_temp_rise") \
+	X(PROF_JUNCT_TEMP_EXCEEDED,	"junct_temp_exceeded") \
+	X(PROF_TEMP_DIFF_OJT_TR,	"temp_diff_OJT_TR") \
+	X(PROF_RES_TO_LUX,		"DE_ResToLux") \
+	X(PROF_RES_TO_PERCENT,		"DE_ResToPercent") \
+	X(PROF_RES_TO_ALL,		"DE_ResToAll") \
+	X(PROF_INTENSITY,		"calc_intensity") \
+	X(PROF_IRRADIANCE,		"calc_irradiance") \
+	X(PROF_ELECTRIC_FIELD,		"calc_Electric_Field") \
+	X(PROF_LUX,			"calc_Lux") \
+	X(PROF_REPORT_EMIT,		"report_emit") \
+	X(PROF_REPORT_FLUSH,		"report_flush") \
+	X(PROF_BATCH_RUN,		"batch_run") \
+	X(PROF_SWEEP_CHUNK,		"sweep_chunk") \
+	X(PROF_SWEEP_MERGE,		"sweep_merge") \
+	X(PROF_MC_CHUNK,		"mc_chunk") \
+	X(PROF_IRR_BAND,		"irr_band") \
+	X(PROF_THERMAL_CHUNK,		"thermal_chunk") \
+	X(PROF_MNA_FACTOR,		"mna_factor") \
+	X(PROF_MNA_SOLVE,		"mna_solve") \
+	X(PROF_ET_BLOCK,		"et_block") \
+	X(PROF_STREAM_READ,		"stream_read") \
+	X(PROF_STREAM_PARSE,		"stream_parse") \
+	X(PROF_STREAM_BATCH,		"stream_batch") \
+	X(PROF_STREAM_WRITE,		"stream_write")
+
+#define PROF_ID(id, name) id,
+enum prof_probe {
+	PROF_PROBES(PROF_ID)
+	PROF_NPROBES
+};
+#undef PROF_ID
+
+/// One probe added up over every thread
+struct prof_total {
+    uint64_t 	calls;
+    uint64_t 	items;
+    uint64_t 	ticks;
+    double 	ns;				// ticks in nanoseconds
+    uint64_t 	hist[PROF_BUCKETS];		// calls by floor(log2(ticks))
+};
+
+#ifdef PROF_ENABLE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t prof_now(void) { return __rdtsc(); }
+#else
+#include <time.h>
+static inline uint64_t prof_now(void) {
+	 struct timespec ts;
+	 clock_gettime(CLOCK_MONOTONIC, &ts);
+	 return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+void prof_end(enum prof_probe probe, uint64_t t0, uint64_t items);
+void prof_count(enum prof_probe probe, uint64_t items);
+
+#define PROF_BEGIN(t) 			uint64_t t = prof_now()
+#define PROF_END(probe, t, items) 	prof_end((probe), (t), (items))
+#define PROF_COUNT(probe, items) 	prof_count((probe), (items))
+
+void prof_reset(void);
+void prof_trace(int on);
+void prof_stat(enum prof_probe probe, struct prof_total *out);
+double prof_ns_per_tick(void);
+int prof_summary(FILE *fp);
+int prof_write_trace(const char *path);
+
+#else
+
+#define PROF_BEGIN(t) 			do { } while (0)
+#define PROF_END(probe, t, items) 	do { } while (0)
+#define PROF_COUNT(probe, items) 	do { } while (0)
+
+static inline void prof_reset(void) { }
+static inline void prof_trace(int on) { (void)on; }
+static inline int prof_summary(FILE *fp) { (void)fp; return 0; }
+static inline int prof_write_trace(const char *path) { (void)path; return 0; }
+
+#endif
+
+#endif
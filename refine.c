@@ -0,0 +1,495 @@
+///	Package:	circuit
+///	File:		refine.c
+///	Purpose:	Adaptive sweeps that refine around events and curvature
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <math.h>
+#include "constants.h"
+#include "kernel.h"
+#include "batch.h"
+#include "refine.h"
+
+#define RF_ROUND 	1024	// designs per batch_run
+
+#define RF_NAME(id, name, integer) name,
+static const char *const rf_input_names[] = { RF_INPUTS(RF_NAME) };
+#undef RF_NAME
+
+#define RF_INTEGER(id, name, integer) integer,
+static const int rf_input_integer[] = { RF_INPUTS(RF_INTEGER) };
+#undef RF_INTEGER
+
+#define RF_NAME(id, name) name,
+static const char *const rf_event_names[] = { RF_EVENTS(RF_NAME) };
+#undef RF_NAME
+
+static const size_t rf_input_offset[RF_NINPUTS] = {
+	offsetof(struct C_design, v), offsetof(struct C_design, r), offsetof(struct C_design, num),
+	offsetof(struct C_design, fixed_res), offsetof(struct C_design, rtja), offsetof(struct C_design, amb),
+	offsetof(struct C_design, ojt) };
+
+/// The outputs rf_line follows for curvature
+static const size_t rf_curve_offset[] = {
+	offsetof(struct C_result, total_i), offsetof(struct C_result, power),
+	offsetof(struct C_result, temp_rise), offsetof(struct C_result, lux),
+	offsetof(struct C_result, percent) };
+
+#define RF_NCURVES 	(sizeof rf_curve_offset / sizeof rf_curve_offset[0])
+
+const char *rf_input_name(enum rf_input in) {
+	 return (in < RF_NINPUTS) ? rf_input_names[in] : "?";
+}
+
+const char *rf_event_name(enum rf_event ev) {
+	 return (ev < RF_NEVENTS) ? rf_event_names[ev] : "?";
+}
+
+/// The event bits of design d with result res
+unsigned rf_state(const struct C_design *d, const struct C_result *res) {
+	 unsigned s = 0;
+	 if (res->exceeded) s |= 1u << RF_EXCEEDED;
+	 if (k_clamp_res(d->r) != d->r) s |= 1u << RF_RES_CLAMP;
+	 if (res->lux == 0) s |= 1u << RF_LUX_ZERO;
+	 if (res->percent == 0) s |= 1u << RF_PERCENT_ZERO;
+	 return s;
+}
+
+void rf_set(struct C_design *d, enum rf_input in, float x) {
+	 if (in < RF_NINPUTS) *(float *)((char *)d + rf_input_offset[in]) = x;
+}
+
+static float rf_curve(const struct C_result *res, size_t k) {
+	 return *(const float *)((const char *)res + rf_curve_offset[k]);
+}
+
+static int rf_span_ok(const struct rf_span *s) {
+	 return s != NULL && s->in < RF_NINPUTS && isfinite(s->lo) && isfinite(s->hi) && s->lo < s->hi;
+}
+
+///===============================================
+/// Along one input
+
+struct rf_line_ctx {
+    struct C_design 	base;
+    enum rf_input 	in;
+    int 		integer;
+    float 		xtol;
+    float 		rtol;
+    size_t 		budget;		// designs still allowed
+    float 		scale[RF_NCURVES];
+    struct C_batch 	b;
+    struct rf_line 	*out;
+    size_t 		scap;
+    size_t 		ccap;
+};
+
+/// An interval [a, b] of samples
+struct rf_pair {
+    size_t 	a;
+    size_t 	b;
+};
+
+/// Grows *p to hold need items of size bytes
+static int rf_grow(void *p, size_t *cap, size_t need, size_t size) {
+	 void *np;
+	 size_t ncap = (*cap > 0) ? *cap : 64;
+	 if (need <= *cap) return 0;
+	 while (ncap < need) ncap *= 2;
+	 np = realloc(*(void **)p, ncap * size);
+	 if (np == NULL) return -1;
+	 *(void **)p = np;
+	 *cap = ncap;
+	 return 0;
+}
+
+/// Runs the designs at xs[0 .. n) through the chain and appends them
+static int rf_eval(struct rf_line_ctx *c, const float *xs, size_t n) {
+	 struct rf_line *l = c->out;
+	 size_t i, j, m;
+
+	 if (rf_grow(&l->s, &c->scap, l->n + n, sizeof *l->s) != 0) return -1;
+	 for (i = 0; i < n; i += m) {
+		 m = (n - i < c->b.cap) ? n - i : c->b.cap;
+		 for (j = 0; j < m; j++) {
+			 struct C_design d = c->base;
+			 rf_set(&d, c->in, xs[i + j]);
+			 batch_set(&c->b, j, &d);
+		 }
+		 c->b.n = m;
+		 batch_run(&c->b);
+		 for (j = 0; j < m; j++) {
+			 struct rf_sample *s = &l->s[l->n++];
+			 struct C_design d = c->base;
+			 rf_set(&d, c->in, xs[i + j]);
+			 s->x = xs[i + j];
+			 batch_get(&c->b, j, &s->res);
+			 s->state = rf_state(&d, &s->res);
+		 }
+	 }
+	 c->budget -= n;
+	 return 0;
+}
+
+static int rf_cross(struct rf_line_ctx *c, const struct rf_sample *a, const struct rf_sample *b) {
+	 struct rf_line *l = c->out;
+	 if (rf_grow(&l->c, &c->ccap, l->nc + 1, sizeof *l->c) != 0) return -1;
+	 l->c[l->nc].lo = a->x;
+	 l->c[l->nc].hi = b->x;
+	 l->c[l->nc].from = a->state;
+	 l->c[l->nc].to = b->state;
+	 l->nc++;
+	 return 0;
+}
+
+/// The point to split [a, b] at, or 0 if it is as narrow as it gets
+static int rf_mid(const struct rf_line_ctx *c, float a, float b, float *m) {
+	 if (c->integer) {
+		 if (b - a <= 1) return 0;
+		 *m = floorf(a + (b - a) / 2);
+		 return 1;
+	 }
+	 if (b - a <= c->xtol) return 0;
+	 *m = a + (b - a) / 2;
+	 return *m > a && *m < b;
+}
+
+/// How far m is off the line from a to b, the worst output, in its scale
+static double rf_bend(const struct rf_line_ctx *c, const struct rf_sample *a, const struct rf_sample *m,
+	const struct rf_sample *b) {
+	 double t = ((double)m->x - a->x) / ((double)b->x - a->x), worst = 0;
+	 size_t k;
+	 for (k = 0; k < RF_NCURVES; k++) {
+		 double fa = rf_curve(&a->res, k), fm = rf_curve(&m->res, k), fb = rf_curve(&b->res, k);
+		 double e;
+		 if (!(c->scale[k] > 0)) continue;
+		 e = fabs(fm - (fa + t * (fb - fa))) / c->scale[k];
+		 if (isfinite(e) && e > worst) worst = e;
+	 }
+	 return worst;
+}
+
+static int rf_sample_cmp(const void *a, const void *b) {
+	 float x = ((const struct rf_sample *)a)->x, y = ((const struct rf_sample *)b)->x;
+	 return (x > y) - (x < y);
+}
+
+static int rf_crossing_cmp(const void *a, const void *b) {
+	 float x = ((const struct rf_crossing *)a)->lo, y = ((const struct rf_crossing *)b)->lo;
+	 return (x > y) - (x < y);
+}
+
+/** Follows the pending intervals down, a round at a time: every one that
+	can still split gets its midpoint, the midpoints run as one batch,
+	and each half goes on to the next round if an event is in it or the
+	curve bends over it. An interval as narrow as it gets, or past the
+	budget, is settled, and a crossing if its ends disagree.
+**/
+static int rf_refine(struct rf_line_ctx *c, struct rf_pair *pend, size_t npend) {
+	 struct rf_line *l = c->out;
+	 struct rf_pair *next = NULL, *split = NULL, *t;
+	 float *xs = NULL;
+	 size_t i, nsplit, nnext, base, ncap = 0, scap = 0, xcap = 0, pcap = npend;
+	 int rc = -1;
+
+	 while (npend > 0) {
+		 if (rf_grow(&next, &ncap, 2 * npend, sizeof *next) != 0 ||
+			 rf_grow(&split, &scap, npend, sizeof *split) != 0 ||
+			 rf_grow(&xs, &xcap, npend, sizeof *xs) != 0) goto done;
+		 for (i = nsplit = 0; i < npend; i++) {
+			 const struct rf_sample *a = &l->s[pend[i].a], *b = &l->s[pend[i].b];
+			 float m;
+			 if (rf_mid(c, a->x, b->x, &m)) {
+				 if (nsplit < c->budget) {
+					 split[nsplit] = pend[i];
+					 xs[nsplit++] = m;
+					 continue;
+				 }
+				 l->truncated = 1;
+			 }
+			 if (a->state != b->state && rf_cross(c, a, b) != 0) goto done;
+		 }
+		 base = l->n;
+		 if (rf_eval(c, xs, nsplit) != 0) goto done;
+		 for (i = nnext = 0; i < nsplit; i++) {
+			 size_t a = split[i].a, m = base + i, b = split[i].b;
+			 int bent = c->rtol > 0 && rf_bend(c, &l->s[a], &l->s[m], &l->s[b]) > c->rtol;
+			 if (bent || l->s[a].state != l->s[m].state) {
+				 next[nnext].a = a;
+				 next[nnext++].b = m;
+			 }
+			 if (bent || l->s[m].state != l->s[b].state) {
+				 next[nnext].a = m;
+				 next[nnext++].b = b;
+			 }
+		 }
+		 t = pend;	pend = next;	next = t;
+		 i = pcap;	pcap = ncap;	ncap = i;
+		 npend = nnext;
+	 }
+	 rc = 0;
+done:
+	 free(next);
+	 free(split);
+	 free(xs);
+	 free(pend);
+	 return rc;
+}
+
+/** Samples base along span, refined as cfg asks; see refine.h. Returns
+	-1 for a bad span or when out of memory, with out empty.
+**/
+int rf_line(const struct C_design *base, const struct rf_span *span, const struct rf_config *cfg,
+	struct rf_line *out) {
+	 struct rf_line_ctx c;
+	 struct rf_pair *pend = NULL;
+	 float *xs = NULL, lo, hi;
+	 size_t coarse, i, n, npend;
+	 int rc = -1;
+
+	 memset(out, 0, sizeof *out);
+	 if (base == NULL || cfg == NULL || !rf_span_ok(span) || !(cfg->xtol >= 0) || !(cfg->rtol >= 0)) return -1;
+	 memset(&c, 0, sizeof c);
+	 c.base = *base;
+	 c.in = span->in;
+	 c.integer = rf_input_integer[span->in];
+	 c.xtol = cfg->xtol;
+	 c.rtol = cfg->rtol;
+	 c.budget = (cfg->max_points > 0) ? cfg->max_points : RF_MAX_POINTS;
+	 c.out = out;
+	 lo = c.integer ? floorf(span->lo) : span->lo;
+	 hi = c.integer ? floorf(span->hi) : span->hi;
+	 coarse = (cfg->coarse > 0) ? cfg->coarse : RF_COARSE;
+	 if (coarse < 2) coarse = 2;
+	 if (!(lo < hi) || coarse > c.budget) return -1;
+	 if (batch_alloc(&c.b, RF_ROUND) != 0) return -1;
+
+	 /// The coarse start, evenly spaced; whole numbers stepped by whole amounts
+	 xs = malloc(coarse * sizeof *xs);
+	 if (xs == NULL) goto done;
+	 for (i = n = 0; i < coarse; i++) {
+		 float x = (i == coarse - 1) ? hi : (float)(lo + ((double)hi - lo) * i / (coarse - 1));
+		 if (c.integer) x = floorf(x);
+		 if (n == 0 || x > xs[n - 1]) xs[n++] = x;
+	 }
+	 if (rf_eval(&c, xs, n) != 0) goto done;
+
+	 /// Each output's range over the start is what rtol is a fraction of
+	 for (i = 0; i < RF_NCURVES; i++) {
+		 float fmin = INFINITY, fmax = -INFINITY;
+		 size_t j;
+		 for (j = 0; j < n; j++) {
+			 float f = rf_curve(&out->s[j].res, i);
+			 if (!isfinite(f)) continue;
+			 if (f < fmin) fmin = f;
+			 if (f > fmax) fmax = f;
+		 }
+		 c.scale[i] = (fmax > fmin) ? fmax - fmin : (fmax == fmin) ? fabsf(fmax) : 0;
+	 }
+
+	 pend = malloc((n - 1) * sizeof *pend);
+	 if (pend == NULL) goto done;
+	 for (i = npend = 0; i + 1 < n; i++) {
+		 if (c.rtol > 0 || out->s[i].state != out->s[i + 1].state) {
+			 pend[npend].a = i;
+			 pend[npend++].b = i + 1;
+		 }
+	 }
+	 rc = rf_refine(&c, pend, npend);
+	 pend = NULL;
+	 if (rc == 0) {
+		 qsort(out->s, out->n, sizeof *out->s, rf_sample_cmp);
+		 qsort(out->c, out->nc, sizeof *out->c, rf_crossing_cmp);
+	 }
+done:
+	 free(xs);
+	 free(pend);
+	 batch_free(&c.b);
+	 if (rc != 0) rf_line_free(out);
+	 return rc;
+}
+
+void rf_line_free(struct rf_line *l) {
+	 free(l->s);
+	 free(l->c);
+	 memset(l, 0, sizeof *l);
+}
+
+///===============================================
+/// Over a box
+
+/// Corner states by lattice position, open addressing
+struct rf_tree_ctx {
+    struct C_design 	base;
+    struct rf_span 	span[RF_MAX_DIMS];
+    int 		dims;
+    int 		coarse;
+    int 		depth;
+    uint64_t 		*keys;
+    uint8_t 		*states;	// RF_EMPTY where keys is unused
+    size_t 		cap;		// a power of 2
+    size_t 		used;
+    size_t 		ccap;
+    struct rf_tree 	*out;
+};
+
+#define RF_EMPTY 	0xff
+#define RF_KEY_BITS 	16	// per axis; positions run 0 .. 2^RF_MAX_DEPTH
+
+static size_t rf_slot(const struct rf_tree_ctx *c, uint64_t key) {
+	 return (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & (c->cap - 1);
+}
+
+static int rf_table_grow(struct rf_tree_ctx *c) {
+	 size_t ncap = (c->cap > 0) ? 2 * c->cap : 1024, i;
+	 uint64_t *keys = malloc(ncap * sizeof *keys), *old_keys = c->keys;
+	 uint8_t *states = malloc(ncap), *old_states = c->states;
+	 size_t old_cap = c->cap;
+
+	 if (keys == NULL || states == NULL) {
+		 free(keys);
+		 free(states);
+		 return -1;
+	 }
+	 memset(states, RF_EMPTY, ncap);
+	 c->keys = keys;
+	 c->states = states;
+	 c->cap = ncap;
+	 for (i = 0; i < old_cap; i++) {
+		 size_t k;
+		 if (old_states[i] == RF_EMPTY) continue;
+		 for (k = rf_slot(c, old_keys[i]); states[k] != RF_EMPTY; k = (k + 1) & (ncap - 1)) ;
+		 keys[k] = old_keys[i];
+		 states[k] = old_states[i];
+	 }
+	 free(old_keys);
+	 free(old_states);
+	 return 0;
+}
+
+/// The state at lattice position pos, evaluated the first time it is asked for
+static int rf_corner(struct rf_tree_ctx *c, const uint32_t *pos, unsigned *state) {
+	 uint64_t key = 0;
+	 size_t k;
+	 int d;
+
+	 for (d = 0; d < c->dims; d++) key |= (uint64_t)pos[d] << (RF_KEY_BITS * d);
+	 if (2 * (c->used + 1) > c->cap && rf_table_grow(c) != 0) return -1;
+	 for (k = rf_slot(c, key); c->states[k] != RF_EMPTY; k = (k + 1) & (c->cap - 1)) {
+		 if (c->keys[k] == key) {
+			 *state = c->states[k];
+			 return 0;
+		 }
+	 }
+	 {
+		 struct C_design des = c->base;
+		 struct C_result res;
+		 double steps = ldexp(1, c->depth);
+		 for (d = 0; d < c->dims; d++) {
+			 const struct rf_span *s = &c->span[d];
+			 rf_set(&des, s->in, (float)(s->lo + ((double)s->hi - s->lo) * pos[d] / steps));
+		 }
+		 k_chain(&des, &res);
+		 *state = rf_state(&des, &res);
+	 }
+	 c->keys[k] = key;
+	 c->states[k] = (uint8_t)*state;
+	 c->used++;
+	 c->out->evals++;
+	 return 0;
+}
+
+static int rf_boundary(struct rf_tree_ctx *c, const uint32_t *pos, uint32_t size, unsigned any, unsigned all) {
+	 struct rf_tree *t = c->out;
+	 struct rf_cell *cell;
+	 double steps = ldexp(1, c->depth);
+	 int d;
+
+	 if (rf_grow(&t->cells, &c->ccap, t->ncells + 1, sizeof *t->cells) != 0) return -1;
+	 cell = &t->cells[t->ncells++];
+	 memset(cell, 0, sizeof *cell);
+	 for (d = 0; d < c->dims; d++) {
+		 const struct rf_span *s = &c->span[d];
+		 cell->lo[d] = (float)(s->lo + ((double)s->hi - s->lo) * pos[d] / steps);
+		 cell->hi[d] = (float)(s->lo + ((double)s->hi - s->lo) * (pos[d] + size) / steps);
+	 }
+	 cell->any = any;
+	 cell->all = all;
+	 return 0;
+}
+
+/// The cell at pos, size lattice steps on a side, level splits down
+static int rf_visit(struct rf_tree_ctx *c, const uint32_t *pos, int level) {
+	 uint32_t size = (uint32_t)1 << (c->depth - level), corner[RF_MAX_DIMS];
+	 unsigned any = 0, all = RF_NSTATES - 1, st, k;
+	 int d;
+
+	 for (k = 0; k < (1u << c->dims); k++) {
+		 for (d = 0; d < c->dims; d++) corner[d] = pos[d] + (((k >> d) & 1) ? size : 0);
+		 if (rf_corner(c, corner, &st) != 0) return -1;
+		 any |= st;
+		 all &= st;
+	 }
+	 if (level < c->coarse || (any != all && level < c->depth)) {
+		 for (k = 0; k < (1u << c->dims); k++) {
+			 for (d = 0; d < c->dims; d++) corner[d] = pos[d] + (((k >> d) & 1) ? size / 2 : 0);
+			 if (rf_visit(c, corner, level + 1) != 0) return -1;
+		 }
+		 return 0;
+	 }
+	 c->out->leaves++;
+	 if (any == all) {
+		 c->out->frac[any] += ldexp(1, -level * c->dims);
+		 return 0;
+	 }
+	 c->out->mixed_frac += ldexp(1, -level * c->dims);
+	 return rf_boundary(c, pos, size, any, all);
+}
+
+/** Splits the box of spans[0 .. dims) around base down to depth levels,
+	every cell for the first coarse of them, then only cells whose
+	corners disagree. Inputs are spread evenly over each span; num is
+	truncated by the chain as usual. Returns -1 for bad spans or
+	depths, or when out of memory, with out empty.
+**/
+int rf_tree(const struct C_design *base, const struct rf_span *spans, int dims, int coarse, int depth,
+	struct rf_tree *out) {
+	 struct rf_tree_ctx c;
+	 uint32_t origin[RF_MAX_DIMS] = { 0 };
+	 int d, e, rc;
+
+	 memset(out, 0, sizeof *out);
+	 if (base == NULL || spans == NULL || dims < 1 || dims > RF_MAX_DIMS) return -1;
+	 if (coarse < 0 || coarse > depth || depth > RF_MAX_DEPTH) return -1;
+	 for (d = 0; d < dims; d++) {
+		 if (!rf_span_ok(&spans[d])) return -1;
+		 for (e = 0; e < d; e++) if (spans[e].in == spans[d].in) return -1;
+	 }
+	 memset(&c, 0, sizeof c);
+	 c.base = *base;
+	 memcpy(c.span, spans, dims * sizeof *spans);
+	 c.dims = dims;
+	 c.coarse = coarse;
+	 c.depth = depth;
+	 c.out = out;
+	 rc = rf_visit(&c, origin, 0);
+	 free(c.keys);
+	 free(c.states);
+	 if (rc != 0) rf_tree_free(out);
+	 return rc;
+}
+
+void rf_tree_free(struct rf_tree *t) {
+	 free(t->cells);
+	 memset(t, 0, sizeof *t);
+}
@@ -0,0 +1,151 @@
+// refine.h //
+#ifndef REFINE_H
+#define REFINE_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include "kernel.h"
+#include "batch.h"
+
+/** Adaptive sweeps. A fixed-step sweep spends most of its points where
+	nothing happens and still lands between the points where something
+	does. These start coarse and put points only where they are needed.
+
+	What the chain does at a design is summed up by its state, a set of
+	event bits: the junction limit is reached, the resistor is clamped
+	to DE_MIN_RES, lux or percent is clamped to 0. Two designs in
+	different states have an event between them.
+
+	rf_line walks one input over a range. An interval whose ends are in
+	different states is bisected until it is xtol wide, or, with xtol 0,
+	until its ends are adjacent floats: then the crossing is exact, the
+	last design on one side and the first on the other. With rtol set,
+	an interval is also split while its midpoint is further than rtol of
+	an output's range from the straight line between its ends, so the
+	samples trace the curves to that accuracy. Each round of midpoints
+	runs as one batch.
+
+	rf_tree does the same over up to RF_MAX_DIMS inputs at once with a
+	2^d-tree: a cell whose corners are all in one state is left whole,
+	one whose corners disagree is split, down to a given depth. Corners
+	are shared between cells and worked out once. The cells left at full
+	depth trace the boundaries between states, so the points needed grow
+	with the size of the boundary, not the volume of the box.
+
+	Both can miss an event that happens and undoes itself between two
+	samples of the coarse start; start finer to rule that out.
+**/
+
+/// Input, name, integer. The same order as C_design.
+#define RF_INPUTS(X) \
+	X(RF_V,		"v",		0) \
+	X(RF_R,		"r",		0) \
+	X(RF_NUM,	"num",		1) \
+	X(RF_FIXED_RES,	"fixed_res",	0) \
+	X(RF_RTJA,	"rtja",		0) \
+	X(RF_AMB,	"amb",		0) \
+	X(RF_OJT,	"ojt",		0)
+
+#define RF_ID(id, name, integer) id,
+enum rf_input {
+	RF_INPUTS(RF_ID)
+	RF_NINPUTS
+};
+#undef RF_ID
+
+/// Event, name. State bit 1 << event is set while it holds.
+#define RF_EVENTS(X) \
+	X(RF_EXCEEDED,		"exceeded") \
+	X(RF_RES_CLAMP,		"res_clamp") \
+	X(RF_LUX_ZERO,		"lux_zero") \
+	X(RF_PERCENT_ZERO,	"percent_zero")
+
+#define RF_ID(id, name) id,
+enum rf_event {
+	RF_EVENTS(RF_ID)
+	RF_NEVENTS
+};
+#undef RF_ID
+
+#define RF_NSTATES 	(1 << RF_NEVENTS)
+#define RF_COARSE 	17		// default first samples of rf_line
+#define RF_MAX_POINTS 	(1 << 20)	// default bound on rf_line's designs
+#define RF_MAX_DIMS 	4
+#define RF_MAX_DEPTH 	15		// rf_tree levels; 4 x 16 bit corner keys
+
+/// One input over [lo, hi]. An integer input, num, takes whole values.
+struct rf_span {
+    enum rf_input 	in;
+    float 		lo;
+    float 		hi;
+};
+
+struct rf_config {
+    size_t 	coarse;		// evenly spaced first samples, 0 == RF_COARSE
+    float 	xtol;		// crossing bracket width, 0 == adjacent floats
+    float 	rtol;		// midpoint error, of each output's range, 0 == off
+    size_t 	max_points;	// designs to evaluate at most, 0 == RF_MAX_POINTS
+};
+
+/// A design on the line: its input value, state and result
+struct rf_sample {
+    float 		x;
+    unsigned 		state;
+    struct C_result 	res;
+};
+
+/// A state change between lo and hi; nothing was sampled between them
+struct rf_crossing {
+    float 	lo;
+    float 	hi;
+    unsigned 	from;		// state at lo
+    unsigned 	to;		// state at hi
+};
+
+/// What rf_line found, samples and crossings in increasing x
+struct rf_line {
+    struct rf_sample 	*s;
+    size_t 		n;
+    struct rf_crossing 	*c;
+    size_t 		nc;
+    int 		truncated;	// max_points ran out; brackets may be wide
+};
+
+/// A cell rf_tree left at full depth with its corners in different states
+struct rf_cell {
+    float 	lo[RF_MAX_DIMS];
+    float 	hi[RF_MAX_DIMS];
+    unsigned 	any;		// state bits set at some corner
+    unsigned 	all;		// state bits set at every corner
+};
+
+/** What rf_tree found. frac[s] is the share of the box's volume in
+	cells wholly in state s; mixed_frac is the rest, the boundary cells.
+**/
+struct rf_tree {
+    size_t 		evals;		// designs evaluated
+    size_t 		leaves;
+    double 		frac[RF_NSTATES];
+    double 		mixed_frac;
+    struct rf_cell 	*cells;
+    size_t 		ncells;
+};
+
+const char *rf_input_name(enum rf_input in);
+const char *rf_event_name(enum rf_event ev);
+unsigned rf_state(const struct C_design *d, const struct C_result *res);
+void rf_set(struct C_design *d, enum rf_input in, float x);
+
+int rf_line(const struct C_design *base, const struct rf_span *span, const struct rf_config *cfg,
+	struct rf_line *out);
+void rf_line_free(struct rf_line *l);
+int rf_tree(const struct C_design *base, const struct rf_span *spans, int dims, int coarse, int depth,
+	struct rf_tree *out);
+void rf_tree_free(struct rf_tree *t);
+
+#endif
@@ -0,0 +1,127 @@
+///	Package:	intensity
+///	File:		report.c
+///	Purpose:	Reporting sinks for circuit and intensity results
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "report.h"
+#include "prof.h"
+
+#define REPORT_BUF_SIZE 	(64*1024)	// flush threshold for buffered sinks
+#define REPORT_LINE_MAX 	512		// longest single record
+
+/// The default sink reproduces the original printf behavior.
+static struct report_sink report_stdout = { REPORT_VERBOSE, NULL, NULL, 0, 0 };
+struct report_sink *report_active = &report_stdout;
+
+///===============================================
+/// Initializes a sink. fp == NULL writes to stdout.
+
+void report_open(struct report_sink *sink, enum report_mode mode, FILE *fp) {
+	 sink->mode = mode;
+	 sink->fp = fp;
+	 sink->buf = NULL;
+	 sink->len = 0;
+	 sink->cap = 0;
+	 if (mode == REPORT_BUFFERED || mode == REPORT_CSV) {
+		 sink->buf = malloc(REPORT_BUF_SIZE);
+		 sink->cap = (sink->buf != NULL) ? REPORT_BUF_SIZE : 0;
+	 }
+}
+
+///===============================================
+/// Writes out anything a buffered sink is holding.
+
+void report_flush(struct report_sink *sink) {
+	 FILE *fp = (sink->fp != NULL) ? sink->fp : stdout;
+	 PROF_BEGIN(prof_t);
+	 if (sink->len > 0) {
+		 fwrite(sink->buf, 1, sink->len, fp);
+		 sink->len = 0;
+	 }
+	 fflush(fp);
+	 PROF_END(PROF_REPORT_FLUSH, prof_t, 0);
+}
+
+///===============================================
+/// Flushes and releases a sink. If it is the active sink,
+/// reporting falls back to the default stdout sink.
+
+void report_close(struct report_sink *sink) {
+	 report_flush(sink);
+	 free(sink->buf);
+	 sink->buf = NULL;
+	 sink->cap = 0;
+	 if (report_active == sink) report_active = &report_stdout;
+}
+
+///===============================================
+/// Makes sink the active sink and returns the previous one.
+/// report_use(NULL) restores the default stdout sink.
+
+struct report_sink *report_use(struct report_sink *sink) {
+	 struct report_sink *prev = report_active;
+	 report_active = (sink != NULL) ? sink : &report_stdout;
+	 return prev;
+}
+
+///===============================================
+
+static void report_append(struct report_sink *sink, const char *line, int n) {
+	 if (n <= 0) return;
+	 if (sink->buf == NULL) {
+		 fwrite(line, 1, n, (sink->fp != NULL) ? sink->fp : stdout);
+		 return;
+	 }
+	 if (sink->len + n > sink->cap) report_flush(sink);
+	 memcpy(sink->buf + sink->len, line, n);
+	 sink->len += n;
+}
+
+///===============================================
+/// Sends one result record to the active sink.
+/// key names the record in CSV output, fmt is the verbose text,
+/// and the nvals double arguments are the values in both.
+
+void report_emit(const char *key, const char *fmt, int nvals, ...) {
+	 struct report_sink *sink = report_active;
+	 char line[REPORT_LINE_MAX];
+	 int n = 0, k;
+	 va_list ap;
+	 PROF_BEGIN(prof_t);
+
+	 va_start(ap, nvals);
+	 switch (sink->mode) {
+		case REPORT_VERBOSE:
+			vfprintf((sink->fp != NULL) ? sink->fp : stdout, fmt, ap);
+			break;
+		case REPORT_BUFFERED:
+			n = vsnprintf(line, sizeof line, fmt, ap);
+			if (n >= (int)sizeof line) n = sizeof line - 1;
+			report_append(sink, line, n);
+			break;
+		case REPORT_CSV:
+			n = snprintf(line, sizeof line, "%s", key);
+			for (k = 0; k < nvals && n < (int)sizeof line; k++) {
+				n += snprintf(line + n, sizeof line - n, ",%.9g", va_arg(ap, double));
+			}
+			if (n >= (int)sizeof line - 1) n = sizeof line - 2;
+			line[n++] = '\n';
+			report_append(sink, line, n);
+			break;
+		default:
+			break;
+	 }
+	 va_end(ap);
+	 PROF_END(PROF_REPORT_EMIT, prof_t, 0);
+}
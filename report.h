@@ -0,0 +1,46 @@
+// report.h //
+#ifndef REPORT_H
+#define REPORT_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdio.h>
+
+/** Reporting sinks for the calc_* functions.
+	REPORT_VERBOSE	printf the usual text lines, unbuffered (the default)
+	REPORT_BUFFERED	the same text, collected in memory and written in blocks
+	REPORT_CSV	one "key,value,value..." record per call, buffered
+	REPORT_NULL	nothing at all
+**/
+enum report_mode {
+    REPORT_NULL = 0,
+    REPORT_VERBOSE,
+    REPORT_BUFFERED,
+    REPORT_CSV
+};
+
+struct report_sink {
+    enum report_mode 	mode;
+    FILE 		*fp;	// NULL == stdout
+    char 		*buf;	// pending output for BUFFERED and CSV
+    size_t 		len;
+    size_t 		cap;
+};
+
+extern struct report_sink *report_active;
+
+void report_open(struct report_sink *sink, enum report_mode mode, FILE *fp);
+void report_flush(struct report_sink *sink);
+void report_close(struct report_sink *sink);
+struct report_sink *report_use(struct report_sink *sink);
+void report_emit(const char *key, const char *fmt, int nvals, ...);
+
+/// Every argument after nvals must be a double (floats promote on their own).
+/// The mode test is inlined so a null sink costs one branch per call.
+#define REPORT(...) do { if (report_active->mode != REPORT_NULL) report_emit(__VA_ARGS__); } while (0)
+
+#endif
@@ -1,10 +1,9 @@
 #!/bin/bash
 
 ## Individual code compilers.
-## You must uncomment the main in the .c file and comment the section
-## at the bottom before running these scripts.
+## circuit.c only builds its own main when CIRCUIT_MAIN is defined.
 
-#~ gcc -g -o circuit circuit.c -lcheck -lm -lrt -lsubunit -lcheck_pic
+#~ gcc -g -DCIRCUIT_MAIN -o circuit circuit.c report.c -lcheck -lm -lrt -lsubunit -lcheck_pic
 #~ ./circuit
 
 ####################
@@ -14,4 +13,26 @@
 make -f make-test.mk 
 ./circuittest
 ./intensitytest
+./batchtest
+./sweeptest
+./montecarlotest
+./inversetest
+./eseriestest
+./curvetest
+./irradiancetest
+./gaussbeamtest
+./thermaltest
+./mnatest
+./electrothermaltest
+./streamtest
+./proftest
+./precisiontest
+./cputest
+./memotest
+./modeltest
+./senstest
+./intervaltest
+./colfiletest
+./photometrytest
+./refinetest
 ./main
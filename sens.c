@@ -0,0 +1,152 @@
+///	Package:	circuit
+///	File:		sens.c
+///	Purpose:	One-pass sensitivities of the LED circuit chain by forward-mode AD
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "batch.h"
+#include "cpu.h"
+#include "sens.h"
+
+#define SENS_ALIGN 	64	// bytes, as batch.c
+#define SENS_BLOCK 	64	// rows per vectorized block
+#define SENS_NCOLS 	(SENS_NOUT * (1 + SENS_NPARAM))
+
+#define SENS_NAME(id, name) name,
+static const char *const sens_param_names[] = { SENS_PARAMS(SENS_NAME) };
+static const char *const sens_output_names[] = { SENS_OUTPUTS(SENS_NAME) };
+#undef SENS_NAME
+
+const char *sens_param_name(enum sens_param p) {
+	 return (p < SENS_NPARAM) ? sens_param_names[p] : "?";
+}
+
+const char *sens_output_name(enum sens_output o) {
+	 return (o < SENS_NOUT) ? sens_output_names[o] : "?";
+}
+
+///===============================================
+/// k_chain on duals, the inputs seeded as the parameters they are
+
+CPU_KERNEL void sens_point(float v_in, float r_in, float num_in, float fixed_in, float rtja_in,
+	float amb_in, float ojt_in, struct dual out[SENS_NOUT]) {
+	 struct dual v = dual_var(v_in, SENS_V), r = dual_var(r_in, SENS_R);
+	 struct dual num = dual_var((float)(int)num_in, SENS_NUM);
+	 struct dual rtja = dual_var(rtja_in, SENS_RTJA), amb = dual_var(amb_in, SENS_AMB);
+
+	 out[SENS_PAR_RES] = dk_parallel_resistance(r, num);
+	 out[SENS_VAR_RES] = dk_var_resistance(out[SENS_PAR_RES], dual_const(fixed_in));
+	 out[SENS_BRANCH_I] = dk_branch_current(v, r);
+	 out[SENS_TOTAL_I] = dk_total_current(v, r, num);
+	 out[SENS_POWER] = dk_power_VI(v, out[SENS_TOTAL_I]);
+	 out[SENS_TEMP_RISE] = dk_temp_rise(v, dual_const(0), out[SENS_TOTAL_I], rtja, amb);
+	 out[SENS_OJT_DIFF] = dk_temp_diff_OJT_TR(out[SENS_TEMP_RISE], dual_const(ojt_in));
+	 out[SENS_LUX] = dk_ResToLux(r);
+	 out[SENS_PERCENT] = dk_ResToPercent(r);
+}
+
+void sens_chain(const struct C_design *d, struct sens_result *out) {
+	 sens_point(d->v, d->r, d->num, d->fixed_res, d->rtja, d->amb, d->ojt, out->out);
+}
+
+///===============================================
+/// Allocates room for cap rows. Returns 0 on success, -1 on failure.
+
+int sens_batch_alloc(struct sens_batch *s, size_t cap) {
+	 size_t bytes = ((cap * sizeof(float) + SENS_ALIGN - 1) / SENS_ALIGN) * SENS_ALIGN;
+	 char *block;
+	 int o, p;
+
+	 memset(s, 0, sizeof *s);
+	 if (bytes == 0) bytes = SENS_ALIGN;
+	 block = aligned_alloc(SENS_ALIGN, SENS_NCOLS * bytes);
+	 if (block == NULL) return -1;
+	 memset(block, 0, SENS_NCOLS * bytes);
+	 for (o = 0; o < SENS_NOUT; o++) {
+		 s->val[o] = (float *)block;
+		 block += bytes;
+		 for (p = 0; p < SENS_NPARAM; p++) {
+			 s->grad[o][p] = (float *)block;
+			 block += bytes;
+		 }
+	 }
+	 s->cap = cap;
+	 return 0;
+}
+
+/// All columns share one allocation, which starts at val[0].
+void sens_batch_free(struct sens_batch *s) {
+	 free(s->val[0]);
+	 memset(s, 0, sizeof *s);
+}
+
+///===============================================
+/// Rows [begin, end), a block at a time. The inputs are copied into a
+/// local block, the last row repeated to fill it, and the outputs
+/// computed into another; nothing else can alias those, and the trip
+/// count is fixed, so the row loop vectorizes with every dual step
+/// done lane-wise. Then the outputs are copied out column by column.
+
+CPU_KERNEL void sens_block(const float in[7][SENS_BLOCK], float blk[SENS_NCOLS][SENS_BLOCK]) {
+	 int l, o, p;
+	 for (l = 0; l < SENS_BLOCK; l++) {
+		 struct dual out[SENS_NOUT];
+		 sens_point(in[0][l], in[1][l], in[2][l], in[3][l], in[4][l], in[5][l], in[6][l], out);
+		 DUAL_UNROLL
+		 for (o = 0; o < SENS_NOUT; o++) {
+			 blk[o * (1 + SENS_NPARAM)][l] = out[o].val;
+			 DUAL_UNROLL
+			 for (p = 0; p < SENS_NPARAM; p++) blk[o * (1 + SENS_NPARAM) + 1 + p][l] = out[o].d[p];
+		 }
+	 }
+}
+
+CPU_KERNEL void sens_range_body(const struct C_batch *b, struct sens_batch *s, size_t begin, size_t end) {
+	 const float *cols[7] = { b->v, b->r, b->num, b->fixed_res, b->rtja, b->amb, b->ojt };
+	 float in[7][SENS_BLOCK] __attribute__((aligned(SENS_ALIGN)));
+	 float blk[SENS_NCOLS][SENS_BLOCK] __attribute__((aligned(SENS_ALIGN)));
+	 size_t i, n, l;
+	 int c, o, p;
+
+	 for (i = begin; i < end; i += SENS_BLOCK) {
+		 n = (end - i < SENS_BLOCK) ? end - i : SENS_BLOCK;
+		 for (c = 0; c < 7; c++) {
+			 memcpy(in[c], cols[c] + i, n * sizeof(float));
+			 for (l = n; l < SENS_BLOCK; l++) in[c][l] = in[c][n - 1];
+		 }
+		 sens_block(in, blk);
+		 DUAL_UNROLL
+		 for (o = 0; o < SENS_NOUT; o++) {
+			 memcpy(s->val[o] + i, blk[o * (1 + SENS_NPARAM)], n * sizeof(float));
+			 for (p = 0; p < SENS_NPARAM; p++)
+				 memcpy(s->grad[o][p] + i, blk[o * (1 + SENS_NPARAM) + 1 + p], n * sizeof(float));
+		 }
+	 }
+}
+
+CPU_CLONES(sens_range, (const struct C_batch *b, struct sens_batch *s, size_t begin, size_t end), (b, s, begin, end))
+
+/// Sensitivities of rows [begin, end) of b into the same rows of s, with
+/// the cpu.h variant in use. Disjoint ranges can run on different threads.
+void sens_batch_run_range(const struct C_batch *b, struct sens_batch *s, size_t begin, size_t end) {
+	 sens_range[cpu_isa()](b, s, begin, end);
+}
+
+/// All b->n rows. Returns -1 if s has too few.
+int sens_batch_run(const struct C_batch *b, struct sens_batch *s) {
+	 if (b->n > s->cap) return -1;
+	 sens_batch_run_range(b, s, 0, b->n);
+	 s->n = b->n;
+	 return 0;
+}
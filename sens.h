@@ -0,0 +1,213 @@
+// sens.h //
+#ifndef SENS_H
+#define SENS_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "kernel.h"
+#include "batch.h"
+
+/** Sensitivities by forward-mode automatic differentiation. Every
+	quantity in the chain is carried as a dual number, its value plus
+	its partial derivatives with respect to the SENS_PARAMS, and each
+	arithmetic step applies the chain rule as it goes. One pass gives
+	every output and its whole gradient, exactly to float rounding,
+	instead of 2 * SENS_NPARAM perturbed runs with their step-size
+	error.
+
+	The values are computed with the same float operations in the same
+	order as k_chain, so they match it bit for bit.
+
+	Where the model is not smooth the derivative is the one of the
+	branch the value was taken on: lux and percent have slope 0 below
+	DE_MIN_RES and where they clip at 0. The branch count is truncated
+	to a whole number like k_chain does, and its derivative is that of
+	the formulas with num treated as real. The temperature limit is
+	passed by the sign of ojt_diff: <= 0 is what k_chain calls exceeded.
+**/
+
+/// Parameter, name
+#define SENS_PARAMS(X) \
+	X(SENS_R,	"r") \
+	X(SENS_V,	"v") \
+	X(SENS_NUM,	"num") \
+	X(SENS_RTJA,	"rtja") \
+	X(SENS_AMB,	"amb")
+
+/// Output, name
+#define SENS_OUTPUTS(X) \
+	X(SENS_PAR_RES,		"par_res") \
+	X(SENS_VAR_RES,		"var_res") \
+	X(SENS_BRANCH_I,	"branch_i") \
+	X(SENS_TOTAL_I,		"total_i") \
+	X(SENS_POWER,		"power") \
+	X(SENS_TEMP_RISE,	"temp_rise") \
+	X(SENS_OJT_DIFF,	"ojt_diff") \
+	X(SENS_LUX,		"lux") \
+	X(SENS_PERCENT,		"percent")
+
+#define SENS_ID(id, name) id,
+enum sens_param {
+	SENS_PARAMS(SENS_ID)
+	SENS_NPARAM
+};
+enum sens_output {
+	SENS_OUTPUTS(SENS_ID)
+	SENS_NOUT
+};
+#undef SENS_ID
+
+///===============================================
+/// Dual numbers. d[p] is the derivative with respect to parameter p.
+
+/// The loops over d[] are short and fixed. Unrolled, a dual step is
+/// straight-line code and a loop over rows of duals vectorizes across
+/// the rows; -O2 does not unroll them by itself.
+#define DUAL_UNROLL 	_Pragma("GCC unroll 16")
+
+struct dual {
+    float 	val;
+    float 	d[SENS_NPARAM];
+};
+
+static inline struct dual dual_const(float x) {
+	 struct dual a = { x, { 0 } };
+	 return a;
+}
+
+/// Parameter p itself, at x
+static inline struct dual dual_var(float x, enum sens_param p) {
+	 struct dual a = dual_const(x);
+	 a.d[p] = 1;
+	 return a;
+}
+
+static inline struct dual dual_add(struct dual a, struct dual b) {
+	 struct dual c;
+	 int p;
+	 c.val = a.val + b.val;
+	 DUAL_UNROLL
+	 for (p = 0; p < SENS_NPARAM; p++) c.d[p] = a.d[p] + b.d[p];
+	 return c;
+}
+
+static inline struct dual dual_sub(struct dual a, struct dual b) {
+	 struct dual c;
+	 int p;
+	 c.val = a.val - b.val;
+	 DUAL_UNROLL
+	 for (p = 0; p < SENS_NPARAM; p++) c.d[p] = a.d[p] - b.d[p];
+	 return c;
+}
+
+/// (ab)' = a'b + ab'
+static inline struct dual dual_mul(struct dual a, struct dual b) {
+	 struct dual c;
+	 int p;
+	 c.val = a.val * b.val;
+	 DUAL_UNROLL
+	 for (p = 0; p < SENS_NPARAM; p++) c.d[p] = a.d[p] * b.val + a.val * b.d[p];
+	 return c;
+}
+
+/// (a/b)' = (a' - (a/b) b') / b
+static inline struct dual dual_div(struct dual a, struct dual b) {
+	 struct dual c;
+	 int p;
+	 c.val = a.val / b.val;
+	 DUAL_UNROLL
+	 for (p = 0; p < SENS_NPARAM; p++) c.d[p] = (a.d[p] - c.val * b.d[p]) / b.val;
+	 return c;
+}
+
+/// a times the constant k
+static inline struct dual dual_scale(struct dual a, float k) {
+	 struct dual c;
+	 int p;
+	 c.val = k * a.val;
+	 DUAL_UNROLL
+	 for (p = 0; p < SENS_NPARAM; p++) c.d[p] = k * a.d[p];
+	 return c;
+}
+
+///===============================================
+/// The circuit and thermal kernels of kernel.h on duals
+
+static inline struct dual dk_parallel_resistance(struct dual r, struct dual num) {
+	 return dual_div(dual_const(1), dual_mul(num, dual_div(dual_const(1), r)));
+}
+
+static inline struct dual dk_var_resistance(struct dual desired, struct dual fixed) {
+	 return dual_div(dual_mul(fixed, desired), dual_sub(fixed, desired));
+}
+
+static inline struct dual dk_branch_current(struct dual v, struct dual r) {
+	 return dual_div(v, r);
+}
+
+static inline struct dual dk_total_current(struct dual v, struct dual r, struct dual num) {
+	 return dual_mul(num, dual_div(v, r));
+}
+
+static inline struct dual dk_power_VI(struct dual v, struct dual i) {
+	 return dual_mul(v, i);
+}
+
+static inline struct dual dk_temp_rise(struct dual in, struct dual out, struct dual i, struct dual rtja, struct dual amb) {
+	 return dual_add(dual_mul(rtja, dual_mul(dual_sub(in, out), i)), amb);
+}
+
+static inline struct dual dk_temp_diff_OJT_TR(struct dual temp_rise, struct dual ojt) {
+	 return dual_sub(ojt, temp_rise);
+}
+
+/// max - r * slope, clipped at 0, r clamped at DE_MIN_RES: the k_ResToLux shape
+static inline struct dual dk_response(struct dual r, float max, float slope) {
+	 struct dual rc = (r.val >= DE_MIN_RES) ? r : dual_const(DE_MIN_RES);
+	 struct dual y = dual_sub(dual_const(max), dual_scale(rc, slope));
+	 return (y.val >= 0) ? y : dual_const(0);
+}
+
+static inline struct dual dk_ResToLux(struct dual r) {
+	 return dk_response(r, DE_MAX_LUX, DE_LUX_SLOPE);
+}
+
+static inline struct dual dk_ResToPercent(struct dual r) {
+	 return dk_response(r, DE_MAX_PERCENT, DE_PERCENT_SLOPE);
+}
+
+///===============================================
+
+/// Every output of one design with its gradient
+struct sens_result {
+    struct dual 	out[SENS_NOUT];
+};
+
+/** Outputs and gradients of a C_batch, structure of arrays like it:
+	val[o][i] is output o of row i, grad[o][p][i] its derivative with
+	respect to parameter p.
+**/
+struct sens_batch {
+    size_t 	n;
+    size_t 	cap;
+    float 	*val[SENS_NOUT];
+    float 	*grad[SENS_NOUT][SENS_NPARAM];
+};
+
+const char *sens_param_name(enum sens_param p);
+const char *sens_output_name(enum sens_output o);
+
+void sens_chain(const struct C_design *d, struct sens_result *out);
+
+int sens_batch_alloc(struct sens_batch *s, size_t cap);
+void sens_batch_free(struct sens_batch *s);
+void sens_batch_run_range(const struct C_batch *b, struct sens_batch *s, size_t begin, size_t end);
+int sens_batch_run(const struct C_batch *b, struct sens_batch *s);
+
+#endif
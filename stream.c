@@ -0,0 +1,421 @@
+///	Package:	intensity
+///	File:		stream.c
+///	Purpose:	Non-interactive streaming of C_test / I_test records
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * Clinger, "How to Read Floating Point Numbers Accurately", PLDI 1990
+ *	(the exact fast path for up to 15-19 digits and |exponent| <= 22)
+**/
+
+/** Memory is fixed for the whole stream: one input buffer, one output
+	buffer and one batch of STREAM_BATCH records, whatever the input
+	size. Text is parsed in place in the input buffer, so nothing is
+	allocated or copied per record; a line that straddles a refill is
+	moved to the front of the buffer first. C records of a batch go
+	through batch_run together, I records through k_intensity, and
+	the results come out in input order as each batch finishes.
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "batch.h"
+#include "stream.h"
+#include "prof.h"
+
+#define STREAM_LINE_OUT 	160	// longest text result line
+#define STREAM_MAX_DIGITS 	19	// significant digits that fit a uint64_t
+
+static const double stream_p10[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+struct stream_state {
+    const struct stream_config 	*cfg;
+    struct stream_stats 	*st;
+    FILE 			*out;
+    char 			*obuf;
+    size_t 			olen;
+    size_t 			osize;
+    int 			error;		// a write failed
+    /// the pending batch, in input order
+    uint8_t 			kind[STREAM_BATCH];
+    size_t 			n;
+    struct C_batch 		cb;
+    struct I_test 		ib[STREAM_BATCH];
+    size_t 			ni;
+};
+
+///===============================================
+/// 10^e for any e, exact for |e| <= 22.
+
+static double stream_pow10(int e) {
+	 if (e >= 0 && e <= 22) return stream_p10[e];
+	 if (e < 0 && e >= -22) return 1 / stream_p10[-e];
+	 return pow(10, e);
+}
+
+///===============================================
+/// Parses a decimal number at p, after any blanks or commas, without
+/// allocating or needing a terminator. Returns the end of the number,
+/// or NULL if there is none. Correctly rounded for up to 15 significant
+/// digits and exponents within +-22 (every number a person or printf
+/// %.9g writes), within an ulp or two otherwise.
+
+static const char *stream_number(const char *p, const char *end, double *out) {
+	 uint64_t m = 0;
+	 int digits = 0, e10 = 0, neg = 0, any = 0, ex = 0, eneg = 0;
+	 double d;
+
+	 while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+	 if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+	 for (; p < end && *p >= '0' && *p <= '9'; p++, any = 1) {
+		 if (digits < STREAM_MAX_DIGITS) {
+			 m = m * 10 + (uint64_t)(*p - '0');
+			 digits += (m != 0);
+		 } else {
+			 e10++;
+		 }
+	 }
+	 if (p < end && *p == '.') {
+		 for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = 1) {
+			 if (digits < STREAM_MAX_DIGITS) {
+				 m = m * 10 + (uint64_t)(*p - '0');
+				 digits += (m != 0);
+				 e10--;
+			 }
+		 }
+	 }
+	 if (!any) return NULL;
+	 if (p < end && (*p == 'e' || *p == 'E')) {
+		 const char *q = p + 1;
+		 if (q < end && (*q == '-' || *q == '+')) eneg = (*q++ == '-');
+		 if (q < end && *q >= '0' && *q <= '9') {
+			 for (; q < end && *q >= '0' && *q <= '9'; q++)
+				 if (ex < 100000) ex = ex * 10 + (*q - '0');
+			 e10 += eneg ? -ex : ex;
+			 p = q;
+		 }
+	 }
+
+	 d = (double)m;
+	 if (m == 0) d = 0;
+	 else if (m < (1ULL << 53) && e10 >= -22 && e10 <= 22) d = (e10 < 0) ? d / stream_p10[-e10] : d * stream_p10[e10];
+	 else if (e10 < -300) d = (d * 1e-300) * stream_pow10(e10 + 300);
+	 else d *= stream_pow10(e10);
+	 *out = neg ? -d : d;
+	 return p;
+}
+
+///===============================================
+/// Writes x to buf rounded to 9 significant digits, trailing zeros
+/// dropped, like printf %.9g. 9 digits read back as the same float for
+/// every float, though not always the shortest that would: 0.1f comes
+/// out 0.100000001. Plain notation for exponents -5 .. 8, otherwise
+/// d.ddde+XX. Returns the length; buf needs 16 bytes.
+
+static int stream_format_float(char *buf, float x) {
+	 char dig[10], *p = buf;
+	 double d = fabs((double)x);
+	 uint32_t q;
+	 int e, n, k;
+
+	 if (x != x) return (int)(memcpy(buf, "nan", 3), 3);
+	 if (x < 0 || (x == 0 && signbit(x))) *p++ = '-';
+	 if (d == 0) { *p++ = '0'; return (int)(p - buf); }
+	 if (isinf(d)) { memcpy(p, "inf", 3); return (int)(p + 3 - buf); }
+
+	 /// 9 digit integer q = d * 10^(8-e), with e the decimal exponent
+	 e = (int)floor(log10(d));
+	 q = (uint32_t)(d * stream_pow10(8 - e) + 0.5);
+	 if (q >= 1000000000u) q = (uint32_t)(d * stream_pow10(8 - ++e) + 0.5);
+	 if (q < 100000000u) q = (uint32_t)(d * stream_pow10(8 - --e) + 0.5);
+	 for (k = 8; k >= 0; k--, q /= 10) dig[k] = (char)('0' + q % 10);
+	 for (n = 9; n > 1 && dig[n - 1] == '0'; n--);
+
+	 if (e >= -5 && e <= 8) {
+		 if (e < 0) {
+			 *p++ = '0';
+			 *p++ = '.';
+			 for (k = -1; k > e; k--) *p++ = '0';
+			 for (k = 0; k < n; k++) *p++ = dig[k];
+		 } else {
+			 for (k = 0; k <= e; k++) *p++ = (k < n) ? dig[k] : '0';
+			 if (n > e + 1) {
+				 *p++ = '.';
+				 for (k = e + 1; k < n; k++) *p++ = dig[k];
+			 }
+		 }
+		 return (int)(p - buf);
+	 }
+	 *p++ = dig[0];
+	 if (n > 1) {
+		 *p++ = '.';
+		 for (k = 1; k < n; k++) *p++ = dig[k];
+	 }
+	 *p++ = 'e';
+	 *p++ = (e < 0) ? '-' : '+';
+	 e = abs(e);
+	 if (e >= 10) *p++ = (char)('0' + e / 10);
+	 else *p++ = '0';
+	 *p++ = (char)('0' + e % 10);
+	 return (int)(p - buf);
+}
+
+///===============================================
+/// Output buffer.
+
+static void stream_drain(struct stream_state *s) {
+	 PROF_BEGIN(prof_t);
+	 if (s->olen && fwrite(s->obuf, 1, s->olen, s->out) != s->olen) s->error = 1;
+	 PROF_END(PROF_STREAM_WRITE, prof_t, 0);
+	 s->olen = 0;
+}
+
+static char *stream_reserve(struct stream_state *s, size_t len) {
+	 if (s->osize - s->olen < len) stream_drain(s);
+	 return s->obuf + s->olen;
+}
+
+///===============================================
+/// Runs the pending batch and writes its results in input order.
+
+static void stream_flush(struct stream_state *s) {
+	 struct C_batch *b = &s->cb;
+	 size_t k, ic = 0, ii = 0;
+	 PROF_BEGIN(prof_t);
+
+	 batch_run(b);
+	 for (k = 0; k < s->n; k++) {
+		 if (s->kind[k] == STREAM_KIND_C) {
+			 float f[7] = { b->par_res[ic], b->branch_i[ic], b->total_i[ic], b->power[ic],
+				b->temp_rise[ic], b->lux[ic], b->percent[ic] };
+			 if (s->cfg->format == STREAM_BINARY) {
+				 struct stream_out o;
+				 memset(&o, 0, sizeof o);
+				 o.kind = STREAM_KIND_C;
+				 o.exceeded = b->exceeded[ic];
+				 memcpy(o.f, f, sizeof f);
+				 memcpy(stream_reserve(s, sizeof o), &o, sizeof o);
+				 s->olen += sizeof o;
+			 } else {
+				 char *p = stream_reserve(s, STREAM_LINE_OUT), *p0 = p;
+				 int j;
+				 *p++ = 'C';
+				 for (j = 0; j < 7; j++) {
+					 *p++ = ' ';
+					 p += stream_format_float(p, f[j]);
+					 if (j == 4) {
+						 *p++ = ' ';
+						 *p++ = b->exceeded[ic] ? '1' : '0';
+					 }
+				 }
+				 *p++ = '\n';
+				 s->olen += (size_t)(p - p0);
+			 }
+			 ic++;
+		 } else {
+			 const struct I_test *t = &s->ib[ii++];
+			 double in = k_intensity((int)t->c, t->ri, t->e0, t->Efield);
+			 if (s->cfg->format == STREAM_BINARY) {
+				 struct stream_out o;
+				 memset(&o, 0, sizeof o);
+				 o.kind = STREAM_KIND_I;
+				 o.intensity = in;
+				 memcpy(stream_reserve(s, sizeof o), &o, sizeof o);
+				 s->olen += sizeof o;
+			 } else {
+				 char *p = stream_reserve(s, STREAM_LINE_OUT);
+				 s->olen += (size_t)snprintf(p, STREAM_LINE_OUT, "I %.17g\n", in);
+			 }
+		 }
+	 }
+	 PROF_END(PROF_STREAM_BATCH, prof_t, s->n);
+	 s->n = 0;
+	 s->ni = 0;
+	 b->n = 0;
+}
+
+///===============================================
+/// Queues one record, running the batch when it is full.
+
+static void stream_push_c(struct stream_state *s, const struct C_test *t) {
+	 struct C_batch *b = &s->cb;
+	 size_t i = b->n++;
+	 b->v[i] = t->v;
+	 b->r[i] = t->r;
+	 b->num[i] = t->num;
+	 b->fixed_res[i] = 0;
+	 b->rtja[i] = s->cfg->rtja ? s->cfg->rtja : R_THETA_JA_TPS61169;
+	 b->amb[i] = s->cfg->amb ? s->cfg->amb : ROOM_TEMP1;
+	 b->ojt[i] = s->cfg->ojt ? s->cfg->ojt : MAX_OP_JUNCT_TEMP_TPS61169;
+	 s->kind[s->n++] = STREAM_KIND_C;
+	 s->st->c_records++;
+	 s->st->records++;
+	 if (s->n == STREAM_BATCH) stream_flush(s);
+}
+
+static void stream_push_i(struct stream_state *s, const struct I_test *t) {
+	 s->ib[s->ni++] = *t;
+	 s->kind[s->n++] = STREAM_KIND_I;
+	 s->st->i_records++;
+	 s->st->records++;
+	 if (s->n == STREAM_BATCH) stream_flush(s);
+}
+
+static void stream_bad(struct stream_state *s, size_t where) {
+	 if (s->st->bad++ == 0) s->st->first_bad = where;
+}
+
+///===============================================
+/// One text line, without its newline.
+
+static void stream_line(struct stream_state *s, const char *p, const char *end, size_t line) {
+	 double f[4];
+	 int kind, k;
+
+	 while (p < end && (*p == ' ' || *p == '\t')) p++;
+	 if (end > p && end[-1] == '\r') end--;
+	 if (p == end || *p == '#') return;
+	 kind = *p++ & ~0x20;			// either case
+	 if (kind != STREAM_KIND_C && kind != STREAM_KIND_I) {
+		 stream_bad(s, line);
+		 return;
+	 }
+	 for (k = 0; k < 4; k++) {
+		 p = stream_number(p, end, &f[k]);
+		 if (p == NULL) {
+			 stream_bad(s, line);
+			 return;
+		 }
+	 }
+	 while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+	 if (p < end && *p != '#') {
+		 stream_bad(s, line);
+		 return;
+	 }
+	 if (kind == STREAM_KIND_C) {
+		 struct C_test t = { (float)f[0], (float)f[1], (float)f[2], (float)f[3] };
+		 stream_push_c(s, &t);
+	 } else {
+		 struct I_test t = { (float)f[0], (float)f[1], (float)f[2], f[3] };
+		 stream_push_i(s, &t);
+	 }
+}
+
+static int stream_text(struct stream_state *s, FILE *in, char *buf, size_t size) {
+	 size_t have = 0, line = 0;
+	 int skipping = 0;
+
+	 for (;;) {
+		 PROF_BEGIN(prof_t);
+		 size_t got = fread(buf + have, 1, size - have, in);
+		 char *p = buf, *end = buf + have + got, *nl;
+		 PROF_END(PROF_STREAM_READ, prof_t, 0);
+		 if (got == 0 && ferror(in)) return -1;
+
+		 PROF_BEGIN(prof_parse);
+		 while ((nl = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+			 line++;
+			 if (!skipping) stream_line(s, p, nl, line);
+			 skipping = 0;
+			 p = nl + 1;
+		 }
+		 PROF_END(PROF_STREAM_PARSE, prof_parse, 0);
+		 if (got == 0) {
+			 /// End of input: a last line without a newline
+			 if (p < end && !skipping) stream_line(s, p, end, ++line);
+			 return 0;
+		 }
+		 have = (size_t)(end - p);
+		 if (have == size) {
+			 /// Longer than the buffer: drop it up to its newline
+			 if (!skipping) stream_bad(s, line + 1);
+			 skipping = 1;
+			 have = 0;
+		 } else if (have) {
+			 memmove(buf, p, have);
+		 }
+	 }
+}
+
+///===============================================
+/// Fixed-width binary records.
+
+static int stream_binary(struct stream_state *s, FILE *in, char *buf, size_t size) {
+	 size_t per = size / sizeof(struct stream_in), index = 0, have = 0;
+
+	 for (;;) {
+		 PROF_BEGIN(prof_t);
+		 size_t got = fread(buf + have, 1, per * sizeof(struct stream_in) - have, in), n, k;
+		 PROF_END(PROF_STREAM_READ, prof_t, 0);
+		 if (got == 0 && ferror(in)) return -1;
+		 have += got;
+		 n = have / sizeof(struct stream_in);
+		 for (k = 0; k < n; k++) {
+			 struct stream_in r;
+			 memcpy(&r, buf + k * sizeof r, sizeof r);
+			 index++;
+			 if (r.kind == STREAM_KIND_C) {
+				 struct C_test t = { r.f[0], r.f[1], r.f[2], r.f[3] };
+				 stream_push_c(s, &t);
+			 } else if (r.kind == STREAM_KIND_I) {
+				 struct I_test t = { r.f[0], r.f[1], r.f[2], r.efield };
+				 stream_push_i(s, &t);
+			 } else {
+				 stream_bad(s, index);
+			 }
+		 }
+		 have -= n * sizeof(struct stream_in);
+		 if (have) memmove(buf, buf + n * sizeof(struct stream_in), have);
+		 if (got == 0) {
+			 if (have) stream_bad(s, index + 1);	// truncated last record
+			 return 0;
+		 }
+	 }
+}
+
+///===============================================
+/// Reads records from in until end of file and writes one result per
+/// record to out. Returns 0, or -1 on allocation or I/O failure.
+
+int stream_run(FILE *in, FILE *out, const struct stream_config *cfg, struct stream_stats *st) {
+	 struct stream_state *s = calloc(1, sizeof *s);
+	 size_t size = (cfg->buf_size > 0) ? cfg->buf_size : STREAM_BUF;
+	 char *ibuf = NULL;
+	 int rc = -1;
+
+	 memset(st, 0, sizeof *st);
+	 if (size < 2 * sizeof(struct stream_out) + STREAM_LINE_OUT) size = 2 * sizeof(struct stream_out) + STREAM_LINE_OUT;
+	 if (s == NULL) return -1;
+	 s->cfg = cfg;
+	 s->st = st;
+	 s->out = out;
+	 s->osize = size;
+	 s->obuf = malloc(size);
+	 ibuf = malloc(size);
+	 if (s->obuf == NULL || ibuf == NULL || batch_alloc(&s->cb, STREAM_BATCH) != 0) goto done;
+
+	 rc = (cfg->format == STREAM_BINARY) ? stream_binary(s, in, ibuf, size) : stream_text(s, in, ibuf, size);
+	 stream_flush(s);
+	 stream_drain(s);
+	 if (fflush(out) != 0 || s->error) rc = -1;
+
+done:
+	 batch_free(&s->cb);
+	 free(ibuf);
+	 free(s->obuf);
+	 free(s);
+	 return rc;
+}
@@ -0,0 +1,79 @@
+// stream.h //
+#ifndef STREAM_H
+#define STREAM_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "kernel.h"
+
+#define STREAM_BATCH 		4096		// records processed together
+#define STREAM_BUF 		(1 << 20)	// input and output buffer bytes
+
+/** Record formats.
+	STREAM_TEXT	one record per line, fields separated by blanks or
+			commas; '#' starts a comment and blank lines are skipped:
+				C v i r num		a C_test
+				I c ri e0 Efield	an I_test
+			Results are written one line per record, in input order:
+				C par_res branch_i total_i power temp_rise exceeded lux percent
+				I intensity
+	STREAM_BINARY	struct stream_in records in, struct stream_out out,
+			raw structs in the host's byte order and layout, no
+			header; only for files written and read on one kind
+			of machine
+**/
+enum stream_format {
+    STREAM_TEXT = 0,
+    STREAM_BINARY
+};
+
+#define STREAM_KIND_C 	0x43	// 'C'
+#define STREAM_KIND_I 	0x49	// 'I'
+
+/// 32 bytes
+struct stream_in {
+    uint32_t 	kind;		// STREAM_KIND_C or STREAM_KIND_I
+    uint32_t 	reserved;
+    float 	f[4];		// C: v, i, r, num	I: c, ri, e0, unused
+    double 	efield;		// I only
+};
+
+/// 48 bytes
+struct stream_out {
+    uint32_t 	kind;
+    int32_t 	exceeded;	// C only
+    double 	intensity;	// I only
+    float 	f[7];		// C: par_res, branch_i, total_i, power, temp_rise, lux, percent
+    float 	reserved;
+};
+
+/** The C_test records carry no thermal data; every one is run through
+	the chain with these. 0 == R_THETA_JA_TPS61169, ROOM_TEMP1 and
+	MAX_OP_JUNCT_TEMP_TPS61169.
+**/
+struct stream_config {
+    enum stream_format 	format;
+    float 		rtja;
+    float 		amb;
+    float 		ojt;
+    size_t 		buf_size;	// 0 == STREAM_BUF, text lines must fit
+};
+
+struct stream_stats {
+    size_t 	records;
+    size_t 	c_records;
+    size_t 	i_records;
+    size_t 	bad;		// unparsable lines or unknown kinds, skipped
+    size_t 	first_bad;	// line (text) or record (binary) number, 1 based
+};
+
+int stream_run(FILE *in, FILE *out, const struct stream_config *cfg, struct stream_stats *st);
+
+#endif
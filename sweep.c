@@ -0,0 +1,308 @@
+///	Package:	circuit
+///	File:		sweep.c
+///	Purpose:	Multi-threaded design-space sweeps of the LED circuit chain
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "kernel.h"
+#include "batch.h"
+#include "pool.h"
+#include "memo.h"
+#include "colfile.h"
+#include "sweep.h"
+#include "prof.h"
+
+struct sweep_job {
+    const struct sweep_grid 	*g;
+    const struct sweep_config 	*cfg;
+    size_t 			npoints;
+    size_t 			chunk;
+    struct C_batch 		*scratch;	// one per worker
+    struct C_batch 		*miss;		// one per worker, memo misses
+    size_t 			*miss_idx;	// chunk per worker
+    const struct memo_slot 	**hit;		// chunk per worker, memo hits
+    struct sweep_stats 		*chunks;	// one per chunk, merged in order
+    _Atomic int 		failed;
+};
+
+///===============================================
+/// Total number of design points in the grid.
+
+size_t sweep_points(const struct sweep_grid *g) {
+	 return g->r.count * g->num.count * g->v.count * g->amb.count * g->fixed_res.count;
+}
+
+///===============================================
+/// Decodes point index into its design.
+
+void sweep_point(const struct sweep_grid *g, size_t index, struct C_design *d) {
+	 d->r = g->r.values[index % g->r.count];		index /= g->r.count;
+	 d->num = g->num.values[index % g->num.count];		index /= g->num.count;
+	 d->v = g->v.values[index % g->v.count];		index /= g->v.count;
+	 d->amb = g->amb.values[index % g->amb.count];		index /= g->amb.count;
+	 d->fixed_res = g->fixed_res.values[index];
+	 d->rtja = g->rtja;
+	 d->ojt = g->ojt;
+}
+
+///===============================================
+/// Pareto dominance on (lux, margin), both maximized. Equal points are
+/// broken by index, so the relation is a strict order and the front is
+/// unique whatever the chunking.
+
+static int sweep_beats(const struct sweep_pareto *a, const struct sweep_pareto *b) {
+	 if (a->lux < b->lux || a->margin < b->margin) return 0;
+	 return (a->lux > b->lux || a->margin > b->margin || a->index < b->index);
+}
+
+/// Adds p to the front in s unless something already beats it.
+/// The front is kept as a staircase: lux strictly falling, margin
+/// strictly rising. Only the last point with lux >= p.lux can beat p,
+/// and the points p beats form one run right after it.
+/// Returns -1 if memory runs out.
+
+static int sweep_pareto_add(struct sweep_stats *s, size_t *cap, const struct sweep_pareto *p) {
+	 struct sweep_pareto *f = s->pareto;
+	 size_t lo = 0, hi = s->npareto, end;
+
+	 while (lo < hi) {			// lo = number of points with lux > p.lux
+		 size_t mid = lo + (hi - lo) / 2;
+		 if (f[mid].lux > p->lux) lo = mid + 1;
+		 else hi = mid;
+	 }
+	 if (lo > 0 && sweep_beats(&f[lo - 1], p)) return 0;
+	 if (lo < s->npareto && f[lo].lux == p->lux && sweep_beats(&f[lo], p)) return 0;
+
+	 for (end = lo; end < s->npareto && f[end].margin <= p->margin; end++) ;
+	 if (end == lo && s->npareto == *cap) {
+		 size_t ncap = (*cap > 0) ? 2 * *cap : 16;
+		 struct sweep_pareto *np = realloc(s->pareto, ncap * sizeof *np);
+		 if (np == NULL) return -1;
+		 s->pareto = f = np;
+		 *cap = ncap;
+	 }
+	 if (end != lo + 1) {
+		 memmove(&f[lo + 1], &f[end], (s->npareto - end) * sizeof *f);
+		 s->npareto = s->npareto + 1 - (end - lo);
+	 }
+	 f[lo] = *p;
+	 return 0;
+}
+
+static void sweep_stats_init(struct sweep_stats *s) {
+	 memset(s, 0, sizeof *s);
+	 s->min_margin = INFINITY;
+	 s->max_margin = -INFINITY;
+}
+
+///===============================================
+/// Evaluates b's n points through the memo. What it has stays in the
+/// map: row k's slot is returned in hit[k] and read from there. The
+/// rest, with hit[k] NULL, are gathered into the worker's second batch,
+/// run, remembered and scattered back into b.
+
+static const struct memo_slot **sweep_memo_run(struct sweep_job *job, struct C_batch *b, size_t n, int worker,
+	struct sweep_stats *s) {
+	 struct memo *memo = job->cfg->memo;
+	 struct C_batch *mb = &job->miss[worker];
+	 const struct memo_slot **hit = job->hit + (size_t)worker * job->chunk;
+	 size_t *idx = job->miss_idx + (size_t)worker * job->chunk;
+	 size_t nmiss = memo_fetch(memo, b, n, job->cfg->prec, hit, idx), k;
+
+	 for (k = 0; k < nmiss; k++) batch_copy(mb, k, b, idx[k]);
+	 mb->n = nmiss;
+	 prec_run_range(mb, 0, nmiss, job->cfg->prec, NULL);
+	 memo_store(memo, mb, nmiss, job->cfg->prec);
+	 for (k = 0; k < nmiss; k++) batch_copy(b, idx[k], mb, k);
+	 s->memo_hits = n - nmiss;
+	 return hit;
+}
+
+///===============================================
+/// Runs one chunk: fill the worker's batch by walking the grid like an
+/// odometer, evaluate it, then reduce into this chunk's own stats. With
+/// a column file the batch is a block of it, so the points and their
+/// results are written where they are computed. Memo hits are reduced
+/// from the map and only copied into the batch for a hook or a file,
+/// which want whole rows.
+
+static void sweep_chunk(void *ctx, size_t chunk, int worker) {
+	 struct sweep_job *job = ctx;
+	 const struct sweep_grid *g = job->g;
+	 struct cf_writer *out = job->cfg->out;
+	 struct C_batch *b = &job->scratch[worker], view;
+	 struct sweep_stats *s = &job->chunks[chunk];
+	 const struct memo_slot **hit = NULL;
+	 size_t first = chunk * job->chunk;
+	 size_t n = job->npoints - first, cap = 0, k, blk = 0;
+	 size_t ir, inum, iv, iamb, ifix, rest;
+	 PROF_BEGIN(prof_t);
+
+	 if (n > job->chunk) n = job->chunk;
+	 if (out != NULL) {
+		 if (cf_reserve(out, &blk) == 0 && cf_batch_view(out, blk, &view) == 0) {
+			 b = &view;
+		 } else {
+			 out = NULL;
+			 job->failed = 1;
+		 }
+	 }
+	 sweep_stats_init(s);
+	 rest = first;
+	 ir = rest % g->r.count;		rest /= g->r.count;
+	 inum = rest % g->num.count;		rest /= g->num.count;
+	 iv = rest % g->v.count;		rest /= g->v.count;
+	 iamb = rest % g->amb.count;		rest /= g->amb.count;
+	 ifix = rest;
+
+	 for (k = 0; k < n; k++) {
+		 b->r[k] = g->r.values[ir];
+		 b->num[k] = g->num.values[inum];
+		 b->v[k] = g->v.values[iv];
+		 b->amb[k] = g->amb.values[iamb];
+		 b->fixed_res[k] = g->fixed_res.values[ifix];
+		 b->rtja[k] = g->rtja;
+		 b->ojt[k] = g->ojt;
+		 if (++ir < g->r.count) continue;
+		 ir = 0;
+		 if (++inum < g->num.count) continue;
+		 inum = 0;
+		 if (++iv < g->v.count) continue;
+		 iv = 0;
+		 if (++iamb < g->amb.count) continue;
+		 iamb = 0;
+		 ifix++;
+	 }
+	 b->n = n;
+	 if (job->miss != NULL) hit = sweep_memo_run(job, b, n, worker, s);
+	 else prec_run_range(b, 0, n, job->cfg->prec, &s->prec);
+
+	 s->points = n;
+	 for (k = 0; k < n; k++) {
+		 const struct memo_slot *h = (hit != NULL) ? hit[k] : NULL;
+		 float m = (h != NULL) ? h->out[PREC_OJT_DIFF] : b->ojt_diff[k];
+		 float lux = (h != NULL) ? h->out[PREC_LUX] : b->lux[k];
+		 s->fail += (h != NULL) ? h->exceeded : b->exceeded[k];
+		 if (m < s->min_margin) { s->min_margin = m; s->min_index = first + k; }
+		 if (m > s->max_margin) { s->max_margin = m; s->max_index = first + k; }
+		 struct sweep_pareto p = { first + k, lux, m };
+		 if (sweep_pareto_add(s, &cap, &p) != 0) job->failed = 1;
+	 }
+	 s->pass = n - s->fail;
+	 if (hit != NULL && (job->cfg->hook != NULL || out != NULL)) {
+		 for (k = 0; k < n; k++) if (hit[k] != NULL) memo_get(hit[k], b, k);
+	 }
+	 PROF_END(PROF_SWEEP_CHUNK, prof_t, n);
+	 if (job->cfg->hook != NULL) job->cfg->hook(job->cfg->hook_ctx, chunk, first, b);
+	 if (out != NULL) cf_commit(out, blk, first, n);
+}
+
+///===============================================
+
+static int sweep_pareto_cmp(const void *a, const void *b) {
+	 size_t ia = ((const struct sweep_pareto *)a)->index, ib = ((const struct sweep_pareto *)b)->index;
+	 return (ia > ib) - (ia < ib);
+}
+
+/// Folds the per-chunk stats together in chunk order, so the answer
+/// does not depend on which thread ran which chunk.
+
+static int sweep_merge(struct sweep_job *job, size_t nchunks, struct sweep_stats *out) {
+	 size_t c, k, cap = 0;
+	 int rc = 0;
+	 PROF_BEGIN(prof_t);
+
+	 sweep_stats_init(out);
+	 for (c = 0; c < nchunks; c++) {
+		 struct sweep_stats *s = &job->chunks[c];
+		 out->points += s->points;
+		 out->pass += s->pass;
+		 out->fail += s->fail;
+		 out->memo_hits += s->memo_hits;
+		 if (s->min_margin < out->min_margin) { out->min_margin = s->min_margin; out->min_index = s->min_index; }
+		 if (s->max_margin > out->max_margin) { out->max_margin = s->max_margin; out->max_index = s->max_index; }
+		 for (k = 0; k < s->npareto && rc == 0; k++) rc = sweep_pareto_add(out, &cap, &s->pareto[k]);
+		 for (k = 0; k < PREC_NOUT; k++) s->prec.worst[k] += c * job->chunk;
+		 prec_report_merge(&out->prec, &s->prec);
+		 free(s->pareto);
+	 }
+	 qsort(out->pareto, out->npareto, sizeof *out->pareto, sweep_pareto_cmp);
+	 PROF_END(PROF_SWEEP_MERGE, prof_t, out->points);
+	 return rc;
+}
+
+///===============================================
+/// Sweeps the whole grid. cfg may be NULL for all cores, default chunks
+/// and no hook. With cfg->memo, points it holds are read in place from
+/// the map rather than computed, and new ones are added to it;
+/// PREC_VALIDATE ignores it.
+/// With cfg->out every chunk goes to the column file as one block, row
+/// k of it grid point first + k; the file must have been made by
+/// cf_create_batch with blocks of at least the chunk size.
+/// Returns 0 on success, -1 on allocation or output failure.
+
+int sweep_run(const struct sweep_grid *g, const struct sweep_config *cfg, struct sweep_stats *out) {
+	 struct sweep_config defaults = { 0, 0, NULL, NULL };
+	 struct sweep_job job;
+	 size_t nchunks;
+	 int nthreads, k, rc = 0;
+
+	 if (cfg == NULL) cfg = &defaults;
+	 memset(&job, 0, sizeof job);
+	 job.g = g;
+	 job.cfg = cfg;
+	 job.npoints = sweep_points(g);
+	 job.chunk = (cfg->chunk > 0) ? cfg->chunk : SWEEP_CHUNK;
+	 nchunks = (job.npoints + job.chunk - 1) / job.chunk;
+	 sweep_stats_init(out);
+	 if (nchunks == 0) return 0;
+	 if (cfg->out != NULL) {
+		 struct C_batch probe;
+		 if (cfg->out->hdr->block_rows < job.chunk || cf_batch_view(cfg->out, 0, &probe) != 0) return -1;
+	 }
+
+	 nthreads = pool_threads(cfg->nthreads, nchunks);
+	 job.scratch = calloc(nthreads, sizeof *job.scratch);
+	 job.chunks = calloc(nchunks, sizeof *job.chunks);
+	 if (job.scratch == NULL || job.chunks == NULL) rc = -1;
+	 for (k = 0; k < nthreads && rc == 0; k++) rc = batch_alloc(&job.scratch[k], job.chunk);
+	 if (rc == 0 && cfg->memo != NULL && cfg->prec != PREC_VALIDATE) {
+		 job.miss = calloc(nthreads, sizeof *job.miss);
+		 job.miss_idx = malloc((size_t)nthreads * job.chunk * sizeof *job.miss_idx);
+		 job.hit = malloc((size_t)nthreads * job.chunk * sizeof *job.hit);
+		 if (job.miss == NULL || job.miss_idx == NULL || job.hit == NULL) rc = -1;
+		 for (k = 0; k < nthreads && rc == 0; k++) rc = batch_alloc(&job.miss[k], job.chunk);
+	 }
+
+	 if (rc == 0) rc = pool_run(nthreads, nchunks, sweep_chunk, &job);
+	 if (rc == 0) rc = sweep_merge(&job, nchunks, out);
+	 if (rc == 0 && job.failed) rc = -1;
+
+	 for (k = 0; job.scratch != NULL && k < nthreads; k++) batch_free(&job.scratch[k]);
+	 for (k = 0; job.miss != NULL && k < nthreads; k++) batch_free(&job.miss[k]);
+	 free(job.scratch);
+	 free(job.miss);
+	 free(job.miss_idx);
+	 free(job.hit);
+	 free(job.chunks);
+	 return rc;
+}
+
+///===============================================
+
+void sweep_stats_free(struct sweep_stats *s) {
+	 free(s->pareto);
+	 s->pareto = NULL;
+	 s->npareto = 0;
+}
@@ -0,0 +1,85 @@
+// sweep.h //
+#ifndef SWEEP_H
+#define SWEEP_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include "kernel.h"
+#include "batch.h"
+#include "precision.h"
+#include "memo.h"
+#include "colfile.h"
+
+#define SWEEP_CHUNK 	4096	// default design points per chunk
+
+/// One grid axis: count explicit values
+struct sweep_axis {
+    const float 	*values;
+    size_t 		count;
+};
+
+/** The design space. Point index i walks r fastest, then num, v,
+	amb and fixed_res, so i = r + nr*(num + nnum*(v + nv*(amb + namb*fixed))).
+	rtja and ojt are the same for every point.
+**/
+struct sweep_grid {
+    struct sweep_axis 	r;		// resistor values
+    struct sweep_axis 	num;		// branch counts
+    struct sweep_axis 	v;		// feedback voltages
+    struct sweep_axis 	amb;		// ambient temperatures
+    struct sweep_axis 	fixed_res;	// fixed trim resistors
+    float 		rtja;
+    float 		ojt;
+};
+
+/// A point on the lux / OJT margin Pareto front
+struct sweep_pareto {
+    size_t 	index;
+    float 	lux;
+    float 	margin;
+};
+
+/** Reduced sweep results. pass counts points below the temperature limit
+	and fail counts points where junct_temp_exceeded would report 1. The
+	Pareto front holds the points that no other point beats on both lux
+	and OJT margin, in point order. Ties go to the lowest index.
+**/
+struct sweep_stats {
+    size_t 		points;
+    size_t 		pass;
+    size_t 		fail;
+    float 		min_margin;
+    size_t 		min_index;
+    float 		max_margin;
+    size_t 		max_index;
+    struct sweep_pareto *pareto;
+    size_t 		npareto;
+    struct prec_report 	prec;		// filled in by PREC_VALIDATE
+    size_t 		memo_hits;	// points read from the memo
+};
+
+/// Called from worker threads once per chunk, after its batch has run.
+/// Point first + k of the grid is row k of b.
+typedef void (*sweep_chunk_fn)(void *ctx, size_t chunk, size_t first, const struct C_batch *b);
+
+struct sweep_config {
+    int 		nthreads;	// 0 == all cores
+    size_t 		chunk;		// points per chunk, 0 == SWEEP_CHUNK
+    sweep_chunk_fn 	hook;		// optional per-chunk callback
+    void 		*hook_ctx;
+    enum prec_mode 	prec;		// 0 == PREC_FLOAT
+    struct memo 	*memo;		// optional result memo, see memo.h
+    struct cf_writer 	*out;		// optional column file, see colfile.h
+};
+
+size_t sweep_points(const struct sweep_grid *g);
+void sweep_point(const struct sweep_grid *g, size_t index, struct C_design *d);
+int sweep_run(const struct sweep_grid *g, const struct sweep_config *cfg, struct sweep_stats *out);
+void sweep_stats_free(struct sweep_stats *s);
+
+#endif
@@ -0,0 +1,46 @@
+// testgrid.h //
+#ifndef TESTGRID_H
+#define TESTGRID_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** Fixtures shared by the .check files that sweep a grid and write
+	what it gives to a file. Include after check.h and sweep.h.
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static float tg_res[300], tg_num[] = { 1, 7, 19 }, tg_volts[] = { 0.20, 0 };
+static float tg_amb[] = { ROOM_TEMP1, ROOM_TEMP3 }, tg_fixed[] = { 3.3, 4.7 };
+
+/// A grid of nr <= 300 resistances, r starting at 1 in steps of 0.5,
+/// and supplies of 0.20 and v_hi volts
+static void tg_grid(struct sweep_grid *g, size_t nr, float v_hi) {
+	 size_t i;
+	 for (i = 0; i < nr; i++) tg_res[i] = 1.0 + 0.5 * i;
+	 tg_volts[1] = v_hi;
+	 g->r.values = tg_res;		g->r.count = nr;
+	 g->num.values = tg_num;		g->num.count = 3;
+	 g->v.values = tg_volts;		g->v.count = 2;
+	 g->amb.values = tg_amb;		g->amb.count = 2;
+	 g->fixed_res.values = tg_fixed;	g->fixed_res.count = 2;
+	 g->rtja = R_THETA_JA_TPS61169;
+	 g->ojt = MAX_TEMP_TPS61169;
+}
+
+/// A fresh file under /tmp named after the test; path holds 64 bytes
+static void tg_path(char *path, const char *test) {
+	 int fd;
+	 snprintf(path, 64, "/tmp/%s.XXXXXX", test);
+	 fd = mkstemp(path);
+	 ck_assert(fd >= 0);
+	 close(fd);
+}
+
+#endif
@@ -0,0 +1,306 @@
+///	Package:	circuit
+///	File:		thermal.c
+///	Purpose:	Transient junction temperature from Foster/Cauer RC networks
+///	Author:		jrom876
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** References:
+ * TI SPRA953, "Semiconductor and IC Package Thermal Metrics"
+ * JEDEC JESD51-14, transient dual interface test method
+ * https://en.wikipedia.org/wiki/Tridiagonal_matrix_algorithm
+**/
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "pool.h"
+#include "thermal.h"
+#include "cpu.h"
+#include "prof.h"
+
+/** Per-step update, the same for every design of a run.
+	Foster: each stage is exact for power held over the step,
+		theta_i' = a_i theta_i + b_i P,  a_i = e^-dt/tau_i, b_i = (1 - a_i) R_i
+	Cauer: backward Euler, (C/dt + G) theta' = (C/dt) theta + P e_0,
+		with the tridiagonal matrix factored once (Thomas algorithm).
+**/
+struct thermal_step {
+    float 	a[THERMAL_MAX_STAGES];		// Foster decay / Cauer C_i/dt
+    float 	b[THERMAL_MAX_STAGES];		// Foster input gain
+    float 	lower[THERMAL_MAX_STAGES];	// Cauer sub-diagonal
+    float 	upper[THERMAL_MAX_STAGES];	// Cauer eliminated super-diagonal
+    float 	inv_piv[THERMAL_MAX_STAGES];	// Cauer 1 / pivot
+};
+
+/// One chunk of designs, a column per quantity, worker scratch
+struct thermal_lanes {
+    float 	on[THERMAL_CHUNK];		// PWM on time, seconds
+    float 	period[THERMAL_CHUNK];
+    float 	p_on[THERMAL_CHUNK];
+    float 	p_off[THERMAL_CHUNK];
+    float 	surge[THERMAL_CHUNK];
+    float 	surge_time[THERMAL_CHUNK];
+    float 	amb[THERMAL_CHUNK];
+    float 	phase[THERMAL_CHUNK];		// step midpoint, into the PWM period
+    float 	p[THERMAL_CHUNK];		// power over the step
+    float 	rise[THERMAL_CHUNK];		// junction above ambient
+    float 	tj[THERMAL_CHUNK];
+    float 	peak[THERMAL_CHUNK];
+    float 	t_peak[THERMAL_CHUNK];
+    float 	above[THERMAL_CHUNK];		// steps at or above the limit
+    float 	th[THERMAL_MAX_STAGES][THERMAL_CHUNK];	// network state
+};
+
+struct thermal_job {
+    const struct thermal_net 	*net;
+    const struct thermal_load 	*loads;
+    size_t 			n;
+    const struct thermal_config *cfg;
+    struct thermal_result 	*out;
+    struct thermal_step 	step;
+    size_t 			nsteps;
+    float 			limit;
+    struct thermal_lanes 	*scratch;	// one per worker
+};
+
+///===============================================
+/// TPS61169 junction to ambient, as a four stage Foster fit: die,
+/// package, board copper and board to air, adding up to the datasheet
+/// R_THETA_JA_TPS61169. TI does not publish Zth(t) for this part, so the
+/// split and time constants are estimates for the SOT-23 package on a
+/// JEDEC board. Replace them with a measured fit when one is available.
+
+void thermal_tps61169(struct thermal_net *net) {
+	 static const float r[4] = { 4.0f, 28.0f, 92.0f, R_THETA_JA_TPS61169 - 124.0f };
+	 static const float tau[4] = { 2.0e-4f, 1.0e-2f, 1.5f, 40.0f };
+	 int i;
+	 memset(net, 0, sizeof *net);
+	 net->kind = THERMAL_FOSTER;
+	 net->n = 4;
+	 for (i = 0; i < 4; i++) {
+		 net->r[i] = r[i];
+		 net->c[i] = tau[i] / r[i];
+	 }
+}
+
+///===============================================
+/// Junction to ambient resistance of the network.
+
+float thermal_rth(const struct thermal_net *net) {
+	 float sum = 0;
+	 int i;
+	 for (i = 0; i < net->n; i++) sum += net->r[i];
+	 return sum;
+}
+
+///===============================================
+/// Load of a design: the power calc_temp_rise works from (v * total
+/// current, see k_chain) while the PWM is on, nothing while it is off,
+/// and surge_factor times that extra during turn-on.
+
+void thermal_load_from_design(const struct C_design *d, float period, float duty,
+	float surge_factor, float surge_time, struct thermal_load *out) {
+	 struct C_result res;
+	 k_chain(d, &res);
+	 out->p_on = k_pow_diss(d->v, 0, res.total_i);
+	 out->p_off = 0;
+	 out->period = period;
+	 out->duty = duty;
+	 out->surge = surge_factor * out->p_on;
+	 out->surge_time = surge_time;
+	 out->amb = d->amb;
+}
+
+///===============================================
+/// Steady-state average junction temperature: ambient plus R Theta JA
+/// times the average power. With duty 1 this is calc_temp_rise.
+
+float thermal_steady(const struct thermal_net *net, const struct thermal_load *load) {
+	 float duty = (load->period > 0) ? load->duty : 1;
+	 return load->amb + thermal_rth(net) * (duty * load->p_on + (1 - duty) * load->p_off);
+}
+
+///===============================================
+/// Step coefficients for dt. Returns 0, or -1 for a bad network.
+
+static int thermal_prepare(const struct thermal_net *net, float dt, struct thermal_step *s) {
+	 double piv = 0;
+	 int i, n = net->n;
+
+	 memset(s, 0, sizeof *s);
+	 if (n < 1 || n > THERMAL_MAX_STAGES || !(dt > 0)) return -1;
+	 for (i = 0; i < n; i++) if (!(net->r[i] > 0) || !(net->c[i] > 0)) return -1;
+
+	 if (net->kind == THERMAL_FOSTER) {
+		 for (i = 0; i < n; i++) {
+			 double a = exp(-dt / ((double)net->r[i] * net->c[i]));
+			 s->a[i] = (float)a;
+			 s->b[i] = (float)((1 - a) * net->r[i]);
+		 }
+		 return 0;
+	 }
+	 /// Cauer: row i is -G_{i-1} x_{i-1} + (C_i/dt + G_{i-1} + G_i) x_i - G_i x_{i+1}
+	 for (i = 0; i < n; i++) {
+		 double g_prev = (i > 0) ? 1.0 / net->r[i - 1] : 0, g = 1.0 / net->r[i];
+		 double diag = net->c[i] / dt + g_prev + g, low = -g_prev;
+		 double up = (i < n - 1) ? -g : 0;
+		 piv = diag - ((i > 0) ? low * s->upper[i - 1] : 0);
+		 s->a[i] = (float)(net->c[i] / dt);
+		 s->lower[i] = (float)low;
+		 s->inv_piv[i] = (float)(1 / piv);
+		 s->upper[i] = (float)(up / piv);
+	 }
+	 return 0;
+}
+
+///===============================================
+/// Per-step kernels over one chunk. Each loop runs all THERMAL_CHUNK
+/// lanes, the unused ones idle at zero power, so the trip counts are
+/// fixed and the loops vectorize. They are inlined into thermal_steps,
+/// once per CPU variant.
+
+/// Power over the step, sampled at its midpoint t_mid, and the PWM phase advanced
+CPU_KERNEL void thermal_power(struct thermal_lanes *restrict w, float t_mid, float dt) {
+	 int l;
+	 for (l = 0; l < THERMAL_CHUNK; l++) {
+		 float ph = w->phase[l], hi = w->p_on[l], lo = w->p_off[l], extra = w->surge[l];
+		 w->p[l] = ((ph < w->on[l]) ? hi : lo) + ((t_mid < w->surge_time[l]) ? extra : 0.0f);
+		 ph += dt;
+		 w->phase[l] = (ph >= w->period[l]) ? ph - w->period[l] : ph;
+	 }
+}
+
+/// Foster: the stage rises add up
+CPU_KERNEL void thermal_foster(const struct thermal_step *st, int n, struct thermal_lanes *restrict w) {
+	 int i, l;
+	 for (l = 0; l < THERMAL_CHUNK; l++) w->rise[l] = 0;
+	 for (i = 0; i < n; i++) {
+		 float a = st->a[i], b = st->b[i];
+		 for (l = 0; l < THERMAL_CHUNK; l++) {
+			 w->th[i][l] = a * w->th[i][l] + b * w->p[l];
+			 w->rise[l] += w->th[i][l];
+		 }
+	 }
+}
+
+/// Cauer: forward elimination then back substitution in place, the
+/// junction is node 0
+CPU_KERNEL void thermal_cauer(const struct thermal_step *st, int n, struct thermal_lanes *restrict w) {
+	 int i, l;
+	 for (l = 0; l < THERMAL_CHUNK; l++)
+		 w->th[0][l] = (st->a[0] * w->th[0][l] + w->p[l]) * st->inv_piv[0];
+	 for (i = 1; i < n; i++) {
+		 float cdt = st->a[i], low = st->lower[i], ip = st->inv_piv[i];
+		 for (l = 0; l < THERMAL_CHUNK; l++)
+			 w->th[i][l] = (cdt * w->th[i][l] - low * w->th[i - 1][l]) * ip;
+	 }
+	 for (i = n - 2; i >= 0; i--) {
+		 float up = st->upper[i];
+		 for (l = 0; l < THERMAL_CHUNK; l++) w->th[i][l] -= up * w->th[i + 1][l];
+	 }
+	 for (l = 0; l < THERMAL_CHUNK; l++) w->rise[l] = w->th[0][l];
+}
+
+/// Streamed statistics for the temperatures at the end of a step
+CPU_KERNEL void thermal_track(struct thermal_lanes *restrict w, float t_end, float limit) {
+	 int l;
+	 for (l = 0; l < THERMAL_CHUNK; l++) {
+		 float t = w->amb[l] + w->rise[l], pk = w->peak[l], tp = w->t_peak[l], n = w->above[l];
+		 float hi = (t > pk) ? t : pk, over = (t >= limit) ? 1.0f : 0.0f;
+		 w->tj[l] = t;
+		 w->peak[l] = hi;
+		 w->t_peak[l] = (hi != pk) ? t_end : tp;	// a select on hi, so it if-converts
+		 w->above[l] = n + over;
+	 }
+}
+
+/// Every step of a run for one chunk
+CPU_KERNEL void thermal_steps_body(const struct thermal_job *job, struct thermal_lanes *restrict w) {
+	 float dt = job->cfg->dt;
+	 size_t k;
+	 for (k = 0; k < job->nsteps; k++) {
+		 thermal_power(w, ((float)k + 0.5f) * dt, dt);
+		 if (job->net->kind == THERMAL_CAUER) thermal_cauer(&job->step, job->net->n, w);
+		 else thermal_foster(&job->step, job->net->n, w);
+		 thermal_track(w, (float)(k + 1) * dt, job->limit);
+	 }
+}
+
+CPU_CLONES(thermal_steps, (const struct thermal_job *job, struct thermal_lanes *restrict w), (job, w))
+
+///===============================================
+/// One task: designs [chunk*THERMAL_CHUNK, ...) through every step.
+
+static void thermal_chunk(void *ctx, size_t chunk, int worker) {
+	 struct thermal_job *job = ctx;
+	 struct thermal_lanes *w = &job->scratch[worker];
+	 size_t d0 = chunk * THERMAL_CHUNK, m = job->n - d0;
+	 float dt = job->cfg->dt;
+	 int l;
+	 PROF_BEGIN(prof_t);
+
+	 if (m > THERMAL_CHUNK) m = THERMAL_CHUNK;
+	 memset(w, 0, sizeof *w);
+	 for (l = 0; l < (int)m; l++) {
+		 const struct thermal_load *ld = &job->loads[d0 + l];
+		 int pwm = (ld->period > 0);
+		 w->period[l] = pwm ? ld->period : 0;
+		 w->on[l] = pwm ? ld->duty * ld->period : HUGE_VALF;
+		 w->phase[l] = pwm ? fmodf(0.5f * dt, ld->period) : 0;
+		 w->p_on[l] = ld->p_on;
+		 w->p_off[l] = ld->p_off;
+		 w->surge[l] = ld->surge;
+		 w->surge_time[l] = ld->surge_time;
+		 w->amb[l] = ld->amb;
+		 w->peak[l] = ld->amb;
+	 }
+
+	 thermal_steps[cpu_isa()](job, w);
+
+	 for (l = 0; l < (int)m; l++) {
+		 struct thermal_result *r = &job->out[d0 + l];
+		 r->peak = w->peak[l];
+		 r->t_peak = w->t_peak[l];
+		 r->time_above = w->above[l] * dt;
+		 r->final = w->tj[l];
+	 }
+	 PROF_END(PROF_THERMAL_CHUNK, prof_t, m);
+}
+
+///===============================================
+/// Integrates n designs, all on the same network, from a cold start to
+/// cfg->t_end in steps of cfg->dt. Returns 0, or -1 on bad input or
+/// allocation failure.
+
+int thermal_run(const struct thermal_net *net, const struct thermal_load *loads, size_t n,
+	const struct thermal_config *cfg, struct thermal_result *out) {
+	 struct thermal_job job;
+	 size_t nchunks = (n + THERMAL_CHUNK - 1) / THERMAL_CHUNK;
+	 int nthreads, rc;
+
+	 memset(&job, 0, sizeof job);
+	 if (thermal_prepare(net, cfg->dt, &job.step) != 0 || !(cfg->t_end >= 0)) return -1;
+	 if (n == 0) return 0;
+	 job.net = net;
+	 job.loads = loads;
+	 job.n = n;
+	 job.cfg = cfg;
+	 job.out = out;
+	 job.nsteps = (size_t)ceil(cfg->t_end / cfg->dt - 1e-6);
+	 job.limit = (cfg->limit != 0) ? cfg->limit : MAX_OP_JUNCT_TEMP_TPS61169;
+
+	 nthreads = pool_threads(cfg->nthreads, nchunks);
+	 job.scratch = aligned_alloc(64, (size_t)nthreads * sizeof *job.scratch);
+	 if (job.scratch == NULL) return -1;
+	 rc = pool_run(nthreads, nchunks, thermal_chunk, &job);
+	 free(job.scratch);
+	 return rc;
+}
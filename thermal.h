@@ -0,0 +1,78 @@
+// thermal.h //
+#ifndef THERMAL_H
+#define THERMAL_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+#include <stddef.h>
+#include "kernel.h"
+
+#define THERMAL_MAX_STAGES 	8
+#define THERMAL_CHUNK 		256	// designs integrated together by one task
+
+/** Thermal RC networks, junction to ambient.
+	THERMAL_FOSTER	n parallel R||C stages in series, the form datasheet
+			Zth(t) curves are fitted in: Zth(t) = sum R_i (1 - e^-t/(R_i C_i))
+	THERMAL_CAUER	a ladder: R_i from node i to node i+1 (node n is
+			ambient) and C_i from node i to ambient. Power enters
+			at node 0, the junction.
+	Either way the R_i add up to R Theta JA.
+**/
+enum thermal_kind {
+    THERMAL_FOSTER = 0,
+    THERMAL_CAUER
+};
+
+struct thermal_net {
+    enum thermal_kind 	kind;
+    int 		n;
+    float 		r[THERMAL_MAX_STAGES];	// deg C/Watt
+    float 		c[THERMAL_MAX_STAGES];	// Joules/deg C
+};
+
+/** Power into the part over time, per design. A PWM dimming wave of
+	p_on for duty*period then p_off for the rest of each period (period 0
+	== always p_on), plus surge extra Watts for the first surge_time
+	seconds after turn-on. The junction starts at amb.
+**/
+struct thermal_load {
+    float 	p_on;		// Watts
+    float 	p_off;		// Watts
+    float 	period;		// seconds
+    float 	duty;		// 0 .. 1
+    float 	surge;		// Watts on top, at turn-on
+    float 	surge_time;	// seconds
+    float 	amb;		// deg C
+};
+
+/** dt is the fixed step and must be shorter than the PWM periods.
+	limit defaults to MAX_OP_JUNCT_TEMP_TPS61169 when 0.
+**/
+struct thermal_config {
+    float 	dt;		// seconds
+    float 	t_end;		// seconds
+    float 	limit;		// deg C
+    int 	nthreads;	// 0 == all cores
+};
+
+/// Streamed per design, no traces are kept
+struct thermal_result {
+    float 	peak;		// highest junction temperature, deg C
+    float 	t_peak;		// when it was first reached, seconds
+    float 	time_above;	// seconds at or above limit
+    float 	final;		// junction temperature at t_end
+};
+
+void thermal_tps61169(struct thermal_net *net);
+float thermal_rth(const struct thermal_net *net);
+void thermal_load_from_design(const struct C_design *d, float period, float duty,
+	float surge_factor, float surge_time, struct thermal_load *out);
+float thermal_steady(const struct thermal_net *net, const struct thermal_load *load);
+int thermal_run(const struct thermal_net *net, const struct thermal_load *loads, size_t n,
+	const struct thermal_config *cfg, struct thermal_result *out);
+
+#endif
@@ -0,0 +1,83 @@
+// units.h //
+#ifndef UNITS_H
+#define UNITS_H
+
+/**
+	Copyright (C) 2023
+	Jacob Romero, Creative Engineering Solutions, LLC
+	cesllc876@gmail.com
+**/
+
+/** Typed quantities. Each unit is a struct of one float, so volts and
+	ohms are different types to the compiler: handing a resistance to
+	something that wants a voltage, or adding amps to watts, does not
+	build.
+		struct u_amps i = u_current(u_volts(3.3f), u_ohms(10));	// ok
+		struct u_amps j = u_current(u_ohms(10), u_volts(3.3f));	// error
+	Everything is static inline on values that fit a register, so at
+	-O2 the structs vanish and what is left is the same float arithmetic,
+	in the same order, as the untyped kernels; results match bit for bit.
+	x.val gets the plain float back out.
+**/
+
+///===============================================
+/// u_NAME(x) makes one from a float, and the operations that keep the
+/// unit are NAME_add, NAME_sub and NAME_scale (by a plain number).
+
+#define U_UNIT(NAME) \
+struct NAME { float val; }; \
+static inline struct NAME NAME(float x) { struct NAME q = { x }; return q; } \
+static inline struct NAME NAME##_add(struct NAME a, struct NAME b) { return NAME(a.val + b.val); } \
+static inline struct NAME NAME##_sub(struct NAME a, struct NAME b) { return NAME(a.val - b.val); } \
+static inline struct NAME NAME##_scale(struct NAME a, float k) { return NAME(k * a.val); }
+
+U_UNIT(u_volts)
+U_UNIT(u_ohms)
+U_UNIT(u_amps)
+U_UNIT(u_watts)
+U_UNIT(u_celsius)
+U_UNIT(u_cpw)		// thermal resistance, deg C/Watt
+U_UNIT(u_lux)
+
+#undef U_UNIT
+
+///===============================================
+/// The relations between them. Each is written the way the kernel.h
+/// function it stands for is, so the two round alike.
+
+/// Ohm's law, I = V / R
+static inline struct u_amps u_current(struct u_volts v, struct u_ohms r) {
+	 return u_amps(v.val / r.val);
+}
+
+/// V = I * R
+static inline struct u_volts u_drop(struct u_amps i, struct u_ohms r) {
+	 return u_volts(i.val * r.val);
+}
+
+/// P = V * I
+static inline struct u_watts u_power(struct u_volts v, struct u_amps i) {
+	 return u_watts(v.val * i.val);
+}
+
+/// n equal resistors in parallel
+static inline struct u_ohms u_parallel(struct u_ohms r, int n) {
+	 return u_ohms(1/(n * (1/r.val)));
+}
+
+/// Two resistors in parallel
+static inline struct u_ohms u_parallel2(struct u_ohms a, struct u_ohms b) {
+	 return u_ohms((a.val * b.val) / (a.val + b.val));
+}
+
+/// The resistor that, in parallel with fixed, gives want
+static inline struct u_ohms u_trim(struct u_ohms want, struct u_ohms fixed) {
+	 return u_ohms((fixed.val * want.val) / (fixed.val - want.val));
+}
+
+/// Junction temperature: ambient plus R Theta JA times the power
+static inline struct u_celsius u_junction(struct u_watts p, struct u_cpw rth, struct u_celsius amb) {
+	 return u_celsius((rth.val * p.val) + amb.val);
+}
+
+#endif